@@ -184,10 +184,12 @@ struct PixelInput
 	float4 ViewPosLight : POSITION2;
 #endif
 };
-PixelInput VS(vbSurface surf, vbWeightedSkin skin)
+PixelInput VS(vbSurfaceIn surfIn, vbWeightedSkinIn skinIn)
 {
+	MIR_DECODE_VERTEX(surf, skin, surfIn, skinIn, PositionQuantScale, PositionQuantOffset);
 	PixelInput output;
-	matrix MW = mul(World, transpose(Model));
+	MIR_SETUP_SKINNING(skin);
+	matrix MW = mul(MIR_SKIN_WORLD(World), transpose(MIR_SKIN_MODEL));
 		
 	//WorldPos
 	float4 skinPos = Skinning(skin.BlendWeights, skin.BlendIndices, float4(surf.Pos.xyz, 1.0));
@@ -309,11 +311,13 @@ struct PSShadowCasterInput
 	float4 Pos  : SV_POSITION;
 	///float2 Tex : TEXCOORD0;
 };
-PSShadowCasterInput VSShadowCaster(vbSurface surf, vbWeightedSkin skin)
+PSShadowCasterInput VSShadowCaster(vbSurfaceIn surfIn, vbWeightedSkinIn skinIn)
 {
+	MIR_DECODE_VERTEX(surf, skin, surfIn, skinIn, PositionQuantScale, PositionQuantOffset);
 	PSShadowCasterInput output;
+	MIR_SETUP_SKINNING(skin);
 	float4 skinPos = Skinning(skin.BlendWeights, skin.BlendIndices, float4(surf.Pos, 1.0));
-	output.Pos = mul(mul(LightProjection, mul(LightView, mul(World, transpose(Model)))), skinPos);
+	output.Pos = mul(mul(LightProjection, mul(LightView, mul(MIR_SKIN_WORLD(World), transpose(MIR_SKIN_MODEL)))), skinPos);
 	///output.Tex = surf.Tex;
 	return output;
 }
@@ -330,11 +334,13 @@ struct PSGenerateVSMInput
 	float4 ViewPos : POSITION0;
 	///float4 WorldPos : POSITION1;
 };
-PSGenerateVSMInput VSGenerateVSM(vbSurface surf, vbWeightedSkin skin)
+PSGenerateVSMInput VSGenerateVSM(vbSurfaceIn surfIn, vbWeightedSkinIn skinIn)
 {
+	MIR_DECODE_VERTEX(surf, skin, surfIn, skinIn, PositionQuantScale, PositionQuantOffset);
 	PSGenerateVSMInput output;
+	MIR_SETUP_SKINNING(skin);
 	float4 skinPos = Skinning(skin.BlendWeights, skin.BlendIndices, float4(surf.Pos, 1.0));
-	float4 worldPos = mul(mul(World, transpose(Model)), skinPos);
+	float4 worldPos = mul(mul(MIR_SKIN_WORLD(World), transpose(MIR_SKIN_MODEL)), skinPos);
 	///output.WorldPos = worldPos;
 	output.ViewPos = mul(LightView, worldPos);
 	output.Pos = mul(LightProjection, output.ViewPos);
@@ -410,10 +416,12 @@ struct PSPrepassBaseInput
 	float3 WorldPos : POSITION0; //world space
 	float4 Color : COLOR;
 };
-PSPrepassBaseInput VSPrepassBase(vbSurface surf, vbWeightedSkin skin)
+PSPrepassBaseInput VSPrepassBase(vbSurfaceIn surfIn, vbWeightedSkinIn skinIn)
 {
+	MIR_DECODE_VERTEX(surf, skin, surfIn, skinIn, PositionQuantScale, PositionQuantOffset);
 	PSPrepassBaseInput output;
-	matrix MW = mul(World, transpose(Model));
+	MIR_SETUP_SKINNING(skin);
+	matrix MW = mul(MIR_SKIN_WORLD(World), transpose(MIR_SKIN_MODEL));
 	
 	//Pos && WorldPos
 	float4 skinPos = Skinning(skin.BlendWeights, skin.BlendIndices, float4(surf.Pos.xyz, 1.0));
@@ -186,13 +186,14 @@ struct PixelInput
 #endif
 };
 #if SHADER_STAGE == SHADER_STAGE_VERTEX
-	MIR_DECLARE_VS_IN_Surface(surf, 0);
-	MIR_DECLARE_VS_IN_Skin(skin, 3);
+	MIR_DECLARE_VS_IN_Vertex(surf, skin);
 	MIR_DECLARE_VS_OUT(PixelInput, o, 0);
 
 	void StageEntry_VS()
 	{
-		matrix MW = World * transpose(Model);
+		MIR_DECODE_VERTEX(surf, skin, PositionQuantScale, PositionQuantOffset);
+		MIR_SETUP_SKINNING(skin);
+		matrix MW = MIR_SKIN_WORLD(World) * transpose(MIR_SKIN_MODEL);
 
 		//WorldPos
 		float4 skinPos = Skinning(skinBlendWeights, skinBlendIndices, float4(surfPos.xyz, 1.0));
@@ -200,14 +201,14 @@ struct PixelInput
 	
 		//normal && tangent && bitangent
 	#if HAS_ATTRIBUTE_NORMAL
-		float4 skinNormal = Skinning(skinBlendWeights, skinBlendIndices, float4(skinNormal.xyz, 0.0));
-		float3 oNormal = normalize((MW * skinNormal).xyz);
+		float4 skinnedNormal = Skinning(skinBlendWeights, skinBlendIndices, float4(skinNormal.xyz, 0.0));
+		float3 oNormal = normalize((MW * skinnedNormal).xyz);
 		o.Normal = oNormal;
 	#endif
 
 	#if HAS_ATTRIBUTE_TANGENT
-		float4 skinTangent = Skinning(skinBlendWeights, skinBlendIndices, float4(skinTangent.xyz, 0.0));
-		float3 oTangent = normalize((MW * skinTangent).xyz);
+		float4 skinnedTangent = Skinning(skinBlendWeights, skinBlendIndices, float4(skinTangent.xyz, 0.0));
+		float3 oTangent = normalize((MW * skinnedTangent).xyz);
 		o.Tangent = oTangent;
 	#endif
 
@@ -310,13 +311,14 @@ struct PixelInput
 #if LIGHTMODE == LIGHTMODE_SHADOW_CASTER
 #if SHADOW_MODE != SHADOW_VSM
 #if SHADER_STAGE == SHADER_STAGE_VERTEX
-	MIR_DECLARE_VS_IN_Surface(surf, 0);
-	MIR_DECLARE_VS_IN_Skin(skin, 3);
+	MIR_DECLARE_VS_IN_Vertex(surf, skin);
 
 	void StageEntry_VSShadowCaster()
 	{
+		MIR_DECODE_VERTEX(surf, skin, PositionQuantScale, PositionQuantOffset);
+		MIR_SETUP_SKINNING(skin);
 		float4 skinPos = float4(surfPos, 1.0);//Skinning(skinBlendWeights, skinBlendIndices, float4(surfPos, 1.0));
-		matrix WVP = LightProjection * LightView * World * transpose(Model);
+		matrix WVP = LightProjection * LightView * MIR_SKIN_WORLD(World) * transpose(MIR_SKIN_MODEL);
 		gl_Position = (WVP * skinPos);
 	}
 #else
@@ -333,14 +335,15 @@ struct PSGenerateVSMInput
 	float4 ViewPos;
 };
 #if SHADER_STAGE == SHADER_STAGE_VERTEX
-	MIR_DECLARE_VS_IN_Surface(surf, 0);
-	MIR_DECLARE_VS_IN_Skin(skin, 3);
+	MIR_DECLARE_VS_IN_Vertex(surf, skin);
 	MIR_DECLARE_VS_OUT(PSGenerateVSMInput, o, 0);
 
 	void StageEntry_VSGenerateVSM()
 	{
+		MIR_DECODE_VERTEX(surf, skin, PositionQuantScale, PositionQuantOffset);
+		MIR_SETUP_SKINNING(skin);
 		float4 skinPos = Skinning(skinBlendWeights, skinBlendIndices, float4(surfPos, 1.0));
-		float4 worldPos = World * transpose(Model) * skinPos;
+		float4 worldPos = MIR_SKIN_WORLD(World) * transpose(MIR_SKIN_MODEL) * skinPos;
 		o.ViewPos = LightView * worldPos;
 		gl_Position = LightProjection * o.ViewPos;
 	}
@@ -427,13 +430,14 @@ struct PSPrepassBaseInput
 	float4 Color;
 };
 #if SHADER_STAGE == SHADER_STAGE_VERTEX
-	MIR_DECLARE_VS_IN_Surface(surf, 0);
-	MIR_DECLARE_VS_IN_Skin(skin, 3);
+	MIR_DECLARE_VS_IN_Vertex(surf, skin);
 	MIR_DECLARE_VS_OUT(PSPrepassBaseInput, o, 0);
 
 	void StageEntry_VSPrepassBase()
 	{
-		matrix MW = World * transpose(Model);
+		MIR_DECODE_VERTEX(surf, skin, PositionQuantScale, PositionQuantOffset);
+		MIR_SETUP_SKINNING(skin);
+		matrix MW = MIR_SKIN_WORLD(World) * transpose(MIR_SKIN_MODEL);
 	
 		//Pos && WorldPos
 		float4 skinPos = Skinning(skinBlendWeights, skinBlendIndices, float4(surfPos.xyz, 1.0));
@@ -442,13 +446,13 @@ struct PSPrepassBaseInput
 	
 		//normal && tangent && bitangent
 	#if HAS_ATTRIBUTE_NORMAL
-		float4 skinNormal = Skinning(skinBlendWeights, skinBlendIndices, float4(skinNormal.xyz, 0.0));
-		o.Normal = normalize((MW * skinNormal).xyz);
+		float4 skinnedNormal = Skinning(skinBlendWeights, skinBlendIndices, float4(skinNormal.xyz, 0.0));
+		o.Normal = normalize((MW * skinnedNormal).xyz);
 	#endif
 
 	#if HAS_ATTRIBUTE_TANGENT
-		float4 skinTangent = Skinning(skinBlendWeights, skinBlendIndices, float4(skinTangent.xyz, 0.0));
-		o.Tangent = normalize((MW * skinTangent).xyz);
+		float4 skinnedTangent = Skinning(skinBlendWeights, skinBlendIndices, float4(skinTangent.xyz, 0.0));
+		o.Tangent = normalize((MW * skinnedTangent).xyz);
 	#endif
 
 	#if HAS_ATTRIBUTE_NORMAL && HAS_ATTRIBUTE_TANGENT && !ENABLE_PIXEL_BTN
@@ -0,0 +1,106 @@
+#include <windows.h>
+#include <chrono>
+#include <iostream>
+#include <boost/filesystem.hpp>
+#include <boost/format.hpp>
+#include "core/mir.h"
+#include "core/resource/resource_manager.h"
+#include "core/resource/material.h"
+#include "core/resource/material_name.h"
+
+#ifdef _DEBUG
+#pragma comment(lib, "mird.lib")
+#pragma comment(lib, "cppcorod.lib")
+#else
+#pragma comment(lib, "mir.lib")
+#pragma comment(lib, "cppcoro.lib")
+#endif
+#pragma comment(lib, "winmm.lib")
+
+using namespace mir;
+using Clock = std::chrono::steady_clock;
+
+/* property_bench [work_dir] [d3d11|ogl460]
+ * times material property writes by name against writes through one PropertyHandle, the handle shared by several
+ * Model materials written in turn, the way a multi-material model or a pass drawing many materials uses it. */
+
+static HWND CreateHiddenWindow()
+{
+	WNDCLASSA wc = {};
+	wc.lpfnWndProc = DefWindowProcA;
+	wc.hInstance = GetModuleHandleA(NULL);
+	wc.lpszClassName = "PropertyBenchWindowClass";
+	RegisterClassA(&wc);
+	//never shown, the render systems only need a surface to initialize
+	return CreateWindowA(wc.lpszClassName, "property_bench", WS_OVERLAPPEDWINDOW,
+		CW_USEDEFAULT, CW_USEDEFAULT, 64, 64, NULL, NULL, wc.hInstance, NULL);
+}
+
+static CoTask<bool> CreateMaterials(ResourceManager& resMng, std::vector<res::MaterialInstance>& mtls)
+{
+	for (int albedo = 0; albedo < 2; ++albedo) {
+		for (int normal = 0; normal < 2; ++normal) {
+			MaterialLoadParamBuilder loadParam = MAT_MODEL;
+			loadParam["ENABLE_ALBEDO_MAP"] = albedo;
+			loadParam["ENABLE_NORMAL_MAP"] = normal;
+			res::MaterialInstance mtl;
+			if (CoAwait resMng.CreateMaterial(mtl, LaunchSync, loadParam) && mtl.HasProperty("Model"))
+				mtls.push_back(mtl);
+		}
+	}
+	CoReturn !mtls.empty();
+}
+
+/* nanoseconds per write */
+template<typename WriteFunc> static double TimeWrites(int writeCount, WriteFunc write)
+{
+	auto start = Clock::now();
+	for (int i = 0; i < writeCount; ++i)
+		write(i);
+	return std::chrono::duration<double, std::nano>(Clock::now() - start).count() / writeCount;
+}
+
+int main(int argc, char* argv[])
+{
+	std::string workDir = boost::filesystem::system_complete(argc > 1 ? argv[1] : "../work/").string();
+	if (workDir.back() != '/' && workDir.back() != '\\') workDir.push_back('/');
+	PlatformType platform = (argc > 2 && std::string(argv[2]) == "ogl460") ? kPlatformOpengl : kPlatformDirectx;
+
+	HWND hWnd = CreateHiddenWindow();
+	Mir context(LaunchSync);
+	bool initialized = false;
+	context.ExecuteTaskSync([&]()->CoTask<bool> {
+		initialized = CoAwait context.Initialize(hWnd, workDir, platform);
+		CoReturn initialized;
+	}());
+
+	std::vector<res::MaterialInstance> mtls;
+	if (initialized)
+		context.ExecuteTaskSync(CreateMaterials(*context.ResourceMng(), mtls));
+	if (mtls.empty()) {
+		std::cerr << "Model materials not created under " << workDir << std::endl;
+		context.Dispose();
+		DestroyWindow(hWnd);
+		return 1;
+	}
+
+	constexpr int kWriteCount = 2000000;
+	const size_t mtlCount = mtls.size();
+	Eigen::Matrix4f model = Eigen::Matrix4f::Identity();
+	double byName = TimeWrites(kWriteCount, [&](int i) {
+		model(0, 3) = i;
+		mtls[i % mtlCount].SetProperty("Model", model);
+	});
+	res::PropertyHandle<Eigen::Matrix4f> modelProperty("Model");
+	double byHandle = TimeWrites(kWriteCount, [&](int i) {
+		model(0, 3) = i;
+		mtls[i % mtlCount].SetProperty(modelProperty, model);
+	});
+	std::cout << boost::format("materials:%1% writes:%2% by name:%3$.1fns by handle:%4$.1fns")
+		% mtlCount % kWriteCount % byName % byHandle << std::endl;
+
+	mtls.clear();
+	context.Dispose();
+	DestroyWindow(hWnd);
+	return 0;
+}
@@ -0,0 +1,194 @@
+#include <windows.h>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <boost/filesystem.hpp>
+#include <boost/format.hpp>
+#include "core/mir.h"
+#include "core/rendersys/program.h"
+#include "core/resource/resource_manager.h"
+#include "core/resource/program_factory.h"
+#include "core/resource/material_asset.h"
+
+#ifdef _DEBUG
+#pragma comment(lib, "mird.lib")
+#pragma comment(lib, "cppcorod.lib")
+#else
+#pragma comment(lib, "mir.lib")
+#pragma comment(lib, "cppcoro.lib")
+#endif
+#pragma comment(lib, "winmm.lib")
+
+using namespace mir;
+using Clock = std::chrono::steady_clock;
+
+/* shader_precompile [work_dir] [d3d11|ogl460|all]
+ * expands every .Shader (default variant) and .Material (declared macros) under <work_dir>/shader, adds the variants
+ * earlier runs recorded in <work_dir>/shader/<platform>/variants.txt (the ENABLE_*_MAP, VERTEX_COMPACT, ENABLE_BAKED_SKINNING
+ * ones the loaders add), and compiles all programs through ProgramFactory so asm_<platform>.ntpak is warm before the first launch. */
+
+struct ProgramJob {
+	std::string Name, Source;
+	ShaderCompileDesc VertexSCD, PixelSCD;
+	IProgramPtr Program;
+	double Millisecond = 0;
+	bool Succeed = false;
+};
+
+static HWND CreateHiddenWindow()
+{
+	WNDCLASSA wc = {};
+	wc.lpfnWndProc = DefWindowProcA;
+	wc.hInstance = GetModuleHandleA(NULL);
+	wc.lpszClassName = "ShaderPrecompileWindowClass";
+	RegisterClassA(&wc);
+	//never shown, the render systems only need a surface to initialize
+	return CreateWindowA(wc.lpszClassName, "shader_precompile", WS_OVERLAPPEDWINDOW,
+		CW_USEDEFAULT, CW_USEDEFAULT, 64, 64, NULL, NULL, wc.hInstance, NULL);
+}
+
+static void CollectPrograms(res::mat_asset::MaterialAssetManager& assetMng, const std::string& shaderDir, const std::string& platformName, std::vector<ProgramJob>& jobs)
+{
+	std::set<std::string> visited;
+	auto addProgram = [&](const std::string& name, ShaderCompileDesc vertexSCD, ShaderCompileDesc pixelSCD, const std::string& source) {
+		//the shader models CreateProgram defaults to, so the recorded variants and the expanded ones compare equal
+		if (vertexSCD.ShaderModel.empty()) vertexSCD.ShaderModel = "vs_4_0";
+		if (pixelSCD.ShaderModel.empty()) pixelSCD.ShaderModel = "ps_4_0";
+		if (!visited.insert(res::ProgramFactory::SerializeVariant(name, vertexSCD, pixelSCD)).second)
+			return;
+
+		ProgramJob job;
+		job.Name = name;
+		job.Source = source;
+		job.VertexSCD = std::move(vertexSCD);
+		job.PixelSCD = std::move(pixelSCD);
+		jobs.push_back(std::move(job));
+	};
+	auto addShaderNode = [&](const res::mat_asset::ShaderNode& shaderNode, const std::string& source) {
+		shaderNode.ForEachPass([&](const res::mat_asset::PassNode& passNode) {
+			const auto& prog = passNode.Program;
+			if (!prog.VertexSCD.SourcePath.empty())
+				addProgram(prog.VertexSCD.SourcePath, prog.VertexSCD, prog.PixelSCD, source);
+		});
+	};
+
+	boost::filesystem::directory_iterator diter(shaderDir), dend;
+	for (; diter != dend; ++diter) {
+		const auto& path = diter->path();
+		if (!boost::filesystem::is_regular_file(path))
+			continue;
+
+		std::string source = path.filename().string();
+		if (path.extension() == ".Shader") {
+			res::mat_asset::ShaderNode shaderNode;
+			if (assetMng.GetShaderNode(MaterialLoadParam(path.stem().string()), shaderNode)) addShaderNode(shaderNode, source);
+			else std::cerr << "skip " << source << ": parse failed" << std::endl;
+		}
+		else if (path.extension() == ".Material") {
+			res::mat_asset::MaterialNode materialNode;
+			if (assetMng.GetMaterialNode(MaterialLoadParam(path.stem().string()), materialNode)) addShaderNode(materialNode.Shader, source);
+			else std::cerr << "skip " << source << ": parse failed" << std::endl;
+		}
+	}
+
+	std::ifstream variantList(res::ProgramFactory::MakeVariantListPath(shaderDir, platformName));
+	for (std::string line; std::getline(variantList, line);) {
+		std::string name;
+		ShaderCompileDesc vertexSCD, pixelSCD;
+		if (res::ProgramFactory::ParseVariant(line, name, vertexSCD, pixelSCD)) addProgram(name, vertexSCD, pixelSCD, "variants.txt");
+		else if (!line.empty()) std::cerr << "skip variant: " << line << std::endl;
+	}
+}
+
+static CoTask<bool> CompileProgram(ResourceManager& resMng, ProgramJob& job)
+{
+	//move to the thread the program loads on before starting the clock, then CreateProgram doesn't switch again
+	//and the time excludes waiting in the thread pool
+	Launch lchMode = IF_AND_OR(resMng.SupportMTResCreation(), LaunchAsync, LaunchSync);
+	CoAwait resMng.SwitchToLaunchService(lchMode);
+	auto start = Clock::now();
+	job.Succeed = CoAwait resMng.CreateProgram(job.Program, lchMode, job.Name, job.VertexSCD, job.PixelSCD);
+	job.Millisecond = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+	CoReturn job.Succeed;
+}
+
+static CoTask<bool> CompileAll(ResourceManager& resMng, std::vector<ProgramJob>& jobs)
+{
+	std::vector<CoTask<bool>> tasks;
+	for (auto& job : jobs)
+		tasks.push_back(CompileProgram(resMng, job));
+	CoAwait WhenAllReady(std::move(tasks));
+	CoReturn true;
+}
+
+static bool PrecompilePlatform(const std::string& workDir, PlatformType platform, std::ostream& report)
+{
+	const char* platformName = IF_AND_OR(platform == kPlatformOpengl, "ogl460", "d3d11");
+	auto start = Clock::now();
+
+	HWND hWnd = CreateHiddenWindow();
+	Mir context(LaunchAsync);
+	bool initialized = false;
+	context.ExecuteTaskSync([&]()->CoTask<bool> {
+		initialized = CoAwait context.Initialize(hWnd, workDir, platform);
+		CoReturn initialized;
+	}());
+	if (!initialized) {
+		report << platformName << ": render system initialize failed" << std::endl;
+		DestroyWindow(hWnd);
+		return false;
+	}
+	double initMs = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+
+	start = Clock::now();
+	std::vector<ProgramJob> jobs;
+	res::mat_asset::MaterialAssetManager assetMng(workDir + "shader/");
+	CollectPrograms(assetMng, workDir + "shader/", platformName, jobs);
+	double expandMs = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+
+	start = Clock::now();
+	context.ExecuteTaskSync(CompileAll(*context.ResourceMng(), jobs));
+	double compileMs = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+
+	size_t failed = std::count_if(jobs.begin(), jobs.end(), [](const ProgramJob& job) { return !job.Succeed; });
+	report << boost::format("[%1%] programs:%2% failed:%3% init:%4$.1fms expand:%5$.1fms compile(wall):%6$.1fms")
+		% platformName % jobs.size() % failed % initMs % expandMs % compileMs << std::endl;
+
+	std::sort(jobs.begin(), jobs.end(), [](const ProgramJob& l, const ProgramJob& r) { return l.Millisecond > r.Millisecond; });
+	for (const auto& job : jobs) {
+		std::string macros;
+		for (const auto& macro : job.VertexSCD.Macros)
+			macros += " " + macro.Name + "=" + macro.Definition;
+		report << boost::format("\t%1$8.1fms %2% %3% vs:%4% ps:%5%%6% (%7%)")
+			% job.Millisecond % IF_AND_OR(job.Succeed, "ok  ", "FAIL") % job.Name % job.VertexSCD.EntryPoint % job.PixelSCD.EntryPoint % macros % job.Source << std::endl;
+	}
+
+	context.Dispose();
+	DestroyWindow(hWnd);
+	return failed == 0;
+}
+
+int main(int argc, char* argv[])
+{
+	std::string workDir = boost::filesystem::system_complete(argc > 1 ? argv[1] : "../work/").string();
+	if (workDir.back() != '/' && workDir.back() != '\\') workDir.push_back('/');
+	if (!boost::filesystem::is_directory(workDir + "shader/")) {
+		std::cerr << "shader directory not found: " << workDir << "shader/" << std::endl;
+		return 1;
+	}
+
+	std::string platformArg = argc > 2 ? argv[2] : "all";
+	std::vector<PlatformType> platforms;
+	if (platformArg == "all" || platformArg == "d3d11") platforms.push_back(kPlatformDirectx);
+	if (platformArg == "all" || platformArg == "ogl460") platforms.push_back(kPlatformOpengl);
+
+	std::stringstream report;
+	bool succeed = true;
+	for (auto platform : platforms)
+		succeed = PrecompilePlatform(workDir, platform, report) && succeed;
+
+	std::cout << report.str();
+	std::ofstream(workDir + "shader/precompile_report.txt") << report.str();
+	return succeed ? 0 : 1;
+}
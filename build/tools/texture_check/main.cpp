@@ -0,0 +1,133 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+#include <boost/format.hpp>
+#include "core/resource/texture_compressor.h"
+
+#ifdef _DEBUG
+#pragma comment(lib, "mird.lib")
+#else
+#pragma comment(lib, "mir.lib")
+#endif
+
+using namespace mir;
+using namespace mir::res;
+
+/* texture_check
+ * encodes 4x4 blocks whose colors only change hue (a red to green edge keeps the sum of the channels), the kind
+ * a principal axis fit can lose, as BC1 and BC7, decodes them again and compares. exits with 1 past the tolerance. */
+
+typedef uint8_t Block[16][4];
+
+static void DecodeBC1(const uint8_t* src, Block px)
+{
+	uint16_t v[2] = { uint16_t(src[0] | (src[1] << 8)), uint16_t(src[2] | (src[3] << 8)) };
+	int colors[4][4];
+	for (int k = 0; k < 2; ++k) {
+		int r = (v[k] >> 11) & 31, g = (v[k] >> 5) & 63, b = v[k] & 31;
+		colors[k][0] = (r << 3) | (r >> 2);
+		colors[k][1] = (g << 2) | (g >> 4);
+		colors[k][2] = (b << 3) | (b >> 2);
+		colors[k][3] = 255;
+	}
+	for (int c = 0; c < 4; ++c) {
+		if (v[0] > v[1]) {
+			colors[2][c] = (2 * colors[0][c] + colors[1][c]) / 3;
+			colors[3][c] = (colors[0][c] + 2 * colors[1][c]) / 3;
+		}
+		else {
+			colors[2][c] = (colors[0][c] + colors[1][c]) / 2;
+			colors[3][c] = 0;
+		}
+	}
+	uint32_t indices = src[4] | (src[5] << 8) | (src[6] << 16) | (uint32_t(src[7]) << 24);
+	for (int i = 0; i < 16; ++i)
+		for (int c = 0; c < 4; ++c)
+			px[i][c] = uint8_t(colors[(indices >> (i * 2)) & 3][c]);
+}
+
+/* mode 6 only, the one TextureCompressor writes */
+static bool DecodeBC7(const uint8_t* src, Block px)
+{
+	size_t pos = 0;
+	auto read = [&](int bits) {
+		uint32_t value = 0;
+		for (int i = 0; i < bits; ++i, ++pos)
+			value |= uint32_t((src[pos >> 3] >> (pos & 7)) & 1) << i;
+		return value;
+	};
+	if (read(7) != (1 << 6))
+		return false;
+
+	int e[2][4];
+	for (int c = 0; c < 4; ++c) {
+		e[0][c] = read(7);
+		e[1][c] = read(7);
+	}
+	int p0 = read(1), p1 = read(1);
+	for (int c = 0; c < 4; ++c) {
+		e[0][c] = (e[0][c] << 1) | p0;
+		e[1][c] = (e[1][c] << 1) | p1;
+	}
+	static const int weights[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+	for (int i = 0; i < 16; ++i) {
+		int w = weights[read(i == 0 ? 3 : 4)];
+		for (int c = 0; c < 4; ++c)
+			px[i][c] = uint8_t(((64 - w) * e[0][c] + w * e[1][c] + 32) >> 6);
+	}
+	return true;
+}
+
+static int MaxError(const Block a, const Block b)
+{
+	int error = 0;
+	for (int i = 0; i < 16; ++i)
+		for (int c = 0; c < 4; ++c)
+			error = std::max(error, std::abs(int(a[i][c]) - int(b[i][c])));
+	return error;
+}
+
+int main()
+{
+	const uint8_t hues[][2][4] = {
+		{ { 255, 0, 0, 255 }, { 0, 255, 0, 255 } },
+		{ { 0, 255, 0, 255 }, { 0, 0, 255, 255 } },
+		{ { 0, 0, 255, 255 }, { 255, 0, 0, 255 } },
+		{ { 255, 255, 0, 255 }, { 0, 255, 255, 255 } },
+		{ { 200, 40, 120, 255 }, { 40, 200, 120, 255 } },
+	};
+	//two colors BC1 and BC7 both hold up to their endpoint precision, a gradient up to their index steps
+	struct Case { const char* Name; ResourceFormat Format; bool Gradient; int Tolerance; };
+	const Case cases[] = {
+		{ "BC1 edge", kFormatBC1UNorm, false, 8 },
+		{ "BC1 gradient", kFormatBC1UNorm, true, 48 },
+		{ "BC7 edge", kFormatBC7UNorm, false, 2 },
+		{ "BC7 gradient", kFormatBC7UNorm, true, 12 },
+	};
+
+	int failed = 0;
+	for (const auto& test : cases) {
+		for (const auto& hue : hues) {
+			Block src, decoded;
+			for (int i = 0; i < 16; ++i) {
+				float t = test.Gradient ? (i % 4 + i / 4) / 6.0f : float((i % 4) >= 2);
+				for (int c = 0; c < 4; ++c)
+					src[i][c] = uint8_t(hue[0][c] + (hue[1][c] - hue[0][c]) * t + 0.5f);
+			}
+
+			uint8_t block[16] = {};
+			TextureCompressor::EncodeBlockRows(test.Format, &src[0][0], 4, 4, 16, 0, 1, block);
+			if (test.Format == kFormatBC1UNorm) DecodeBC1(block, decoded);
+			else if (!DecodeBC7(block, decoded)) memset(decoded, 0, sizeof(decoded));
+
+			int error = MaxError(src, decoded);
+			bool pass = error <= test.Tolerance;
+			failed += !pass;
+			printf("%s", (boost::format("%1% (%2% %3% %4%)->(%5% %6% %7%): max error %8% %9%\n") % test.Name
+				% int(hue[0][0]) % int(hue[0][1]) % int(hue[0][2]) % int(hue[1][0]) % int(hue[1][1]) % int(hue[1][2])
+				% error % (pass ? "ok" : "FAILED")).str().c_str());
+		}
+	}
+	return failed ? 1 : 0;
+}
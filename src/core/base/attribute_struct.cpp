@@ -1,3 +1,5 @@
+#include <cmath>
+#include <algorithm>
 #include <boost/assert.hpp>
 #include "core/base/attribute_struct.h"
 
@@ -133,4 +135,85 @@ const std::array<uint32_t, kCubeConerCount * 6>& vbSurfaceCube::GetIndices() {
 	return vbSCUnitIndices;
 }
 
+/********** vbSurfaceCompact, vbSkeletonCompact **********/
+static int16_t ToSNorm16(float v)
+{
+	return int16_t(std::round(std::max(-1.0f, std::min(1.0f, v)) * 32767.0f));
+}
+
+static Eigen::Vector2f EncodeOctahedron(const Eigen::Vector3f& n)
+{
+	//project on the octahedron |x|+|y|+|z|=1, the lower half folds over the diagonals
+	float l1 = std::abs(n.x()) + std::abs(n.y()) + std::abs(n.z());
+	if (l1 <= 0.0f) return Eigen::Vector2f::Zero();
+	Eigen::Vector3f v = n / l1;
+	if (v.z() >= 0.0f) return Eigen::Vector2f(v.x(), v.y());
+	return Eigen::Vector2f((1.0f - std::abs(v.y())) * (v.x() >= 0.0f ? 1.0f : -1.0f),
+		(1.0f - std::abs(v.x())) * (v.y() >= 0.0f ? 1.0f : -1.0f));
+}
+
+static void EncodeWeights(const Eigen::Vector4f& weights, uint8_t dst[4])
+{
+	//round every weight, then give the rounding error to the largest so the sum stays what it was
+	int total = 0, largest = 0;
+	for (int i = 0; i < 4; ++i) {
+		dst[i] = uint8_t(std::round(std::max(0.0f, std::min(1.0f, weights[i])) * 255.0f));
+		total += dst[i];
+		if (weights[i] > weights[largest]) largest = i;
+	}
+	int target = int(std::round(std::min(1.0f, weights.sum()) * 255.0f));
+	dst[largest] = uint8_t(std::max(0, std::min(255, dst[largest] + target - total)));
+}
+
+VertexQuantization CompressVertices(const vbSurface* surfaces, const vbSkeleton* skeletons, size_t count, vbSurfaceCompact* dstSurfaces, vbSkeletonCompact* dstSkeletons)
+{
+	Eigen::AlignedBox3f bounds;
+	for (size_t i = 0; i < count; ++i)
+		bounds.extend(surfaces[i].Pos);
+
+	VertexQuantization quant;
+	quant.Scale = Eigen::Vector4f::Ones();
+	quant.Offset = Eigen::Vector4f::Zero();
+	if (!bounds.isEmpty()) {
+		Eigen::Vector3f halfSize = bounds.sizes() * 0.5f;
+		for (int k = 0; k < 3; ++k) quant.Scale[k] = (halfSize[k] > 0.0f) ? halfSize[k] : 1.0f;
+		quant.Offset.head<3>() = bounds.center();
+	}
+
+	for (size_t i = 0; i < count; ++i) {
+		const vbSurface& src = surfaces[i];
+		const vbSkeleton& skeleton = skeletons[i];
+		vbSurfaceCompact& dst = dstSurfaces[i];
+		for (int k = 0; k < 3; ++k)
+			dst.Pos[k] = ToSNorm16((src.Pos[k] - quant.Offset[k]) / quant.Scale[k]);
+		Eigen::Vector3f tangent = skeleton.Tangent.head<3>();
+		bool flip = skeleton.Normal.cross(tangent).dot(skeleton.BiTangent) < 0.0f;
+		dst.Pos[3] = flip ? -32767 : 32767;
+		dst.Color = src.Color;
+		dst.Tex[0] = Eigen::half(src.Tex.x()).x;
+		dst.Tex[1] = Eigen::half(src.Tex.y()).x;
+
+		vbSkeletonCompact& dstSkeleton = dstSkeletons[i];
+		Eigen::Vector2f normal = EncodeOctahedron(skeleton.Normal), tangentOct = EncodeOctahedron(tangent);
+		dstSkeleton.NormalTangent[0] = ToSNorm16(normal.x());
+		dstSkeleton.NormalTangent[1] = ToSNorm16(normal.y());
+		dstSkeleton.NormalTangent[2] = ToSNorm16(tangentOct.x());
+		dstSkeleton.NormalTangent[3] = ToSNorm16(tangentOct.y());
+		EncodeWeights(skeleton.BlendWeights, dstSkeleton.BlendWeights);
+		for (int k = 0; k < 4; ++k) {
+			BOOST_ASSERT(skeleton.BlendIndices[k] >= 0 && skeleton.BlendIndices[k] < 256);
+			dstSkeleton.BlendIndices[k] = uint8_t(skeleton.BlendIndices[k]);
+		}
+	}
+	return quant;
+}
+
+void NarrowIndices(const uint32_t* indices, size_t count, uint16_t* dstIndices)
+{
+	for (size_t i = 0; i < count; ++i) {
+		BOOST_ASSERT(indices[i] < kIndex16VertexLimit);
+		dstIndices[i] = uint16_t(indices[i]);
+	}
+}
+
 }
\ No newline at end of file
@@ -67,4 +67,33 @@ public:
 };
 using vbSkeletonVector = std::vector<vbSkeleton, mir_allocator<vbSkeleton>>;
 
+/* opt-in compact layouts of vbSurface + vbSkeleton, 32 bytes instead of 100. see MIR_DECODE_VERTEX in Skeleton.cginc */
+struct vbSurfaceCompact
+{
+	int16_t Pos[4];//snorm16 inside the mesh bounds, w is the sign of the bitangent
+	unsigned int Color;
+	uint16_t Tex[2];//half
+};
+using vbSurfaceCompactVector = std::vector<vbSurfaceCompact>;
+
+struct vbSkeletonCompact
+{
+	int16_t NormalTangent[4];//snorm16 octahedral normal (xy) and tangent (zw), the bitangent is rebuilt from them
+	uint8_t BlendWeights[4];//unorm8
+	uint8_t BlendIndices[4];
+};
+using vbSkeletonCompactVector = std::vector<vbSkeletonCompact>;
+
+/* decoded position = snorm * Scale + Offset, the bounds of the compressed vertices */
+struct VertexQuantization
+{
+	Eigen::Vector4f Scale, Offset;
+};
+VertexQuantization CompressVertices(const vbSurface* surfaces, const vbSkeleton* skeletons, size_t count, vbSurfaceCompact* dstSurfaces, vbSkeletonCompact* dstSkeletons);
+
+/* 16 bit indices address kIndex16VertexLimit vertices, a mesh within it is indexed with kFormatR16UInt */
+enum { kIndex16VertexLimit = 0x10000 };
+inline bool FitsIndex16(size_t vertexCount) { return vertexCount <= kIndex16VertexLimit; }
+void NarrowIndices(const uint32_t* indices, size_t count, uint16_t* dstIndices);
+
 }
\ No newline at end of file
@@ -0,0 +1,106 @@
+#include <windows.h>
+#include <boost/filesystem.hpp>
+#include <boost/algorithm/string/case_conv.hpp>
+#include "core/base/debug.h"
+#include "core/base/file_watcher.h"
+
+namespace mir {
+
+/********** FileWatcher **********/
+FileWatcher::FileWatcher(const std::string& directory, bool recursive)
+	: mDirectory(NormalizePath(directory))
+	, mRecursive(recursive)
+{
+	HANDLE dirHandle = ::CreateFileA(mDirectory.c_str(), FILE_LIST_DIRECTORY, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+		NULL, OPEN_EXISTING, FILE_FLAG_BACKUP_SEMANTICS | FILE_FLAG_OVERLAPPED, NULL);
+	if (dirHandle == INVALID_HANDLE_VALUE) {
+		DEBUG_LOG_ERROR("fileWatcher open directory failed " + mDirectory);
+		return;
+	}
+	mDirHandle = dirHandle;
+	mStopEvent = ::CreateEventA(NULL, TRUE, FALSE, NULL);
+	mThread = std::thread([this]() { Run(); });
+}
+FileWatcher::~FileWatcher()
+{
+	Stop();
+}
+void FileWatcher::Stop()
+{
+	if (mThread.joinable()) {
+		::SetEvent(mStopEvent);
+		mThread.join();
+	}
+	if (mDirHandle) ::CloseHandle(mDirHandle);
+	if (mStopEvent) ::CloseHandle(mStopEvent);
+	mDirHandle = mStopEvent = nullptr;
+}
+
+std::string FileWatcher::NormalizePath(const std::string& path)
+{
+	boost::filesystem::path result = boost::filesystem::system_complete(path).lexically_normal();
+	if (result.filename_is_dot()) result.remove_filename();
+	result.make_preferred();
+	return boost::algorithm::to_lower_copy(result.string());
+}
+
+bool FileWatcher::PopChanges(std::set<std::string>& files, bool& overflow) ThreadSafe
+{
+	std::lock_guard<std::mutex> lck(mLock);
+	overflow = mOverflow;
+	mOverflow = false;
+	files.insert(mChanges.begin(), mChanges.end());
+	mChanges.clear();
+	return overflow || !files.empty();
+}
+
+void FileWatcher::Run()
+{
+	const DWORD filter = FILE_NOTIFY_CHANGE_LAST_WRITE | FILE_NOTIFY_CHANGE_FILE_NAME | FILE_NOTIFY_CHANGE_SIZE;
+	std::vector<DWORD> buffer(16 * 1024);
+	OVERLAPPED ov = {};
+	ov.hEvent = ::CreateEventA(NULL, TRUE, FALSE, NULL);
+
+	while (true) {
+		::ResetEvent(ov.hEvent);
+		if (!::ReadDirectoryChangesW(mDirHandle, &buffer[0], DWORD(buffer.size() * sizeof(DWORD)), mRecursive, filter, NULL, &ov, NULL)) {
+			DEBUG_LOG_ERROR("fileWatcher ReadDirectoryChangesW failed " + mDirectory);
+			break;
+		}
+
+		HANDLE handles[2] = { ov.hEvent, mStopEvent };
+		if (::WaitForMultipleObjects(2, handles, FALSE, INFINITE) != WAIT_OBJECT_0) {
+			::CancelIo(mDirHandle);
+			::WaitForSingleObject(ov.hEvent, INFINITE);
+			break;
+		}
+
+		DWORD bytes = 0;
+		if (!::GetOverlappedResult(mDirHandle, &ov, &bytes, FALSE))
+			break;
+
+		std::lock_guard<std::mutex> lck(mLock);
+		if (bytes == 0) {
+			mOverflow = true;
+			continue;
+		}
+
+		const char* cursor = (const char*)&buffer[0];
+		while (true) {
+			const FILE_NOTIFY_INFORMATION* info = (const FILE_NOTIFY_INFORMATION*)cursor;
+			if (info->Action != FILE_ACTION_REMOVED && info->Action != FILE_ACTION_RENAMED_OLD_NAME) {
+				int wlen = int(info->FileNameLength / sizeof(WCHAR));
+				int len = ::WideCharToMultiByte(CP_ACP, 0, info->FileName, wlen, NULL, 0, NULL, NULL);
+				std::string name(len, '\0');
+				::WideCharToMultiByte(CP_ACP, 0, info->FileName, wlen, &name[0], len, NULL, NULL);
+				mChanges.insert(NormalizePath(mDirectory + "\\" + name));
+			}
+
+			if (info->NextEntryOffset == 0) break;
+			cursor += info->NextEntryOffset;
+		}
+	}
+	::CloseHandle(ov.hEvent);
+}
+
+}
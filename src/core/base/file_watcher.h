@@ -0,0 +1,40 @@
+#pragma once
+#include <thread>
+#include <mutex>
+#include <boost/noncopyable.hpp>
+#include "core/mir_export.h"
+#include "core/base/stl.h"
+#include "core/base/declare_macros.h"
+
+namespace mir {
+
+/* watches a directory tree on a background thread (ReadDirectoryChangesW),
+ * changed files are queued as normalized paths until PopChanges. */
+class MIR_CORE_API FileWatcher : boost::noncopyable
+{
+public:
+	FileWatcher(const std::string& directory, bool recursive = true);
+	~FileWatcher();
+	void Stop();
+
+	/* overflow = the notify buffer overflowed and changes were lost, the caller should treat everything as changed */
+	bool PopChanges(std::set<std::string>& files, bool& overflow) ThreadSafe;
+	bool IsWatching() const { return mDirHandle != nullptr; }
+	const std::string& GetDirectory() const { return mDirectory; }
+
+	static std::string NormalizePath(const std::string& path);
+private:
+	void Run();
+private:
+	std::string mDirectory;
+	bool mRecursive;
+	void* mDirHandle = nullptr;
+	void* mStopEvent = nullptr;
+	std::thread mThread;
+
+	std::mutex mLock;
+	std::set<std::string> mChanges;
+	bool mOverflow = false;
+};
+
+}
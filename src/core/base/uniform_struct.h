@@ -1,4 +1,5 @@
 #pragma once
+#include <algorithm>
 #include "core/base/math.h"
 
 namespace mir {
@@ -47,16 +48,27 @@ public:
 	BOOL IsSpotLight = false;
 };
 
-struct UNIFORM_ALIGN cbWeightedSkin
+/* the palette size is MAX_MATRICES of Skeleton.cginc, AiSceneLoader splits meshes with more bones than that.
+ * a mesh with fewer bones uploads only the members ahead of Models and its own palette, see UploadSize */
+template<int PaletteSize>
+struct UNIFORM_ALIGN cbWeightedSkinT
 {
 	MIR_MAKE_ALIGNED_OPERATOR_NEW;
-	enum { kModelCount = 56 };
-	cbWeightedSkin() {
+	enum { kModelCount = PaletteSize };
+	static constexpr size_t UploadSize(size_t boneCount) {
+		//Models[0] is read with zero weight by unskinned vertices, it is always uploaded
+		return sizeof(Eigen::Matrix4f) + 2 * sizeof(Eigen::Vector4f) + sizeof(Eigen::Matrix4f) * std::min<size_t>(std::max<size_t>(boneCount, 1), kModelCount);
+	}
+	cbWeightedSkinT() {
 		Models[0] = Model = Eigen::Matrix4f::Identity();
+		PositionQuantScale = Eigen::Vector4f::Ones();
+		PositionQuantOffset = Eigen::Vector4f::Zero();
 	}
 public:
 	Eigen::Matrix4f Model;
+	Eigen::Vector4f PositionQuantScale, PositionQuantOffset;//see VertexQuantization, identity unless the mesh is compact
 	Eigen::Matrix4f Models[kModelCount];
 };
+typedef cbWeightedSkinT<56> cbWeightedSkin;
 
 }
\ No newline at end of file
@@ -127,7 +127,7 @@ CoTask<void> GuiCanvas::UpdateFrame(float dt)
 			{ 0.0f,         0.0f,           0.5f,       0.0f },
 			{ (R + L) / (L - R),  (T + B) / (B - T),    0.5f,       1.0f },
 		};
-		mRop.Material.SetProperty("ProjectionMatrix", Data::Make(mvp));
+		mRop.Material.SetProperty(mProjectionProperty, Eigen::Matrix4f(Eigen::Map<const Eigen::Matrix4f>(&mvp[0][0])));
 	}
 
 	// Setup desired DX state
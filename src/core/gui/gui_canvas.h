@@ -27,6 +27,7 @@ private:
 	ResourceManager& mResMng;
 	IVertexArrayPtr mVao;
 	RenderOperation mRop;
+	res::PropertyHandle<Eigen::Matrix4f> mProjectionProperty{ "ProjectionMatrix" };
 	ITexturePtr mFontTex;
 private:
 	std::vector<RenderOperation> mOps;
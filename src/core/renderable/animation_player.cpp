@@ -0,0 +1,220 @@
+#include <boost/assert.hpp>
+#include "core/renderable/animation_player.h"
+#include "core/resource/animation_clip.h"
+
+namespace mir {
+namespace rend {
+
+static void BlendNode(AnimationPose& pose, size_t i, const Eigen::Vector3f& position, const Eigen::Quaternionf& rotation, const Eigen::Vector3f& scaling, float weight)
+{
+	if (weight >= 1.0f) {
+		pose.Positions[i] = position;
+		pose.Rotations[i] = rotation;
+		pose.Scalings[i] = scaling;
+	}
+	else if (weight > 0.0f) {
+		pose.Positions[i] += (position - pose.Positions[i]) * weight;
+		pose.Rotations[i] = pose.Rotations[i].slerp(weight, rotation);
+		pose.Scalings[i] += (scaling - pose.Scalings[i]) * weight;
+	}
+}
+
+/********** AnimationPose **********/
+void AnimationPose::CopyFrom(const res::AiSkeleton& skeleton)
+{
+	std::copy(skeleton.LocalPositions.begin(), skeleton.LocalPositions.end(), Positions.begin());
+	std::copy(skeleton.LocalRotations.begin(), skeleton.LocalRotations.end(), Rotations.begin());
+	std::copy(skeleton.LocalScalings.begin(), skeleton.LocalScalings.end(), Scalings.begin());
+}
+
+void AnimationPose::ToMatrices(std::vector<Eigen::Matrix4f>& transforms) const
+{
+	//matrices keep aiMatrix4x4's row-major memory layout, so the eigen view is its transpose
+	for (size_t i = 0; i < Positions.size(); ++i) {
+		Eigen::Matrix4f& mat = transforms[i];
+		mat.setIdentity();
+		mat.topLeftCorner<3, 3>() = Scalings[i].asDiagonal() * Rotations[i].toRotationMatrix().transpose();
+		mat.block<1, 3>(3, 0) = Positions[i].transpose();
+	}
+}
+
+/********** AnimationPlayer **********/
+void AnimationPlayer::Init(const res::AiScenePtr& scene, size_t layerCount)
+{
+	mScene = scene;
+	mClipSpeeds.assign(scene->mAnimations.size(), 1.0f);
+
+	size_t nodeCount = scene->GetSkeleton().Count();
+	mLayers.resize(std::max<size_t>(layerCount, 1));
+	for (auto& layer : mLayers)
+		layer.Pose.Resize(nodeCount);
+	mPose.Resize(nodeCount);
+}
+
+void AnimationPlayer::Play(int clipIndex, float fadeSeconds, size_t layerIndex)
+{
+	BOOST_ASSERT(layerIndex < mLayers.size());
+	if (clipIndex < 0 || clipIndex >= mScene->mAnimations.size()) {
+		Stop(layerIndex);
+		return;
+	}
+
+	Layer& layer = mLayers[layerIndex];
+	if (fadeSeconds > 0.0f && layer.Current.ClipIndex >= 0) {
+		std::swap(layer.Current, layer.Previous);
+		layer.FadeElapse = 0.0f;
+		layer.FadeDuration = fadeSeconds;
+	}
+	else {
+		layer.Previous.ClipIndex = -1;
+		layer.FadeDuration = 0.0f;
+	}
+	layer.Current.ClipIndex = clipIndex;
+	layer.Current.Elapse = 0.0f;
+	layer.Current.Sampler.Init(mScene->mAnimations[clipIndex]);
+}
+
+void AnimationPlayer::Stop(size_t layerIndex)
+{
+	Layer& layer = mLayers[layerIndex];
+	layer.Current.ClipIndex = layer.Previous.ClipIndex = -1;
+	layer.FadeDuration = 0.0f;
+}
+
+void AnimationPlayer::SetLayerBlend(size_t layerIndex, AnimationBlendMode mode, float weight)
+{
+	mLayers[layerIndex].Mode = mode;
+	mLayers[layerIndex].Weight = weight;
+}
+
+void AnimationPlayer::SetLayerMask(size_t layerIndex, const std::string& rootNodeName, float weight)
+{
+	const auto& skeleton = mScene->GetSkeleton();
+	auto& mask = mLayers[layerIndex].Mask;
+	mask.assign(skeleton.Count(), 0.0f);
+
+	res::AiNodePtr root = mScene->FindNodeByName(rootNodeName);
+	if (root == nullptr) return;
+
+	//parents precede children, a node is masked in when its parent is
+	mask[root->SerilizeIndex] = weight;
+	for (size_t i = root->SerilizeIndex + 1; i < skeleton.Count(); ++i) {
+		int parent = skeleton.ParentIndices[i];
+		if (parent >= 0 && mask[parent] > 0.0f) mask[i] = weight;
+	}
+}
+
+void AnimationPlayer::ClearLayerMask(size_t layerIndex)
+{
+	mLayers[layerIndex].Mask.clear();
+}
+
+void AnimationPlayer::SetClipSpeed(int clipIndex, float speed)
+{
+	if (clipIndex >= 0 && clipIndex < mClipSpeeds.size())
+		mClipSpeeds[clipIndex] = speed;
+}
+
+bool AnimationPlayer::IsPlaying() const
+{
+	return std::any_of(mLayers.begin(), mLayers.end(), [](const Layer& layer) { return layer.Current.ClipIndex >= 0; });
+}
+
+bool AnimationPlayer::IsSingleClip() const
+{
+	const Layer& base = mLayers[0];
+	if (base.Current.ClipIndex < 0 || base.Previous.ClipIndex >= 0 
+		|| base.Mode != kAnimationBlendOverride || base.Weight < 1.0f || !base.Mask.empty())
+		return false;
+	return std::none_of(mLayers.begin() + 1, mLayers.end(), [](const Layer& layer) { 
+		return layer.Current.ClipIndex >= 0 || layer.Previous.ClipIndex >= 0; 
+	});
+}
+
+void AnimationPlayer::Advance(float dt)
+{
+	for (auto& layer : mLayers) {
+		if (layer.Current.ClipIndex >= 0)
+			layer.Current.Elapse += dt * mClipSpeeds[layer.Current.ClipIndex];
+
+		if (layer.Previous.ClipIndex >= 0) {
+			layer.Previous.Elapse += dt * mClipSpeeds[layer.Previous.ClipIndex];
+			layer.FadeElapse += dt;
+			if (layer.FadeElapse >= layer.FadeDuration)
+				layer.Previous.ClipIndex = -1;
+		}
+	}
+}
+
+void AnimationPlayer::SampleClip(const ClipState& state, float weight, AnimationPose& pose) const
+{
+	const auto& skeleton = mScene->GetSkeleton();
+	const auto& binding = mScene->GetAnimationBinding(state.ClipIndex);
+	const auto& positions = state.Sampler.GetPositions();
+	const auto& rotations = state.Sampler.GetRotations();
+	const auto& scalings = state.Sampler.GetScalings();
+	for (size_t i = 0; i < skeleton.Count(); ++i) {
+		int channel = binding[i];
+		if (channel >= 0) BlendNode(pose, i, positions[channel], rotations[channel], scalings[channel], weight);
+		else BlendNode(pose, i, skeleton.LocalPositions[i], skeleton.LocalRotations[i], skeleton.LocalScalings[i], weight);
+	}
+}
+
+void AnimationPlayer::SampleLayer(Layer& layer)
+{
+	layer.Pose.CopyFrom(mScene->GetSkeleton());
+	if (layer.Previous.ClipIndex >= 0) {
+		layer.Previous.Sampler.Sample(layer.Previous.Elapse);
+		SampleClip(layer.Previous, 1.0f, layer.Pose);
+	}
+	if (layer.Current.ClipIndex >= 0) {
+		float weight = (layer.Previous.ClipIndex >= 0) ? layer.FadeElapse / layer.FadeDuration : 1.0f;
+		layer.Current.Sampler.Sample(layer.Current.Elapse);
+		SampleClip(layer.Current, weight, layer.Pose);
+	}
+}
+
+void AnimationPlayer::BlendLayer(const Layer& layer)
+{
+	const auto& skeleton = mScene->GetSkeleton();
+	const std::vector<int>* bindings[2] = {
+		(layer.Current.ClipIndex >= 0) ? &mScene->GetAnimationBinding(layer.Current.ClipIndex) : nullptr,
+		(layer.Previous.ClipIndex >= 0) ? &mScene->GetAnimationBinding(layer.Previous.ClipIndex) : nullptr
+	};
+	for (size_t i = 0; i < skeleton.Count(); ++i) {
+		//a layer only touches the nodes its clips animate
+		if (!(bindings[0] && (*bindings[0])[i] >= 0) && !(bindings[1] && (*bindings[1])[i] >= 0))
+			continue;
+
+		float weight = layer.Weight * (layer.Mask.empty() ? 1.0f : layer.Mask[i]);
+		if (weight <= 0.0f) continue;
+
+		const auto& pose = layer.Pose;
+		if (layer.Mode == kAnimationBlendAdditive) {
+			weight = std::min(weight, 1.0f);
+			Eigen::Quaternionf deltaRotation = skeleton.LocalRotations[i].conjugate() * pose.Rotations[i];
+			Eigen::Vector3f deltaScaling = pose.Scalings[i].cwiseQuotient(skeleton.LocalScalings[i]);
+			mPose.Positions[i] += (pose.Positions[i] - skeleton.LocalPositions[i]) * weight;
+			mPose.Rotations[i] = mPose.Rotations[i] * Eigen::Quaternionf::Identity().slerp(weight, deltaRotation);
+			mPose.Scalings[i] = mPose.Scalings[i].cwiseProduct(Eigen::Vector3f::Ones() + (deltaScaling - Eigen::Vector3f::Ones()) * weight);
+		}
+		else {
+			BlendNode(mPose, i, pose.Positions[i], pose.Rotations[i], pose.Scalings[i], weight);
+		}
+	}
+}
+
+void AnimationPlayer::Evaluate(std::vector<Eigen::Matrix4f>& localTransforms)
+{
+	mPose.CopyFrom(mScene->GetSkeleton());
+	for (auto& layer : mLayers) {
+		if (layer.Current.ClipIndex < 0 && layer.Previous.ClipIndex < 0)
+			continue;
+		SampleLayer(layer);
+		BlendLayer(layer);
+	}
+	mPose.ToMatrices(localTransforms);
+}
+
+}
+}
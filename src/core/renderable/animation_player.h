@@ -0,0 +1,87 @@
+#pragma once
+#include "core/mir_export.h"
+#include "core/base/math.h"
+#include "core/base/stl.h"
+#include "core/base/declare_macros.h"
+#include "core/resource/assimp_resource.h"
+#include "core/renderable/animation_sampler.h"
+
+namespace mir {
+namespace rend {
+
+/* local pose in (T, R, S) form, indexed by node SerilizeIndex */
+struct AnimationPose
+{
+	void Resize(size_t count) {
+		Positions.resize(count);
+		Rotations.resize(count);
+		Scalings.resize(count);
+	}
+	void CopyFrom(const res::AiSkeleton& skeleton);
+	void ToMatrices(std::vector<Eigen::Matrix4f>& transforms) const;
+public:
+	std::vector<Eigen::Vector3f> Positions, Scalings;
+	std::vector<Eigen::Quaternionf> Rotations;
+};
+
+enum AnimationBlendMode
+{
+	kAnimationBlendOverride,
+	kAnimationBlendAdditive,//relative to the skeleton's bind pose
+};
+
+/* layered clip playback over one AiScene.
+ * layer 0 is the base, upper layers override or add onto it with a weight and an optional per-node mask.
+ * Play with fadeSeconds > 0 crossfades from the clip the layer was playing.
+ * every buffer is sized in Init (and in Play for the clip's channels), Evaluate allocates nothing. */
+class MIR_CORE_API AnimationPlayer
+{
+public:
+	enum { kDefaultLayerCount = 4 };
+	MIR_MAKE_ALIGNED_OPERATOR_NEW;
+	void Init(const res::AiScenePtr& scene, size_t layerCount = kDefaultLayerCount);
+	void Play(int clipIndex, float fadeSeconds = 0.0f, size_t layer = 0);
+	void Stop(size_t layer = 0);
+
+	void SetLayerBlend(size_t layer, AnimationBlendMode mode, float weight);
+	/* the node and its descendants take weight, the rest of the skeleton keeps 0 */
+	void SetLayerMask(size_t layer, const std::string& rootNodeName, float weight = 1.0f);
+	void ClearLayerMask(size_t layer);
+	void SetClipSpeed(int clipIndex, float speed);
+
+	bool IsPlaying() const;
+	/* only the base layer plays, without fade, mask or partial weight */
+	bool IsSingleClip() const;
+	int GetClipIndex(size_t layer = 0) const { return mLayers[layer].Current.ClipIndex; }
+	float GetTime(size_t layer = 0) const { return mLayers[layer].Current.Elapse; }
+	void SetTime(float seconds, size_t layer = 0) { mLayers[layer].Current.Elapse = seconds; }
+	size_t LayerCount() const { return mLayers.size(); }
+
+	void Advance(float dt);
+	void Evaluate(std::vector<Eigen::Matrix4f>& localTransforms);
+private:
+	struct ClipState {
+		int ClipIndex = -1;
+		float Elapse = 0.0f;
+		AnimationSampler Sampler;
+	};
+	struct Layer {
+		AnimationBlendMode Mode = kAnimationBlendOverride;
+		float Weight = 1.0f;
+		std::vector<float> Mask;//empty = every node
+		ClipState Current, Previous;
+		float FadeElapse = 0.0f, FadeDuration = 0.0f;
+		AnimationPose Pose;
+	};
+	void SampleLayer(Layer& layer);
+	void SampleClip(const ClipState& state, float weight, AnimationPose& pose) const;
+	void BlendLayer(const Layer& layer);
+private:
+	res::AiScenePtr mScene;
+	std::vector<float> mClipSpeeds;
+	std::vector<Layer> mLayers;
+	AnimationPose mPose;
+};
+
+}
+}
@@ -0,0 +1,85 @@
+#include "core/renderable/animation_sampler.h"
+#include "core/resource/animation_clip.h"
+
+namespace mir {
+namespace rend {
+
+static unsigned SeekKey(const res::AnimationKey* keys, unsigned count, float time, unsigned cursor)
+{
+	if (count <= 1) return 0;
+	if (cursor >= count) cursor = 0;
+
+	//forward playback, the cursor stays or steps a key or two
+	if (keys[cursor].Time <= time) {
+		for (int step = 0; step < 2 && cursor + 1 < count && keys[cursor + 1].Time <= time; ++step)
+			++cursor;
+		if (cursor + 1 == count || time < keys[cursor + 1].Time)
+			return cursor;
+	}
+
+	//seek or wrap-around, last key whose time <= time
+	const res::AnimationKey* iter = std::upper_bound(keys, keys + count, time, [](float t, const res::AnimationKey& key) { return t < key.Time; });
+	return unsigned(std::max<ptrdiff_t>(iter - keys - 1, 0));
+}
+
+static float KeyFactor(const res::AnimationKey* keys, unsigned count, unsigned frame, float time, unsigned& nextFrame)
+{
+	nextFrame = (frame + 1) % count;
+	float diffTime = float(keys[nextFrame].Time) - keys[frame].Time;
+	if (diffTime < 0.0f) diffTime += res::AnimationClip::kTimeScale;
+	return (diffTime > 0.0f) ? std::min(std::max((time - keys[frame].Time) / diffTime, 0.0f), 1.0f) : 0.0f;
+}
+
+static Eigen::Vector3f SampleVector(const res::AnimationClip& clip, const res::AnimationTrack& track, float time, unsigned& cursor, const Eigen::Vector3f& defValue)
+{
+	if (track.Count == 0) return defValue;
+
+	const res::AnimationKey* keys = clip.GetKeys(track);
+	if (track.Count == 1) return res::AnimationClip::DecodeVector(track, keys[0]);
+
+	unsigned next, frame = cursor = SeekKey(keys, track.Count, time, cursor);
+	float factor = KeyFactor(keys, track.Count, frame, time, next);
+	Eigen::Vector3f key = res::AnimationClip::DecodeVector(track, keys[frame]);
+	return key + (res::AnimationClip::DecodeVector(track, keys[next]) - key) * factor;
+}
+
+/********** AnimationSampler **********/
+void AnimationSampler::Init(const res::AnimationClipPtr& clip)
+{
+	mClip = clip;
+	size_t channelCount = clip ? clip->ChannelCount() : 0;
+	mCursors.assign(channelCount, KeyCursor());
+	mPositions.resize(channelCount);
+	mScalings.resize(channelCount);
+	mRotations.resize(channelCount);
+}
+
+void AnimationSampler::Sample(float seconds)
+{
+	if (mClip == nullptr) return;
+
+	// map into anim's duration, then into the quantized key time
+	double duration = mClip->GetDuration();
+	double ticks = (duration > 0.0) ? fmod(double(seconds) * mClip->GetTicksPerSecond(), duration) : 0.0;
+	float time = (duration > 0.0) ? float(ticks / duration * res::AnimationClip::kTimeScale) : 0.0f;
+
+	const size_t channelCount = mClip->ChannelCount();
+	for (size_t i = 0; i < channelCount; ++i)
+		mPositions[i] = SampleVector(*mClip, mClip->GetChannel(i).Position, time, mCursors[i].Position, Eigen::Vector3f::Zero());
+	for (size_t i = 0; i < channelCount; ++i) {
+		const res::AnimationTrack& track = mClip->GetChannel(i).Rotation;
+		const res::AnimationKey* keys = mClip->GetKeys(track);
+		if (track.Count > 1) {
+			unsigned next, frame = mCursors[i].Rotation = SeekKey(keys, track.Count, time, mCursors[i].Rotation);
+			float factor = KeyFactor(keys, track.Count, frame, time, next);
+			mRotations[i] = res::AnimationClip::DecodeRotation(keys[frame]).slerp(factor, res::AnimationClip::DecodeRotation(keys[next]));
+		}
+		else if (track.Count == 1) mRotations[i] = res::AnimationClip::DecodeRotation(keys[0]);
+		else mRotations[i] = Eigen::Quaternionf::Identity();
+	}
+	for (size_t i = 0; i < channelCount; ++i)
+		mScalings[i] = SampleVector(*mClip, mClip->GetChannel(i).Scaling, time, mCursors[i].Scaling, Eigen::Vector3f::Ones());
+}
+
+}
+}
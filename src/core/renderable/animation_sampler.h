@@ -0,0 +1,39 @@
+#pragma once
+#include "core/mir_export.h"
+#include "core/base/math.h"
+#include "core/base/stl.h"
+#include "core/base/declare_macros.h"
+#include "core/resource/predeclare.h"
+
+namespace mir {
+namespace rend {
+
+/* samples one compressed clip into per-channel local transforms, only the two keys around the time are decoded.
+ * key cursors persist between calls: playing forward moves them by a key or two,
+ * seeks and loop wrap-arounds fall back to a binary search.
+ * tracks are sampled into SoA arrays (positions, rotations, scalings) indexed by channel. */
+class MIR_CORE_API AnimationSampler
+{
+public:
+	MIR_MAKE_ALIGNED_OPERATOR_NEW;
+	void Init(const res::AnimationClipPtr& clip);
+	void Sample(float seconds);
+
+	bool IsValid() const { return mClip != nullptr; }
+	size_t ChannelCount() const { return mPositions.size(); }
+	const res::AnimationClipPtr& GetClip() const { return mClip; }
+	const std::vector<Eigen::Vector3f>& GetPositions() const { return mPositions; }
+	const std::vector<Eigen::Quaternionf>& GetRotations() const { return mRotations; }
+	const std::vector<Eigen::Vector3f>& GetScalings() const { return mScalings; }
+private:
+	struct KeyCursor {
+		unsigned Position = 0, Rotation = 0, Scaling = 0;
+	};
+	res::AnimationClipPtr mClip;
+	std::vector<KeyCursor> mCursors;
+	std::vector<Eigen::Vector3f> mPositions, mScalings;
+	std::vector<Eigen::Quaternionf> mRotations;
+};
+
+}
+}
@@ -0,0 +1,227 @@
+#include <cfloat>
+#include "core/base/debug.h"
+#include "core/base/macros.h"
+#include "core/renderable/animation_system.h"
+#include "core/renderable/assimp_model.h"
+#include "core/scene/camera.h"
+#include "core/scene/light.h"
+#include "core/resource/animation_clip.h"
+#include "core/resource/resource_manager.h"
+
+namespace mir {
+namespace rend {
+
+/********** AnimationSystem::SharedPose **********/
+void AnimationSystem::SharedPose::Setup(const res::AiScenePtr& scene, int clipIndex, float seconds)
+{
+	if (Scene != scene) {
+		Scene = scene;
+		ClipIndex = -1;
+		Player.Init(scene, 1);
+		LocalTransforms.resize(scene->GetSkeleton().Count());
+		GlobalTransforms.resize(scene->GetSkeleton().Count());
+	}
+	if (ClipIndex != clipIndex) {
+		ClipIndex = clipIndex;
+		Player.Play(clipIndex);
+	}
+	Player.SetTime(seconds);
+}
+
+void AnimationSystem::SharedPose::Evaluate()
+{
+	Player.Evaluate(LocalTransforms);
+	Scene->GetSkeleton().ComputeGlobals(LocalTransforms, GlobalTransforms);
+}
+
+/********** AnimationSystem **********/
+AnimationSystem::AnimationSystem(ResourceManager& resMng)
+	: mResMng(resMng)
+{}
+AnimationSystem::~AnimationSystem()
+{
+	for (const auto& model : mRegistered) {
+		model->SetAnimationSystem(nullptr);
+		model->SetSharedGlobals(nullptr);
+	}
+}
+
+void AnimationSystem::Register(const AssimpModelPtr& model)
+{
+	BOOST_ASSERT(model);
+	if (std::find(mRegistered.begin(), mRegistered.end(), model) != mRegistered.end())
+		return;
+	mRegistered.push_back(model);
+	model->SetAnimationSystem(this);
+}
+
+void AnimationSystem::Unregister(const AssimpModelPtr& model)
+{
+	auto iter = std::find(mRegistered.begin(), mRegistered.end(), model);
+	if (iter != mRegistered.end()) {
+		model->SetAnimationSystem(nullptr);
+		model->SetSharedGlobals(nullptr);
+		mRegistered.erase(iter);
+	}
+}
+
+void AnimationSystem::GatherLodCameras(const std::vector<scene::CameraPtr>& cameras, const std::vector<scene::LightPtr>& lights)
+{
+	mLodCameras.clear();
+	for (const auto& camera : cameras) {
+		if (camera) mLodCameras.push_back(LodCamera{ camera->GetProjection() * camera->GetView(), camera->GetCullingMask() });
+	}
+	//a model in a shadow map casts a shadow that may be seen while the model itself isn't
+	for (const auto& light : lights) {
+		if (light && light->DidCastShadow()) mLodCameras.push_back(LodCamera{ light->GetCastShadowProj() * light->GetView(), light->GetCameraMask() });
+	}
+}
+
+int AnimationSystem::SelectLodInterval(const AssimpModel& model) const
+{
+	Eigen::AlignedBox3f aabb = model.GetWorldAABB();
+	if (!mLodEnabled || mLodCameras.empty() || aabb.isEmpty())
+		return 1;
+
+	float screenSize = 0.0f;
+	bool visible = false;
+	for (const auto& camera : mLodCameras) {
+		if ((model.GetCameraMask() & camera.CullingMask) == 0)
+			continue;
+
+		//the box is outside when all its corners are outside the same clip plane, the far plane is left to the distance LOD
+		unsigned outside = 0x1F;
+		bool straddleEye = false;
+		Eigen::Vector2f ndcMin(FLT_MAX, FLT_MAX), ndcMax(-FLT_MAX, -FLT_MAX);
+		for (int corner = 0; corner < 8; ++corner) {
+			Eigen::Vector4f clip = camera.ViewProjection * aabb.corner(Eigen::AlignedBox3f::CornerType(corner)).homogeneous();
+			unsigned code = (clip.x() < -clip.w()) | ((clip.x() > clip.w()) << 1) | ((clip.y() < -clip.w()) << 2) | ((clip.y() > clip.w()) << 3) | ((clip.w() <= 0.0f) << 4);
+			outside &= code;
+			if (clip.w() > 0.0f) {
+				Eigen::Vector2f ndc = clip.head<2>() / clip.w();
+				ndcMin = ndcMin.cwiseMin(ndc);
+				ndcMax = ndcMax.cwiseMax(ndc);
+			}
+			else {
+				straddleEye = true;
+			}
+		}
+		if (outside) continue;
+
+		visible = true;
+		screenSize = std::max(screenSize, straddleEye ? 1.0f : (ndcMax.y() - ndcMin.y()) * 0.5f);
+	}
+
+	if (!visible) return 0;
+	else if (screenSize >= mLodScreenSizes[0]) return 1;
+	else if (screenSize >= mLodScreenSizes[1]) return 2;
+	else return kMaxLodInterval;
+}
+
+void AnimationSystem::ApplyLod()
+{
+	++mFrameCount;
+	mHiddenCount = mReducedRateCount = 0;
+	auto iter = std::remove_if(mModels.begin(), mModels.end(), [&](AssimpModel* model) {
+		//consecutive phases spread the models of a reduced rate evenly over its frames
+		if (model->GetAnimationLodPhase() < 0)
+			model->SetAnimationLodPhase(mNextLodPhase++ % kMaxLodInterval);
+
+		int interval = SelectLodInterval(*model);
+		if (interval == 0) ++mHiddenCount;
+		else if (interval > 1) ++mReducedRateCount;
+		return !model->BeginAnimationLod(interval, mFrameCount);
+	});
+	mModels.erase(iter, mModels.end());
+}
+
+void AnimationSystem::GatherSharedPoses()
+{
+	const float bucketSeconds = 1.0f / kSharedPoseFps;
+
+	//the poses of the last frame get reused, no model may keep pointing at one
+	for (const auto& model : mRegistered)
+		model->SetSharedGlobals(nullptr);
+
+	mSharedRequests.clear();
+	auto iter = std::remove_if(mModels.begin(), mModels.end(), [&](AssimpModel* model) {
+		int clipIndex;
+		float seconds;
+		if (!model->AdvanceSharedPose(clipIndex, seconds))
+			return false;
+
+		//wrap into the clip so that every loop lands in the same buckets
+		const auto& clip = *model->GetAiScene()->mAnimations[clipIndex];
+		float clipSeconds = clip.GetDuration() / clip.GetTicksPerSecond();
+		if (clipSeconds > 0.0f) {
+			seconds = fmod(seconds, clipSeconds);
+			if (seconds < 0.0f) seconds += clipSeconds;
+		}
+		SharedPoseKey key = { model->GetAiScene().get(), clipIndex, int(seconds / bucketSeconds + 0.5f) };
+		mSharedRequests.push_back(std::make_pair(key, model));
+		return true;
+	});
+	mModels.erase(iter, mModels.end());
+
+	std::sort(mSharedRequests.begin(), mSharedRequests.end(), [](const auto& l, const auto& r) { return l.first < r.first; });
+	mSharedPoseCount = 0;
+	for (size_t i = 0; i < mSharedRequests.size(); ) {
+		const SharedPoseKey& key = mSharedRequests[i].first;
+		if (mSharedPoseCount == mSharedPoses.size())
+			mSharedPoses.push_back(std::make_unique<SharedPose>());
+		SharedPose& pose = *mSharedPoses[mSharedPoseCount++];
+		pose.Setup(mSharedRequests[i].second->GetAiScene(), key.ClipIndex, key.Bucket * bucketSeconds);
+
+		for (; i < mSharedRequests.size() && mSharedRequests[i].first == key; ++i)
+			mSharedRequests[i].second->SetSharedGlobals(&pose.GlobalTransforms);
+	}
+}
+
+void AnimationSystem::UpdateJobs(size_t first, size_t last) ThreadSafe
+{
+	for (size_t i = first; i < last; ++i) {
+		if (i < mModels.size()) mModels[i]->UpdateAnimation();
+		else mSharedPoses[i - mModels.size()]->Evaluate();
+	}
+}
+
+CoTask<void> AnimationSystem::UpdateFrame(const std::vector<scene::CameraPtr>& cameras, const std::vector<scene::LightPtr>& lights)
+{
+	DEBUG_LOG_CALLSTK("animSystem.UpdateFrame");
+	COROUTINE_VARIABLES;
+	mModels.clear();
+	for (const auto& model : mRegistered)
+		mModels.push_back(model.get());
+	GatherLodCameras(cameras, lights);
+	ApplyLod();
+	GatherSharedPoses();
+
+	size_t jobCount = mModels.size() + mSharedPoseCount;
+	size_t batchCount = FLOOR_DIV(jobCount, kBatchSize);
+	if (batchCount > 1) {
+		std::vector<CoTask<void>> tasks;
+		tasks.reserve(batchCount);
+		for (size_t first = 0; first < jobCount; first += kBatchSize)
+			tasks.push_back(UpdateBatch(first, std::min<size_t>(first + kBatchSize, jobCount)));
+		CoAwait WhenAllReady(std::move(tasks));
+		CoAwait mResMng.SwitchToLaunchService(__LaunchSync__);
+	}
+	else {
+		UpdateJobs(0, jobCount);
+	}
+	mModels.clear();
+	mSharedRequests.clear();
+	CoReturn;
+}
+
+CoTask<void> AnimationSystem::UpdateBatch(size_t first, size_t last) ThreadSafe
+{
+	COROUTINE_VARIABLES_2(first, last);
+	CoAwait mResMng.SwitchToLaunchService(LaunchAsync);
+
+	UpdateJobs(first, last);
+	CoReturn;
+}
+
+}
+}
@@ -0,0 +1,83 @@
+#pragma once
+#include <boost/noncopyable.hpp>
+#include "core/mir_export.h"
+#include "core/predeclare.h"
+#include "core/base/cppcoro.h"
+#include "core/base/declare_macros.h"
+#include "core/base/math.h"
+#include "core/renderable/animation_player.h"
+
+namespace mir {
+namespace rend {
+
+/* evaluates the poses of the registered models in parallel batches on the resource thread pool, the scene registers
+ * the models of its nodes. a model that isn't registered evaluates its own pose in its UpdateFrame.
+ * models only touch their own pose and the shared (read-only) AiScene, palettes are still written by GenRenderOperation.
+ * models in shared pose mode are grouped by (scene, clip, time bucket), each group is evaluated once.
+ * with LOD on, models outside every camera and shadow casting light only advance time and small ones on screen update at a reduced rate. */
+class MIR_CORE_API AnimationSystem : boost::noncopyable
+{
+public:
+	enum { kBatchSize = 16, kSharedPoseFps = 30, kMaxLodInterval = 4 };
+	AnimationSystem(ResourceManager& resMng);
+	~AnimationSystem();
+	void Register(const AssimpModelPtr& model);
+	void Unregister(const AssimpModelPtr& model);
+	CoTask<void> UpdateFrame(const std::vector<scene::CameraPtr>& cameras, const std::vector<scene::LightPtr>& lights);
+	size_t ModelCount() const { return mRegistered.size(); }
+	size_t SharedPoseCount() const { return mSharedPoseCount; }
+
+	/* screen size is the projected height of the world AABB over the viewport height (or the shadow map's), the largest over all views.
+	 * below halfRate the pose updates every 2nd frame, below quarterRate every 4th */
+	void SetLodEnabled(bool enable) { mLodEnabled = enable; }
+	void SetLodScreenSizes(float halfRate, float quarterRate) { mLodScreenSizes = Eigen::Vector2f(halfRate, quarterRate); }
+	size_t HiddenCount() const { return mHiddenCount; }
+	size_t ReducedRateCount() const { return mReducedRateCount; }
+private:
+	struct LodCamera {
+		Eigen::Matrix4f ViewProjection;
+		unsigned CullingMask;
+	};
+	void GatherLodCameras(const std::vector<scene::CameraPtr>& cameras, const std::vector<scene::LightPtr>& lights);
+	int SelectLodInterval(const AssimpModel& model) const;
+	void ApplyLod();
+	struct SharedPoseKey {
+		const res::AiScene* Scene;
+		int ClipIndex, Bucket;
+		bool operator<(const SharedPoseKey& other) const {
+			return std::tie(Scene, ClipIndex, Bucket) < std::tie(other.Scene, other.ClipIndex, other.Bucket);
+		}
+		bool operator==(const SharedPoseKey& other) const {
+			return Scene == other.Scene && ClipIndex == other.ClipIndex && Bucket == other.Bucket;
+		}
+	};
+	/* pooled across frames, the player and buffers are rebuilt only when the scene or clip changes */
+	struct SharedPose {
+		void Setup(const res::AiScenePtr& scene, int clipIndex, float seconds);
+		void Evaluate();
+	public:
+		res::AiScenePtr Scene;
+		int ClipIndex = -1;
+		AnimationPlayer Player;
+		std::vector<Eigen::Matrix4f> LocalTransforms, GlobalTransforms;
+	};
+	void GatherSharedPoses();
+	void UpdateJobs(size_t first, size_t last) ThreadSafe;
+	CoTask<void> UpdateBatch(size_t first, size_t last) ThreadSafe;
+private:
+	ResourceManager& mResMng;
+	std::vector<AssimpModelPtr> mRegistered;
+	std::vector<AssimpModel*> mModels;//the models of the current frame
+	std::vector<std::pair<SharedPoseKey, AssimpModel*>> mSharedRequests;
+	std::vector<std::unique_ptr<SharedPose>> mSharedPoses;
+	size_t mSharedPoseCount = 0;
+
+	bool mLodEnabled = true;
+	Eigen::Vector2f mLodScreenSizes = Eigen::Vector2f(0.15f, 0.05f);
+	std::vector<LodCamera, mir_allocator<LodCamera>> mLodCameras;
+	size_t mFrameCount = 0, mHiddenCount = 0, mReducedRateCount = 0;
+	int mNextLodPhase = 0;
+};
+
+}
+}
@@ -0,0 +1,120 @@
+#include <boost/format.hpp>
+#include "core/base/debug.h"
+#include "core/base/data.h"
+#include "core/base/uniform_struct.h"
+#include "core/rendersys/texture.h"
+#include "core/renderable/animation_texture.h"
+#include "core/renderable/animation_player.h"
+#include "core/resource/animation_clip.h"
+#include "core/resource/resource_manager.h"
+
+namespace mir {
+namespace rend {
+
+static void WriteMatrix(std::vector<float>& texels, size_t texelOffset, const Eigen::Matrix4f& mat)
+{
+	//column k lands in texel k, the layout a matrix has in a constant buffer
+	memcpy(&texels[texelOffset * 4], mat.data(), sizeof(float) * 16);
+}
+
+/********** AnimationTexture **********/
+CoTask<bool> AnimationTexture::Bake(Launch launchMode, ResourceManager& resMng, res::AiScenePtr scene, int fps)
+{
+	COROUTINE_VARIABLES_3(launchMode, scene, fps);
+	CoAwait resMng.SwitchToLaunchService(launchMode);
+	TIME_PROFILE("animTexture.Bake");
+
+	mFps = std::max(fps, 1);
+	mMeshSlots.clear();
+	int matrixCount = 0;
+	for (const auto& node : scene->GetNodes()) {
+		for (const auto& mesh : node->GetMeshes()) {
+			mMeshSlots.push_back(MeshSlot{ node, mesh, matrixCount });
+			matrixCount += 1 + int(std::min<size_t>(mesh->GetBones().size(), cbWeightedSkin::kModelCount));
+		}
+	}
+
+	mClips.clear();
+	mRowCount = 0;
+	for (const auto& anim : scene->mAnimations) {
+		Clip clip;
+		clip.Seconds = (anim->GetTicksPerSecond() > 0.0f) ? anim->GetDuration() / anim->GetTicksPerSecond() : 0.0f;
+		clip.FrameCount = std::max(int(ceil(clip.Seconds * mFps)), 1);
+		clip.FirstRow = mRowCount;
+		mRowCount += clip.FrameCount;
+		mClips.push_back(clip);
+	}
+
+	mWidth = matrixCount * 4;
+	if (mRowCount == 0 || mWidth == 0 || mRowCount > kMaxSize || mWidth > kMaxSize) {
+		DEBUG_LOG_ERROR((boost::format("animTexture.Bake: %1% x %2% texels, a scene with clips and at most %3% texels per side is expected") % mWidth % mRowCount % kMaxSize).str());
+		CoAwait resMng.SwitchToLaunchService(__LaunchSync__);
+		CoReturn false;
+	}
+
+	std::vector<float> texels(size_t(mWidth) * mRowCount * 4);
+	for (size_t i = 0; i < mClips.size(); ++i)
+		BakeClip(scene, int(i), texels);
+
+	Data2 data = Data2::Make(texels.data(), texels.size() * sizeof(float), mWidth * 4 * sizeof(float));
+	mTexture = CoAwait resMng.CreateTextureByDataT(launchMode, kFormatR32G32B32A32Float, Eigen::Vector4i(mWidth, mRowCount, 1, 1), &data);
+	DEBUG_LOG_INFO((boost::format("animTexture.Bake: %1% clips, %2% matrices x %3% rows, %4% bytes")
+		% mClips.size() % matrixCount % mRowCount % (texels.size() * sizeof(float))).str());
+	CoAwait resMng.SwitchToLaunchService(__LaunchSync__);
+	CoReturn IsLoaded();
+}
+
+void AnimationTexture::BakeClip(const res::AiScenePtr& scene, int clipIndex, std::vector<float>& texels) const ThreadSafe
+{
+	const auto& skeleton = scene->GetSkeleton();
+	std::vector<Eigen::Matrix4f> locals(skeleton.Count()), globals(skeleton.Count());
+	AnimationPlayer player;
+	player.Init(scene, 1);
+	player.Play(clipIndex);
+
+	const Clip& clip = mClips[clipIndex];
+	for (int frame = 0; frame < clip.FrameCount; ++frame) {
+		player.SetTime(float(frame) / mFps);
+		player.Evaluate(locals);
+		skeleton.ComputeGlobals(locals, globals);
+
+		//same palette as AssimpModel::WriteBonePalette, with the node transform ahead of it
+		size_t rowTexel = size_t(clip.FirstRow + frame) * mWidth;
+		for (const auto& slot : mMeshSlots) {
+			const Eigen::Matrix4f& rootGlobal = globals[slot.Node->SerilizeIndex];
+			size_t texel = rowTexel + slot.MatrixBase * 4;
+			WriteMatrix(texels, texel, rootGlobal);
+
+			const auto& bones = slot.Mesh->GetBones();
+			size_t boneCount = std::min<size_t>(cbWeightedSkin::kModelCount, bones.size());
+			if (boneCount == 0) continue;
+
+			Eigen::Matrix4f rootGlobalInv = rootGlobal.inverse();
+			for (size_t i = 0; i < boneCount; ++i) {
+				const auto& bone = bones[i];
+				texel += 4;
+				if (bone.mNodeIndex >= 0) WriteMatrix(texels, texel, bone.mOffsetMatrix * (globals[bone.mNodeIndex] * rootGlobalInv));
+				else WriteMatrix(texels, texel, bone.mOffsetMatrix * rootGlobalInv);
+			}
+		}
+	}
+}
+
+Eigen::Vector3f AnimationTexture::GetFrame(int clipIndex, float seconds) const
+{
+	const Clip& clip = mClips[clipIndex];
+	float frame = (clip.Seconds > 0.0f) ? fmod(seconds, clip.Seconds) * mFps : 0.0f;
+	if (frame < 0.0f) frame += clip.Seconds * mFps;
+
+	int index = std::min(int(frame), clip.FrameCount - 1);
+	int next = (index + 1) % clip.FrameCount;
+	return Eigen::Vector3f(float(clip.FirstRow + index), float(clip.FirstRow + next), std::min(frame - index, 1.0f));
+}
+
+bool AnimationTexture::IsLoaded() const
+{
+	return mTexture && mTexture->IsLoaded();
+}
+
+}
+}
@@ -0,0 +1,50 @@
+#pragma once
+#include <boost/noncopyable.hpp>
+#include "core/mir_export.h"
+#include "core/predeclare.h"
+#include "core/base/cppcoro.h"
+#include "core/base/launch.h"
+#include "core/base/math.h"
+#include "core/base/declare_macros.h"
+#include "core/rendersys/predeclare.h"
+#include "core/resource/assimp_resource.h"
+
+namespace mir {
+namespace rend {
+
+/* every clip of an AiScene sampled at a fixed rate into one rgba32f texture, read by the ENABLE_BAKED_SKINNING shader variant.
+ * a row holds one frame of every mesh, the rows of a clip are contiguous and loop back to its first row.
+ * a mesh owns (1 + bone count) matrices from MatrixBase: its node's global transform, then its bone palette, 4 texels each. */
+class MIR_CORE_API AnimationTexture : boost::noncopyable
+{
+public:
+	enum { kDefaultFps = 30, kMaxSize = 16384, kTextureSlot = 9 };
+	struct Clip {
+		int FirstRow, FrameCount;
+		float Seconds;
+	};
+	struct MeshSlot {
+		res::AiNodePtr Node;
+		res::AssimpMeshPtr Mesh;
+		int MatrixBase;
+	};
+	CoTask<bool> Bake(Launch launchMode, ResourceManager& resMng, res::AiScenePtr scene, int fps = kDefaultFps);
+
+	/* (row, next row, lerp factor) of the clip at seconds, looping */
+	Eigen::Vector3f GetFrame(int clipIndex, float seconds) const;
+	const ITexturePtr& GetTexture() const { return mTexture; }
+	const std::vector<MeshSlot>& GetMeshSlots() const { return mMeshSlots; }
+	const std::vector<Clip>& GetClips() const { return mClips; }
+	int GetFps() const { return mFps; }
+	bool IsLoaded() const;
+private:
+	void BakeClip(const res::AiScenePtr& scene, int clipIndex, std::vector<float>& texels) const ThreadSafe;
+private:
+	ITexturePtr mTexture;
+	std::vector<MeshSlot> mMeshSlots;
+	std::vector<Clip> mClips;
+	int mFps = kDefaultFps, mWidth = 0, mRowCount = 0;
+};
+
+}
+}
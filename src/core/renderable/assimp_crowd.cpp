@@ -0,0 +1,143 @@
+#include <boost/assert.hpp>
+#include "core/base/debug.h"
+#include "core/base/macros.h"
+#include "core/scene/transform.h"
+#include "core/renderable/assimp_crowd.h"
+#include "core/resource/resource_manager.h"
+
+namespace mir {
+namespace rend {
+
+/********** AssimpCrowd **********/
+CoTask<bool> AssimpCrowd::LoadModel(std::string assetPath, std::string redirectResource, int bakeFps)
+{
+	if (!CoAwait mResMng.CreateAiScene(mAiScene, mLaunchMode, std::move(assetPath), std::move(redirectResource), mLoadParam)
+		|| !CoAwait mAnimTexture.Bake(mLaunchMode, mResMng, mAiScene, bakeFps)) {
+		CoAwait mResMng.SwitchToLaunchService(__LaunchSync__);
+		CoReturn false;
+	}
+	CoAwait mResMng.SwitchToLaunchService(__LaunchSync__);
+	COROUTINE_VARIABLES_3(assetPath, redirectResource, bakeFps);
+
+	//the mesh materials are shared with AssimpModel, the baked variant gets its own material
+	const auto& slots = mAnimTexture.GetMeshSlots();
+	mMeshDraws.resize(slots.size());
+	for (size_t i = 0; i < slots.size(); ++i) {
+		res::MaterialInstance baked = slots[i].Mesh->GetMaterial().ShallowClone();
+		baked.UpdateKeyword("ENABLE_BAKED_SKINNING");
+		CoAwait baked.CommitKeywords(mLaunchMode, mResMng);
+		baked.GetTextures().AddOrSet(mAnimTexture.GetTexture(), AnimationTexture::kTextureSlot);
+		mMeshDraws[i].BakedMaterial = baked;
+	}
+	CoReturn true;
+}
+
+size_t AssimpCrowd::AddInstance(const Eigen::Matrix4f& world, int clipIndex, float timeOffset)
+{
+	mInstances.push_back(Instance{ world, clipIndex, timeOffset });
+	SetInstanceWorld(mInstances.size() - 1, world);
+	return mInstances.size() - 1;
+}
+
+void AssimpCrowd::SetInstanceWorld(size_t index, const Eigen::Matrix4f& world)
+{
+	mInstances[index].World = world;
+	if (mAiScene) mAABB.extend(mAiScene->GetAABB().transformed(Transform3fAffine(world)));
+}
+
+void AssimpCrowd::SetInstanceClip(size_t index, int clipIndex, float timeOffset)
+{
+	mInstances[index].ClipIndex = clipIndex;
+	mInstances[index].TimeOffset = timeOffset;
+}
+
+void AssimpCrowd::ClearInstances()
+{
+	mInstances.clear();
+	mAABB = Eigen::AlignedBox3f();
+}
+
+void AssimpCrowd::GetMaterials(std::vector<res::MaterialInstance>& mtls) const
+{
+	for (const auto& draw : mMeshDraws) {
+		if (draw.BakedMaterial) mtls.push_back(draw.BakedMaterial);
+	}
+}
+
+CoTask<void> AssimpCrowd::UpdateFrame(float dt)
+{
+	COROUTINE_VARIABLES_1(dt);
+	CoAwait Super::UpdateFrame(dt);
+	mElapse += dt;
+	CoReturn;
+}
+
+void AssimpCrowd::WriteInstanceSlots()
+{
+	//row 3 of an affine world is (0, 0, 0, 1), it carries the frame instead, see Skeleton.cginc
+	const auto& clips = mAnimTexture.GetClips();
+	mInstanceSlots.resize(mInstances.size());
+	for (size_t i = 0; i < mInstances.size(); ++i) {
+		const Instance& inst = mInstances[i];
+		int clipIndex = (inst.ClipIndex >= 0 && size_t(inst.ClipIndex) < clips.size()) ? inst.ClipIndex : 0;
+		Eigen::Matrix4f& slot = mInstanceSlots[i];
+		slot = inst.World;
+		slot.block<1, 3>(3, 0) = mAnimTexture.GetFrame(clipIndex, mElapse + inst.TimeOffset).transpose();
+	}
+}
+
+res::MaterialInstance AssimpCrowd::CreateBatchMaterial(const res::MaterialInstance& bakedMaterial, const res::AssimpMesh& mesh) const
+{
+	res::MaterialInstance batch = bakedMaterial->CreateInstance(mLaunchMode, mResMng);
+	batch.GetTextures() = bakedMaterial.GetTextures();
+	if (mesh.IsCompactVertex()) {
+		const auto& quant = mesh.GetPositionQuantization();
+		batch.SetProperty("PositionQuantScale", quant.Scale);
+		batch.SetProperty("PositionQuantOffset", quant.Offset);
+	}
+	return batch;
+}
+
+void AssimpCrowd::GenRenderOperation(RenderOperationQueue& opList)
+{
+	if (mInstances.empty() || !mAnimTexture.IsLoaded())
+		return;
+
+	WriteInstanceSlots();
+	Eigen::Matrix4f world = Eigen::Matrix4f::Identity();
+	if (auto transform = GetTransform()) world = transform->GetWorldMatrix();
+
+	const size_t batchCount = FLOOR_DIV(mInstances.size(), size_t(kInstancePerDraw));
+	const auto& slots = mAnimTexture.GetMeshSlots();
+	for (size_t i = 0; i < slots.size(); ++i) {
+		const auto& mesh = slots[i].Mesh;
+		auto& draw = mMeshDraws[i];
+		if (!mesh->IsLoaded() || !draw.BakedMaterial) continue;
+
+		while (draw.Batches.size() < batchCount)
+			draw.Batches.push_back(CreateBatchMaterial(draw.BakedMaterial, *mesh));
+
+		for (size_t batch = 0; batch < batchCount; ++batch) {
+			size_t first = batch * kInstancePerDraw;
+			size_t count = std::min<size_t>(kInstancePerDraw, mInstances.size() - first);
+			res::MaterialInstance& mat = draw.Batches[batch];
+			ModelArray& models = mat.GetProperty(mModelsProperty);
+			for (size_t k = 0; k < count; ++k) {
+				models[k] = mInstanceSlots[first + k];
+				models[k](3, 3) = float(slots[i].MatrixBase);
+			}
+
+			RenderOperation op = {};
+			op.IndexBuffer = mesh->GetIndexBuffer();
+			op.AddVertexBuffer(mesh->GetVBOSurface());
+			op.AddVertexBuffer(mesh->GetVBOSkeleton());
+			op.Material = mat;
+			op.InstanceCount = int(count);
+			op.WorldTransform = world;
+			opList.AddOP(op);
+		}
+	}
+}
+
+}
+}
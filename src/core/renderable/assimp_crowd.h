@@ -0,0 +1,64 @@
+#pragma once
+#include "core/mir_export.h"
+#include "core/base/launch.h"
+#include "core/base/uniform_struct.h"
+#include "core/resource/assimp_resource.h"
+#include "core/renderable/animation_texture.h"
+#include "core/renderable/renderable_base.h"
+
+namespace mir {
+namespace rend {
+
+/* many instances of one animated AiScene, drawn instanced with the palettes baked into an AnimationTexture.
+ * an instance is only a world matrix, a clip and a time offset, per frame the CPU picks its two frame rows,
+ * skinning and frame blending run in the vertex shader. instances don't crossfade or layer clips. */
+class MIR_CORE_API AssimpCrowd : public RenderableSingleRenderOp
+{
+	typedef RenderableSingleRenderOp Super;
+public:
+	enum { kInstancePerDraw = cbWeightedSkin::kModelCount };
+	MIR_MAKE_ALIGNED_OPERATOR_NEW;
+	AssimpCrowd(Launch launchMode, ResourceManager& resMng, MaterialLoadParam mlp = "") :Super(launchMode, resMng, res::MaterialInstance()), mLoadParam(mlp) {}
+
+	CoTask<bool> LoadModel(std::string assetPath, std::string redirectResource = "", int bakeFps = AnimationTexture::kDefaultFps);
+	size_t AddInstance(const Eigen::Matrix4f& world, int clipIndex = 0, float timeOffset = 0.0f);
+	/* the crowd's bounds grow with every world set, ClearInstances resets them */
+	void SetInstanceWorld(size_t index, const Eigen::Matrix4f& world);
+	void SetInstanceClip(size_t index, int clipIndex, float timeOffset = 0.0f);
+	void ClearInstances();
+	size_t InstanceCount() const { return mInstances.size(); }
+	const AnimationTexture& GetAnimationTexture() const { return mAnimTexture; }
+
+	CoTask<void> UpdateFrame(float dt) override;
+	void GenRenderOperation(RenderOperationQueue& opList) override;
+	void GetMaterials(std::vector<res::MaterialInstance>& mtls) const override;
+private:
+	using ModelArray = std::array<Eigen::Matrix4f, cbWeightedSkin::kModelCount>;
+	struct Instance {
+		MIR_MAKE_ALIGNED_OPERATOR_NEW;
+		Eigen::Matrix4f World;
+		int ClipIndex;
+		float TimeOffset;
+	};
+	/* one material per draw, each carries the instance slots of its batch in Models */
+	struct MeshDraw {
+		res::MaterialInstance BakedMaterial;
+		std::vector<res::MaterialInstance> Batches;
+	};
+	void WriteInstanceSlots();
+	res::MaterialInstance CreateBatchMaterial(const res::MaterialInstance& bakedMaterial, const res::AssimpMesh& mesh) const;
+	bool IsMaterialEnabled() const override { return false; }
+private:
+	MaterialLoadParam mLoadParam;
+	res::AiScenePtr mAiScene;
+	AnimationTexture mAnimTexture;
+	std::vector<MeshDraw> mMeshDraws;//parallel to mAnimTexture.GetMeshSlots()
+	std::vector<Instance, mir_allocator<Instance>> mInstances;
+	std::vector<Eigen::Matrix4f, mir_allocator<Eigen::Matrix4f>> mInstanceSlots;
+	float mElapse = 0.0f;
+
+	res::PropertyHandle<ModelArray> mModelsProperty{ "Models" };
+};
+
+}
+}
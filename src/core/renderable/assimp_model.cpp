@@ -7,6 +7,7 @@
 #include "core/base/debug.h"
 #include "core/scene/transform.h"
 #include "core/renderable/assimp_model.h"
+#include "core/renderable/cluster_culler.h"
 #include "core/resource/resource_manager.h"
 #include "core/resource/assimp_factory.h"
 
@@ -15,113 +16,6 @@ namespace rend {
 
 #define AS_CONST_REF(TYPE, V) *(const TYPE*)(&V)
 #define AS_REF(TYPE, V) *(TYPE*)(&V)
-struct EvaluateTransforms
-{
-public:
-	std::vector<Eigen::Matrix4f> mTransforms;
-	const aiAnimation* mAnim;
-public:
-	EvaluateTransforms(const aiAnimation* Anim) :mAnim(Anim) {}
-	void Update(float pTime) 
-	{
-		double ticksPerSecond = mAnim->mTicksPerSecond != 0.0 ? mAnim->mTicksPerSecond : 25.0;
-		pTime *= ticksPerSecond;
-
-		// map into anim's duration
-		double time = 0.0f;
-		if (mAnim->mDuration > 0.0) {
-			time = fmod(pTime, mAnim->mDuration);
-		}
-
-		mTransforms.resize(mAnim->mNumChannels);
-
-		for (unsigned int channelIndex = 0; channelIndex < mAnim->mNumChannels; ++channelIndex) {
-			const aiNodeAnim* channel = mAnim->mChannels[channelIndex];
-
-			// ******** Position *****
-			aiVector3D presentPosition(0, 0, 0);
-			if (channel->mNumPositionKeys > 0) {
-				// Look for present frame number. Search from last position if time is after the last time, else from beginning
-				// Should be much quicker than always looking from start for the average use case.
-				unsigned int frame = 0;
-				while (frame < channel->mNumPositionKeys - 1) {
-					if (time < channel->mPositionKeys[frame + 1].mTime) {
-						break;
-					}
-					++frame;
-				}
-
-				// interpolate between this frame's value and next frame's value
-				unsigned int nextFrame = (frame + 1) % channel->mNumPositionKeys;
-				const aiVectorKey& key = channel->mPositionKeys[frame];
-				const aiVectorKey& nextKey = channel->mPositionKeys[nextFrame];
-				double diffTime = nextKey.mTime - key.mTime;
-				if (diffTime < 0.0) {
-					diffTime += mAnim->mDuration;
-				}
-				if (diffTime > 0) {
-					float factor = float((time - key.mTime) / diffTime);
-					presentPosition = key.mValue + (nextKey.mValue - key.mValue) * factor;
-				}
-				else {
-					presentPosition = key.mValue;
-				}
-			}
-
-			// ******** Rotation *********
-			aiQuaternion presentRotation(1, 0, 0, 0);
-			if (channel->mNumRotationKeys > 0) {
-				unsigned int frame = 0;
-				while (frame < channel->mNumRotationKeys - 1) {
-					if (time < channel->mRotationKeys[frame + 1].mTime) {
-						break;
-					}
-					++frame;
-				}
-
-				// interpolate between this frame's value and next frame's value
-				unsigned int nextFrame = (frame + 1) % channel->mNumRotationKeys;
-				const aiQuatKey& key = channel->mRotationKeys[frame];
-				const aiQuatKey& nextKey = channel->mRotationKeys[nextFrame];
-				double diffTime = nextKey.mTime - key.mTime;
-				if (diffTime < 0.0) {
-					diffTime += mAnim->mDuration;
-				}
-				if (diffTime > 0) {
-					float factor = float((time - key.mTime) / diffTime);
-					aiQuaternion::Interpolate(presentRotation, key.mValue, nextKey.mValue, factor);
-				}
-				else {
-					presentRotation = key.mValue;
-				}
-			}
-
-			// ******** Scaling **********
-			aiVector3D presentScaling(1, 1, 1);
-			if (channel->mNumScalingKeys > 0) {
-				unsigned int frame = 0;
-				while (frame < channel->mNumScalingKeys - 1) {
-					if (time < channel->mScalingKeys[frame + 1].mTime) {
-						break;
-					}
-					++frame;
-				}
-
-				// TODO: (thom) interpolation maybe? This time maybe even logarithmic, not linear
-				presentScaling = channel->mScalingKeys[frame].mValue;
-			}
-
-			// build a transformation matrix from it
-			aiMatrix4x4& mat = (aiMatrix4x4&)mTransforms[channelIndex];
-			mat = aiMatrix4x4(presentRotation.GetMatrix());
-			mat.a1 *= presentScaling.x; mat.b1 *= presentScaling.x; mat.c1 *= presentScaling.x;
-			mat.a2 *= presentScaling.y; mat.b2 *= presentScaling.y; mat.c2 *= presentScaling.y;
-			mat.a3 *= presentScaling.z; mat.b3 *= presentScaling.z; mat.c3 *= presentScaling.z;
-			mat.a4 = presentPosition.x; mat.b4 = presentPosition.y; mat.c4 = presentPosition.z;
-		}
-	}
-};
-
 /********** AssimpModel **********/
 CoTask<bool> AssimpModel::LoadModel(std::string assetPath, std::string redirectResource)
 {
@@ -133,48 +27,23 @@ CoTask<bool> AssimpModel::LoadModel(std::string assetPath, std::string redirectR
 
 	COROUTINE_VARIABLES_2(assetPath, redirectResource);
 	mAABB = mAiScene->GetAABB();
-	mAnimeTree.Init(mAiScene->GetNodes());
+	mAnimePose.Init(mAiScene->GetSkeleton());
+	mAnimPlayer.Init(mAiScene);
 	CoAwait UpdateFrame(0);
+	if (mAnimSystem) UpdateAnimation();
 	CoReturn true;
 }
 
-const std::vector<Eigen::Matrix4f>& AssimpModel::GetBoneMatrices(const res::AiNodePtr& node, const res::AssimpMeshPtr& mesh)
+void AssimpModel::WriteBonePalette(const res::AssimpMeshPtr& mesh, const Eigen::Matrix4f& rootGlobalInv, ModelArray& models) const
 {
-	auto& animRoot = mAnimeTree.GetNode(node);
-	aiMatrix4x4 rootGlobalTransformInv = AS_REF(aiMatrix4x4, animRoot.GlobalTransform);
-	rootGlobalTransformInv.Inverse();
-
-	auto& bones = mesh->GetBones();
-	mTempBoneMatrices.resize(bones.size());
-	for (size_t i = 0; i < bones.size(); ++i) {
+	//aiMatrix4x4 memory viewed as Eigen is the transpose, palette = (rootInv * boneGlobal * offset)^T
+	const auto& globals = GetGlobalTransforms();
+	const auto& bones = mesh->GetBones();
+	size_t boneCount = std::min<size_t>(cbWeightedSkin::kModelCount, bones.size());
+	for (size_t i = 0; i < boneCount; ++i) {
 		const auto& bone = bones[i];
-		res::AiNodePtr boneNode = bone.mRelateNode.lock();
-		if (boneNode) {
-			auto& animNode = mAnimeTree.GetNode(boneNode);
-			const aiMatrix4x4& nodeGlobalTransform = AS_CONST_REF(aiMatrix4x4, animNode.GlobalTransform);
-			AS_REF(aiMatrix4x4, mTempBoneMatrices[i]) = rootGlobalTransformInv * nodeGlobalTransform * AS_CONST_REF(aiMatrix4x4, bone.mOffsetMatrix);
-		}
-		else {
-			AS_REF(aiMatrix4x4, mTempBoneMatrices[i]) = rootGlobalTransformInv * AS_CONST_REF(aiMatrix4x4, bone.mOffsetMatrix);
-		}
-	}
-	return mTempBoneMatrices;
-}
-
-void VisitNode(const res::AiNodePtr& curNode, const AiAnimeTree& animeTree, std::vector<res::AiNodePtr>& nodeVec, EvaluateTransforms& eval)
-{
-	nodeVec.push_back(curNode);
-
-	auto& curAnimeNode = animeTree.GetNode(curNode);
-	if (curAnimeNode.ChannelIndex >= 0 && curAnimeNode.ChannelIndex < eval.mTransforms.size()) {
-		curAnimeNode.LocalTransform = eval.mTransforms[curAnimeNode.ChannelIndex];
-	}
-	else {
-		curAnimeNode.LocalTransform = (curNode->GetLocalTransform());
-	}
-
-	for (const auto& child : curNode->GetChildren()) {
-		VisitNode(child, animeTree, nodeVec, eval);
+		if (bone.mNodeIndex >= 0) models[i].noalias() = bone.mOffsetMatrix * (globals[bone.mNodeIndex] * rootGlobalInv);
+		else models[i].noalias() = bone.mOffsetMatrix * rootGlobalInv;
 	}
 }
 
@@ -206,62 +75,179 @@ CoTask<void> AssimpModel::UpdateFrame(float dt)
 	}
 #endif
 
-	std::vector<res::AiNodePtr> nodeVec;
-	if (mCurrentAnimIndex < 0 || mCurrentAnimIndex >= mAiScene->mAnimations.size()) {
-		std::queue<res::AiNodePtr> nodeQue;
-		nodeQue.push(mAiScene->mRootNode);
-		while (!nodeQue.empty()) {
-			res::AiNodePtr curNode = nodeQue.front();
-			nodeQue.pop();
-			nodeVec.push_back(curNode);
-			for (int i = 0; i < curNode->ChildCount(); ++i)
-				nodeQue.push(curNode->Children[i]);
-		}
+	//a registered model's pose is evaluated later by AnimationSystem, batched with the other models
+	mPendingAnimTime += dt;
+	if (mAnimSystem == nullptr)
+		UpdateAnimation();
+	CoReturn;
+}
+
+void AssimpModel::UpdateAnimation() ThreadSafe
+{
+	if (mAiScene == nullptr || !mAiScene->IsLoaded() || !mAnimePose.IsInited()) return;
+
+	mSharedGlobals = nullptr;
+	if (mLodStep > 0) {
+		LerpPose(std::min(float(mLodStep + 1) / mLodInterval, 1.0f));
+		return;
 	}
-	else {
-		const aiAnimation* aiAnim = mAiScene->mAnimations[mCurrentAnimIndex];
-		EvaluateTransforms eval(aiAnim);
 
-		mElapse += dt;
-		eval.Update(mElapse);
+	float dt = mPendingAnimTime;
+	mPendingAnimTime = 0.0f;
 
-		VisitNode(mAiScene->mRootNode, mAnimeTree, nodeVec, eval);
+	const auto& skeleton = mAiScene->GetSkeleton();
+	auto& locals = mAnimePose.LocalTransforms;
+	if (mAnimPlayer.IsPlaying()) {
+		mAnimPlayer.Advance(dt);
+		mAnimPlayer.Evaluate(locals);
 	#if defined ROOT_TPOSE_IDENTITY
-		auto& nodeInfo = mAnimeTree.GetNode(mAiScene->mRootNode);
-		nodeInfo.LocalTransform = aiMatrix4x4();
+		locals[0] = Eigen::Matrix4f::Identity();
 	#endif
 	}
+	else {
+		std::copy(skeleton.LocalTransforms.begin(), skeleton.LocalTransforms.end(), locals.begin());
+	}
 
-	for (res::AiNodePtr curNode : nodeVec) {
-		auto& curAnimNode = mAnimeTree.GetNode(curNode);
-		curAnimNode.GlobalTransform = curAnimNode.LocalTransform;
-		res::AiNodePtr iterNode = curNode->Parent.lock();
-		while (iterNode) {
-			auto& iterANode = mAnimeTree.GetNode(iterNode);
-			curAnimNode.GlobalTransform = iterANode.LocalTransform * curAnimNode.GlobalTransform;
-			iterNode = iterNode->Parent.lock();
-		}
+	skeleton.ComputeGlobals(locals, mAnimePose.GlobalTransforms);
+
+	auto& pose = mAnimePose;
+	if (mPaletteLerp && mLodInterval > 1) {
+		if (mLerpReady) pose.LerpFrom.swap(pose.LerpTo);
+		else pose.LerpFrom = pose.GlobalTransforms;
+		pose.LerpTo = pose.GlobalTransforms;
+		mLerpReady = true;
+		LerpPose(1.0f / mLodInterval);
 	}
-	CoReturn;
+	else {
+		mLerpReady = false;
+	}
+}
+
+void AssimpModel::LerpPose(float factor) ThreadSafe
+{
+	//a linear blend of the matrices, the frames are close enough for it on distant models
+	auto& pose = mAnimePose;
+	for (size_t i = 0; i < pose.GlobalTransforms.size(); ++i)
+		pose.GlobalTransforms[i] = pose.LerpFrom[i] + (pose.LerpTo[i] - pose.LerpFrom[i]) * factor;
 }
 
-void AssimpModel::PlayAnim(int Index)
+bool AssimpModel::BeginAnimationLod(int interval, size_t frame)
+{
+	if (interval <= 0) {
+		//nobody sees it, keep the clips running so it reappears in time
+		mAnimPlayer.Advance(mPendingAnimTime);
+		mPendingAnimTime = 0.0f;
+		mSharedGlobals = nullptr;
+		mLodInterval = 0;
+		mLerpReady = false;
+		return false;
+	}
+	//shared poses are evaluated once per group already
+	if (mSharedPoseEnabled && mAnimPlayer.IsSingleClip())
+		interval = 1;
+
+	bool due = (mLodInterval != interval) || ((frame + std::max(mLodPhase, 0)) % interval == 0);
+	mLodInterval = interval;
+	mLodStep = due ? 0 : mLodStep + 1;
+	return due || (mPaletteLerp && mLerpReady);
+}
+
+bool AssimpModel::AdvanceSharedPose(int& clipIndex, float& seconds) ThreadSafe
+{
+	if (!mSharedPoseEnabled || !mAnimePose.IsInited() || !mAnimPlayer.IsSingleClip()) 
+		return false;
+
+	mAnimPlayer.Advance(mPendingAnimTime);
+	mPendingAnimTime = 0.0f;
+	clipIndex = mAnimPlayer.GetClipIndex(0);
+	seconds = mAnimPlayer.GetTime(0) + mSharedTimeOffset;
+	return true;
+}
+
+void AssimpModel::SetSharedPose(bool enable, float timeOffset)
+{
+	mSharedPoseEnabled = enable;
+	mSharedTimeOffset = timeOffset;
+	if (!enable) mSharedGlobals = nullptr;
+}
+
+void AssimpModel::PlayAnim(int Index, float fadeSeconds, size_t layer)
 {
 	BOOST_ASSERT(mAiScene->IsLoaded());
 	if (mAiScene == nullptr || !mAiScene->IsLoaded()) return;
 
-	mCurrentAnimIndex = Index;
-	mElapse = 0;
-	if (mCurrentAnimIndex < 0 || mCurrentAnimIndex >= mAiScene->mAnimations.size()) return;
-
-	const aiAnimation* currentAnim = mAiScene->mAnimations[mCurrentAnimIndex];
-	for (auto& node : mAiScene->GetNodes()) {
-		const std::string& nodeName = node->mName;
-		for (unsigned int channelIndex = 0; channelIndex < currentAnim->mNumChannels; channelIndex++) {
-			if (currentAnim->mChannels[channelIndex]->mNodeName.C_Str() == nodeName) {
-				mAnimeTree.GetNode(node).ChannelIndex = channelIndex;
-				break;
+	mAnimPlayer.Play(Index, fadeSeconds, layer);
+}
+
+Eigen::Matrix4f AssimpModel::GetNodeModel(const res::AiNode& node) const
+{
+	const auto& rootGlobal = GetGlobalTransforms()[node.SerilizeIndex];
+#if defined EIGEN_DONT_ALIGN_STATICALLY
+	return AS_CONST_REF(Eigen::Matrix4f, rootGlobal);
+#else
+	Eigen::Matrix4f rootModel;
+	const auto& s = AS_CONST_REF(aiMatrix4x4, rootGlobal);
+	rootModel <<
+		s.a1, s.b1, s.c1, s.d1,
+		s.a2, s.b2, s.c2, s.d2,
+		s.a3, s.b3, s.c3, s.d3,
+		s.a4, s.b4, s.c4, s.d4;
+	return rootModel;
+#endif
+}
+
+void AssimpModel::CullClusters(ClusterCuller& culler)
+{
+	if (!mClusterCulling) {
+		mClusterDraws.clear();
+		return;
+	}
+	if (mAiScene == nullptr || !mAiScene->IsLoaded() || !mAnimePose.IsInited())
+		return;
+
+	Eigen::Matrix4f world = Eigen::Matrix4f::Identity();
+	if (auto transform = GetTransform())
+		world = transform->GetWorldMatrix();
+	for (const auto& node : mAiScene->GetNodes()) {
+		Eigen::Matrix4f model;
+		bool hasModel = false;
+		for (const auto& mesh : node->GetMeshes()) {
+			const auto& clusters = mesh->GetClusters();
+			if (clusters.empty() || !mesh->IsLoaded())
+				continue;
+			if (!hasModel) {
+				model = world * GetNodeModel(*node).transpose();
+				hasModel = true;
+			}
+
+			ClusterDraw& draw = mClusterDraws[mesh.get()];
+			size_t visibleCount = culler.Cull(clusters, model, GetCameraMask(), IsCastShadow(), mClusterVisible);
+			if (visibleCount == draw.VisibleCount && mClusterVisible == draw.Visible)
+				continue;
+			draw.Visible.swap(mClusterVisible);
+			draw.VisibleCount = visibleCount;
+			if (visibleCount == 0 || visibleCount == clusters.size())
+				continue;
+
+			//the clusters kept are compacted in mesh order, the dynamic buffer is as large as the mesh's
+			const auto& indices = mesh->GetIndices();
+			const bool index16 = FitsIndex16(mesh->GetVertexCount());
+			if (index16) draw.Indices16.resize(indices.size());
+			else draw.Indices.resize(indices.size());
+			draw.IndexCount = 0;
+			for (size_t i = 0; i < clusters.size(); ++i) {
+				if (!draw.Visible[i]) continue;
+				const auto& cluster = clusters[i];
+				if (index16) NarrowIndices(&indices[cluster.IndexPos], cluster.IndexCount, &draw.Indices16[draw.IndexCount]);
+				else memcpy(&draw.Indices[draw.IndexCount], &indices[cluster.IndexPos], cluster.IndexCount * sizeof(uint32_t));
+				draw.IndexCount += cluster.IndexCount;
+			}
+			if (draw.IndexBuffer == nullptr) {
+				draw.IndexBuffer = mResMng.CreateIndexBuffer(mLaunchMode, mesh->GetVertexArray(), index16 ? kFormatR16UInt : kFormatR32UInt, 
+					index16 ? Data::MakeSize(draw.Indices16) : Data::MakeSize(draw.Indices));
+				DEBUG_SET_PRIV_DATA(draw.IndexBuffer, "assimp_model.cluster_index");
 			}
+			draw.Dirty = true;
 		}
 	}
 }
@@ -269,42 +255,23 @@ void AssimpModel::PlayAnim(int Index)
 void AssimpModel::DoDraw(const res::AiNodePtr& node, RenderOperationQueue& ops)
 {
 	if (node->MeshCount() > 0) {
-		auto& rootAnimeNode = mAnimeTree.GetNode(node);
-
-	#if defined EIGEN_DONT_ALIGN_STATICALLY
-		const auto& rootModel = AS_CONST_REF(Eigen::Matrix4f, rootAnimeNode.GlobalTransform);
-	#else
-		Eigen::Matrix4f rootModel;
-		const auto& s = rootAnimeNode.GlobalTransform;
-		rootModel <<
-			s.a1, s.b1, s.c1, s.d1,
-			s.a2, s.b2, s.c2, s.d2,
-			s.a3, s.b3, s.c3, s.d3,
-			s.a4, s.b4, s.c4, s.d4;
-	#endif
+		const auto& rootGlobal = GetGlobalTransforms()[node->SerilizeIndex];
+		const Eigen::Matrix4f rootModel = GetNodeModel(*node);
+		Eigen::Matrix4f rootGlobalInv;
+		bool hasRootInv = false;
 		for (const auto& mesh : node->GetMeshes()) 
 		{
 			res::MaterialInstance mat = mesh->GetMaterial();
 
-			mat.SetProperty<Eigen::Matrix4f>("Model", rootModel);
+			mat.SetProperty(mModelProperty, rootModel);
 
-			using ModelArray56 = std::array<Eigen::Matrix4f, 56>;
-			ModelArray56& models = mat.GetProperty<ModelArray56>("Models");
+			ModelArray& models = mat.GetProperty(mModelsProperty);
 			if (mesh->HasBones()) {
-				const auto& boneMats = GetBoneMatrices(node, mesh);
-				size_t boneCount = boneMats.size(); 
-				for (int j = 0; j < std::min<int>(cbWeightedSkin::kModelCount, boneCount); ++j) {
-				#if defined EIGEN_DONT_ALIGN_STATICALLY
-					models[j] = AS_CONST_REF(Eigen::Matrix4f, boneMats[j]);
-				#else
-					const auto& s = boneMatArr[j];
-					models[j] <<
-						s.a1, s.b1, s.c1, s.d1,
-						s.a2, s.b2, s.c2, s.d2,
-						s.a3, s.b3, s.c3, s.d3,
-						s.a4, s.b4, s.c4, s.d4;
-				#endif
+				if (!hasRootInv) {
+					rootGlobalInv = rootGlobal.inverse();
+					hasRootInv = true;
 				}
+				WriteBonePalette(mesh, rootGlobalInv, models);
 			}
 			else {
 				models[0] = Eigen::Matrix4f::Identity();
@@ -313,6 +280,21 @@ void AssimpModel::DoDraw(const res::AiNodePtr& node, RenderOperationQueue& ops)
 			if (mesh->IsLoaded()) {
 				RenderOperation op = {};
 				op.IndexBuffer = mesh->GetIndexBuffer();
+				auto clusterDraw = mClusterDraws.find(mesh.get());
+				if (clusterDraw != mClusterDraws.end()) {
+					ClusterDraw& draw = clusterDraw->second;
+					if (draw.VisibleCount == 0)
+						continue;
+					if (draw.VisibleCount < mesh->GetClusters().size() && draw.IndexBuffer->IsLoaded()) {
+						if (draw.Dirty) {
+							draw.Dirty = false;
+							mResMng.UpdateBuffer(draw.IndexBuffer, FitsIndex16(mesh->GetVertexCount())
+								? Data::Make(&draw.Indices16[0], draw.IndexCount * sizeof(uint16_t)) : Data::Make(&draw.Indices[0], draw.IndexCount * sizeof(uint32_t)));
+						}
+						op.IndexBuffer = draw.IndexBuffer;
+						op.IndexCount = draw.IndexCount;
+					}
+				}
 				op.AddVertexBuffer(mesh->GetVBOSurface());
 				op.AddVertexBuffer(mesh->GetVBOSkeleton());
 				op.Material = mat;
@@ -328,7 +310,7 @@ void AssimpModel::DoDraw(const res::AiNodePtr& node, RenderOperationQueue& ops)
 void AssimpModel::GenRenderOperation(RenderOperationQueue& opList)
 {
 	if (!mAiScene->IsLoaded()
-		|| !mAnimeTree.IsInited())
+		|| !mAnimePose.IsInited())
 		return;
 
 	int position = opList.Count();
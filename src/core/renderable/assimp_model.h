@@ -1,55 +1,29 @@
 #pragma once
+#include <unordered_map>
 #include "core/mir_export.h"
 #include "core/base/launch.h"
 #include "core/base/uniform_struct.h"
 #include "core/resource/assimp_resource.h"
+#include "core/renderable/animation_player.h"
 #include "core/renderable/renderable_base.h"
 
 namespace mir {
 namespace rend {
 
-struct AiAnimeNode 
+/* per-instance pose over the flattened skeleton, all arrays indexed by node SerilizeIndex */
+struct AiAnimePose
 {
 public:
-	void Init(size_t serializeIndex, const res::AiNodePtr& node) {
-		SerilizeIndex = serializeIndex;
-		ChannelIndex = -1;
-		LocalTransform = GlobalTransform = node->GetLocalTransform();
-	}
-public:
-	size_t SerilizeIndex;
-	int ChannelIndex;
-	Eigen::Matrix4f LocalTransform, GlobalTransform;
-};
-struct AiAnimeTree 
-{
-public:
-	void Init(const std::vector<res::AiNodePtr>& serializeNodes) {
-		mNodeBySerializeIndex.assign(serializeNodes.begin(), serializeNodes.end());
-		mAnimeNodes.resize(serializeNodes.size());
-		for (size_t i = 0; i < serializeNodes.size(); ++i)
-			mAnimeNodes[i].Init(i, serializeNodes[i]);
-	}
-	AiAnimeNode& GetNode(const res::AiNodePtr& node) const  {
-		return mAnimeNodes[node->SerilizeIndex];
-	}
-	AiAnimeNode& GetParent(AiAnimeNode& anode) const  {
-		size_t parentIndex = mNodeBySerializeIndex[anode.SerilizeIndex]->SerilizeIndex;
-		return mAnimeNodes[parentIndex];
-	}
-	AiAnimeNode& GetChild(AiAnimeNode& anode, size_t index) const  {
-		res::AiNodePtr child = mNodeBySerializeIndex[anode.SerilizeIndex]->Children[index];
-		return mAnimeNodes[child->SerilizeIndex];
-	}
-	size_t GetChildCount(AiAnimeNode& node) const {
-		return mNodeBySerializeIndex[node.SerilizeIndex]->ChildCount();
+	void Init(const res::AiSkeleton& skeleton) {
+		LocalTransforms = skeleton.LocalTransforms;
+		GlobalTransforms.resize(skeleton.Count());
 	}
 	bool IsInited() const {
-		return ! mNodeBySerializeIndex.empty();
+		return !GlobalTransforms.empty();
 	}
 public:
-	mutable std::vector<AiAnimeNode> mAnimeNodes;
-	std::vector<res::AiNodePtr> mNodeBySerializeIndex;
+	std::vector<Eigen::Matrix4f> LocalTransforms, GlobalTransforms;
+	std::vector<Eigen::Matrix4f> LerpFrom, LerpTo;//the last two evaluated globals, for palette interpolation
 };
 
 class MIR_CORE_API AssimpModel : public RenderableSingleRenderOp 
@@ -60,23 +34,77 @@ public:
 	AssimpModel(Launch launchMode, ResourceManager& resMng, MaterialLoadParam mlp = "") :Super(launchMode, resMng, res::MaterialInstance()) ,mLoadParam(mlp) {}
 	
 	CoTask<bool> LoadModel(std::string assetPath, std::string redirectResource = "");
-	void PlayAnim(int Index);
+	void PlayAnim(int Index, float fadeSeconds = 0.0f, size_t layer = 0);
+	AnimationPlayer& GetAnimPlayer() { return mAnimPlayer; }
 
 	CoTask<void> UpdateFrame(float dt) override;
+	/* advances the animation by the time queued in UpdateFrame and evaluates the pose, 
+	 * only touches this model so AnimationSystem runs it on worker threads */
+	void UpdateAnimation() ThreadSafe;
+	/* set by AnimationSystem::Register, a model without a system evaluates its pose in UpdateFrame */
+	void SetAnimationSystem(AnimationSystem* system) { mAnimSystem = system; }
+	AnimationSystem* GetAnimationSystem() const { return mAnimSystem; }
+
+	/* opt-in crowd mode, while a single clip plays on the base layer the pose is shared by every instance
+	 * of the same scene and clip whose time (plus timeOffset) falls into the same AnimationSystem time bucket */
+	void SetSharedPose(bool enable, float timeOffset = 0.0f);
+	bool AdvanceSharedPose(int& clipIndex, float& seconds) ThreadSafe;
+	void SetSharedGlobals(const std::vector<Eigen::Matrix4f>* globals) { mSharedGlobals = globals; }
+	const res::AiScenePtr& GetAiScene() const { return mAiScene; }
+
+	/* animation LOD, AnimationSystem picks an update interval every frame: 0 when no camera or shadow map sees the model, its clips only 
+	 * advance, n > 1 evaluates the pose every n-th frame (staggered by phase) and the time accumulates in between.
+	 * with palette interpolation the frames in between blend the last two poses, the pose lags by one interval */
+	void SetPaletteInterpolation(bool enable) { mPaletteLerp = enable; }
+	int GetAnimationLodPhase() const { return mLodPhase; }
+	void SetAnimationLodPhase(int phase) { mLodPhase = phase; }
+	/* returns whether UpdateAnimation has to run this frame */
+	bool BeginAnimationLod(int interval, size_t frame);
+
+	/* cluster culling of the static meshes built with MeshOptimizer::kOptimizeCluster, ClusterCuller calls CullClusters every frame.
+	 * a partly visible mesh draws the clusters kept from its dynamic index buffer, a mesh without any isn't drawn */
+	void SetClusterCulling(bool enable) { mClusterCulling = enable; }
+	void CullClusters(ClusterCuller& culler);
 	void GenRenderOperation(RenderOperationQueue& opList) override;
 	void GetMaterials(std::vector<res::MaterialInstance>& mtls) const override;
 private:
-	const std::vector<Eigen::Matrix4f>& GetBoneMatrices(const res::AiNodePtr& node, const res::AssimpMeshPtr& mesh);
+	using ModelArray = std::array<Eigen::Matrix4f, cbWeightedSkin::kModelCount>;
+	void WriteBonePalette(const res::AssimpMeshPtr& mesh, const Eigen::Matrix4f& rootGlobalInv, ModelArray& models) const;
 	void DoDraw(const res::AiNodePtr& node, RenderOperationQueue& opList);
+	/* the Model property of the node's meshes, the shader places them with World * Model^T */
+	Eigen::Matrix4f GetNodeModel(const res::AiNode& node) const;
+	void LerpPose(float factor) ThreadSafe;
+	const std::vector<Eigen::Matrix4f>& GetGlobalTransforms() const { return mSharedGlobals ? *mSharedGlobals : mAnimePose.GlobalTransforms; }
 	bool IsMaterialEnabled() const override { return false; }
 private:
 	MaterialLoadParam mLoadParam;
 	res::AiScenePtr mAiScene;
-	AiAnimeTree mAnimeTree;
+	AiAnimePose mAnimePose;
+
+	AnimationPlayer mAnimPlayer;
+	float mPendingAnimTime = 0.0f;
+	AnimationSystem* mAnimSystem = nullptr;
+	bool mSharedPoseEnabled = false;
+	float mSharedTimeOffset = 0.0f;
+	const std::vector<Eigen::Matrix4f>* mSharedGlobals = nullptr;
+	bool mPaletteLerp = false, mLerpReady = false;
+	int mLodInterval = 1, mLodStep = 0, mLodPhase = -1;
+
+	struct ClusterDraw {
+		std::vector<bool> Visible;
+		size_t VisibleCount = 0;//0 skips the mesh, all of them draws its own index buffer
+		std::vector<uint32_t> Indices;
+		std::vector<uint16_t> Indices16;
+		int IndexCount = 0;
+		IIndexBufferPtr IndexBuffer;
+		bool Dirty = false;
+	};
+	bool mClusterCulling = true;
+	std::unordered_map<const res::AssimpMesh*, ClusterDraw> mClusterDraws;
+	std::vector<bool> mClusterVisible;
 
-	int mCurrentAnimIndex = -1;
-	float mElapse = 0.0f;
-	std::vector<Eigen::Matrix4f> mTempBoneMatrices;
+	res::PropertyHandle<Eigen::Matrix4f> mModelProperty{ "Model" };
+	res::PropertyHandle<ModelArray> mModelsProperty{ "Models" };
 };
 
 }
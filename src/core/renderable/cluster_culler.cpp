@@ -0,0 +1,112 @@
+#include "core/base/debug.h"
+#include "core/renderable/cluster_culler.h"
+#include "core/renderable/assimp_model.h"
+#include "core/scene/camera.h"
+#include "core/scene/light.h"
+
+namespace mir {
+namespace rend {
+
+/********** ClusterCuller **********/
+void ClusterCuller::GatherViews(const std::vector<scene::CameraPtr>& cameras, const std::vector<scene::LightPtr>& lights)
+{
+	mViews.clear();
+	for (const auto& camera : cameras) {
+		if (camera == nullptr) continue;
+		View view;
+		view.ViewProjection = camera->GetProjection() * camera->GetView();
+		view.Eye = camera->GetView().inverse().block<3, 1>(0, 3);
+		view.CullingMask = camera->GetCullingMask();
+		view.ConeTest = camera->GetType() == kCameraPerspective;
+		view.ShadowCaster = false;
+		mViews.push_back(view);
+	}
+	for (const auto& light : lights) {
+		if (light == nullptr || !light->DidCastShadow()) continue;
+		View view;
+		view.ViewProjection = light->GetCastShadowProj() * light->GetView();
+		view.Eye = Eigen::Vector3f::Zero();
+		view.CullingMask = light->GetCameraMask();
+		view.ConeTest = false;
+		view.ShadowCaster = true;
+		mViews.push_back(view);
+	}
+}
+
+void ClusterCuller::UpdateFrame(const std::vector<scene::CameraPtr>& cameras, const std::vector<scene::LightPtr>& lights)
+{
+	DEBUG_LOG_CALLSTK("clusterCuller.UpdateFrame");
+	GatherViews(cameras, lights);
+	mClusterCount = mVisibleCount = 0;
+	for (auto model : mModels)
+		model->CullClusters(*this);
+	mModels.clear();
+}
+
+size_t ClusterCuller::Cull(const std::vector<res::MeshCluster>& clusters, const Eigen::Matrix4f& model, unsigned cameraMask, bool castShadow, std::vector<bool>& visible)
+{
+	mClusterCount += clusters.size();
+	if (!mEnabled || mViews.empty()) {
+		visible.assign(clusters.size(), true);
+		mVisibleCount += clusters.size();
+		return clusters.size();
+	}
+
+	//the cone bounds angles, they only survive into mesh space under a uniform scale. a mirroring transform
+	//flips the winding, the back faces the cones were built from then face the camera
+	Eigen::Vector3f scale(model.col(0).head<3>().norm(), model.col(1).head<3>().norm(), model.col(2).head<3>().norm());
+	bool uniformScale = scale.minCoeff() > 0.0f && scale.maxCoeff() <= scale.minCoeff() * 1.001f
+		&& model.topLeftCorner<3, 3>().determinant() > 0.0f;
+	Eigen::Matrix4f modelInv = model.inverse();
+
+	//planes of the clip volume pulled back into mesh space: left, right, bottom, top, then w > 0
+	mMeshViews.clear();
+	for (const auto& view : mViews) {
+		if ((view.CullingMask & cameraMask) == 0 || (view.ShadowCaster && !castShadow))
+			continue;
+
+		Eigen::Matrix4f clip = view.ViewProjection * model;
+		const Eigen::Vector4f rows[5] = {
+			(clip.row(3) + clip.row(0)).transpose(), (clip.row(3) - clip.row(0)).transpose(),
+			(clip.row(3) + clip.row(1)).transpose(), (clip.row(3) - clip.row(1)).transpose(),
+			clip.row(3).transpose()
+		};
+		MeshView meshView;
+		meshView.PlaneCount = 0;
+		for (const auto& plane : rows) {
+			float length = plane.head<3>().norm();
+			if (length > 0.0f) meshView.Planes[meshView.PlaneCount++] = plane / length;
+		}
+		meshView.Eye = (modelInv * view.Eye.homogeneous()).head<3>();
+		meshView.ConeTest = view.ConeTest && uniformScale;
+		mMeshViews.push_back(meshView);
+	}
+
+	visible.assign(clusters.size(), false);
+	size_t visibleCount = 0;
+	for (size_t i = 0; i < clusters.size(); ++i) {
+		const auto& cluster = clusters[i];
+		for (const auto& meshView : mMeshViews) {
+			bool inside = true;
+			for (int p = 0; p < meshView.PlaneCount && inside; ++p)
+				inside = meshView.Planes[p].head<3>().dot(cluster.Center) + meshView.Planes[p].w() >= -cluster.Radius;
+			if (!inside)
+				continue;
+
+			if (meshView.ConeTest && cluster.ConeCutoff < 1.0f) {
+				Eigen::Vector3f toCenter = cluster.Center - meshView.Eye;
+				if (toCenter.dot(cluster.ConeAxis) >= cluster.ConeCutoff * (toCenter.norm() + cluster.Radius) + cluster.Radius)
+					continue;
+			}
+
+			visible[i] = true;
+			++visibleCount;
+			break;
+		}
+	}
+	mVisibleCount += visibleCount;
+	return visibleCount;
+}
+
+}
+}
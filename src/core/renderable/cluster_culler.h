@@ -0,0 +1,52 @@
+#pragma once
+#include <boost/noncopyable.hpp>
+#include "core/mir_export.h"
+#include "core/predeclare.h"
+#include "core/base/declare_macros.h"
+#include "core/base/math.h"
+#include "core/resource/mesh_optimizer.h"
+
+namespace mir {
+namespace rend {
+
+/* per frame culling of the MeshClusters of static AssimpModel meshes, against the views the frame is drawn from:
+ * the cameras and, for the models casting shadows, the shadow casting lights. a cluster is kept while any view sees it,
+ * the normal cone test only runs for perspective cameras, a light's view also draws back faces into the shadow map.
+ * the models compact the clusters kept into their dynamic index buffers. */
+class MIR_CORE_API ClusterCuller : boost::noncopyable
+{
+public:
+	void AddModel(AssimpModel* model) { mModels.push_back(model); }
+	void UpdateFrame(const std::vector<scene::CameraPtr>& cameras, const std::vector<scene::LightPtr>& lights);
+	/* the sphere of a cluster is tested against the side planes and the eye plane, the far plane is left alone.
+	 * model is mesh to world, visible gets one flag per cluster. returns the number of visible clusters */
+	size_t Cull(const std::vector<res::MeshCluster>& clusters, const Eigen::Matrix4f& model, unsigned cameraMask, bool castShadow, std::vector<bool>& visible);
+
+	void SetEnabled(bool enable) { mEnabled = enable; }
+	bool IsEnabled() const { return mEnabled; }
+	size_t ClusterCount() const { return mClusterCount; }
+	size_t VisibleClusterCount() const { return mVisibleCount; }
+private:
+	struct View {
+		Eigen::Matrix4f ViewProjection;
+		Eigen::Vector3f Eye;
+		unsigned CullingMask;
+		bool ConeTest, ShadowCaster;
+	};
+	struct MeshView {
+		Eigen::Vector4f Planes[5];
+		int PlaneCount;
+		Eigen::Vector3f Eye;
+		bool ConeTest;
+	};
+	void GatherViews(const std::vector<scene::CameraPtr>& cameras, const std::vector<scene::LightPtr>& lights);
+private:
+	bool mEnabled = true;
+	std::vector<AssimpModel*> mModels;
+	std::vector<View, mir_allocator<View>> mViews;
+	std::vector<MeshView, mir_allocator<MeshView>> mMeshViews;
+	size_t mClusterCount = 0, mVisibleCount = 0;
+};
+
+}
+}
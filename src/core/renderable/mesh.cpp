@@ -9,8 +9,14 @@ namespace rend {
 Mesh::Mesh(Launch launchMode, ResourceManager& resMng, const res::MaterialInstance& material, int vertCount, int indexCount)
 	:Super(launchMode, resMng, material)
 {
-	mIndices.resize(indexCount);
-	mIndexBuffer = mResMng.CreateIndexBuffer(mLaunchMode, mVao, kFormatR32UInt, Data::Make(mIndices));
+	if (FitsIndex16(vertCount)) {
+		mIndices16.resize(indexCount);
+		mIndexBuffer = mResMng.CreateIndexBuffer(mLaunchMode, mVao, kFormatR16UInt, Data::Make(mIndices16));
+	}
+	else {
+		mIndices.resize(indexCount);
+		mIndexBuffer = mResMng.CreateIndexBuffer(mLaunchMode, mVao, kFormatR32UInt, Data::Make(mIndices));
+	}
 
 	mVertices.resize(vertCount);
 	mVertexBuffer = mResMng.CreateVertexBuffer(mLaunchMode, mVao, sizeof(vbSurface), 0, Data::MakeSize(mVertices));
@@ -34,7 +40,7 @@ void Mesh::GenRenderOperation(RenderOperationQueue& opList)
 	if (mIndiceDirty)
 	{
 		mIndiceDirty = false;
-		mResMng.UpdateBuffer(mIndexBuffer, Data::Make(mIndices));
+		mResMng.UpdateBuffer(mIndexBuffer, mIndices16.empty() ? Data::Make(mIndices) : Data::Make(mIndices16));
 	}
 
 	int opCount = 0;
@@ -131,8 +137,8 @@ void Mesh::SetIndices(const unsigned int* indiceData, int indicePos, int indiceC
 {
 	assert(subMeshIndex < mSubMeshs.size());
 	mIndiceDirty = true;
-	for (int i = 0; i < indiceCount; ++i)
-		mIndices[i + indicePos] = indiceData[i];
+	if (!mIndices16.empty()) NarrowIndices(indiceData, indiceCount, &mIndices16[indicePos]);
+	else std::copy(indiceData, indiceData + indiceCount, &mIndices[indicePos]);
 
 	auto& submesh = mSubMeshs[subMeshIndex];
 	submesh.IndicePos = indicePos;
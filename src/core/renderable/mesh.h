@@ -32,6 +32,7 @@ private:
 
 	int mIndiceDirty = false;
 	std::vector<unsigned int> mIndices;
+	std::vector<uint16_t> mIndices16;//used instead of mIndices when vertCount FitsIndex16
 
 	struct SubMesh {
 		short IndicePos, IndiceCount, IndiceBase;
@@ -13,6 +13,9 @@ DECLARE_CLASS(SkyBox);
 DECLARE_CLASS(Sprite);
 DECLARE_CLASS(Mesh);
 DECLARE_CLASS(AssimpModel);
+DECLARE_CLASS(AssimpCrowd);
+DECLARE_CLASS(AnimationSystem);
+DECLARE_CLASS(ClusterCuller);
 DECLARE_CLASS(Cube);
 DECLARE_CLASS(PostProcess);
 DECLARE_CLASS(Bloom);
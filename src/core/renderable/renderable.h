@@ -21,7 +21,8 @@ public:
 	res::MaterialInstance Material;
 	std::vector<IVertexBufferPtr> VertexBuffers;
 	IIndexBufferPtr IndexBuffer;
-	short IndexPos = 0, IndexCount = 0, IndexBase = 0;
+	int IndexPos = 0, IndexCount = 0, IndexBase = 0;
+	int InstanceCount = 1;//> 1 draws instanced, the shader picks its data by instance id
 	bool CastShadow;//setup by pipeline
 	Eigen::Matrix4f WorldTransform = Eigen::Matrix4f::Identity();
 	std::optional<ScissorState> Scissor;
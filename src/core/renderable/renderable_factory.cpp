@@ -6,6 +6,7 @@
 #include "core/renderable/label.h"
 #include "core/renderable/cube.h"
 #include "core/renderable/assimp_model.h"
+#include "core/renderable/assimp_crowd.h"
 #include "core/renderable/post_process.h"
 #include "core/renderable/paint3d.h"
 #include "core/base/debug.h"
@@ -162,6 +163,15 @@ CoTask<bool> RenderableFactory::CreateAssimpModel(rend::AssimpModelPtr& model, M
 	CoReturn true;
 }
 
+CoTask<bool> RenderableFactory::CreateAssimpCrowd(rend::AssimpCrowdPtr& crowd, MaterialLoadParam param)
+{
+	COROUTINE_VARIABLES_1(param);
+
+	crowd = CreateInstance<AssimpCrowd>(mLchMode, mResMng, param); BOOST_ASSERT(crowd);
+	CoAwait mResMng.SwitchToLaunchService(__LaunchSync__);
+	CoReturn true;
+}
+
 CoTask<bool> RenderableFactory::CreateLabel(rend::LabelPtr& label, std::string fontPath, int fontSize)
 {
 	//BOOST_ASSERT(! mResMng.IsCurrentInAsyncService());
@@ -20,6 +20,7 @@ public:
 	CoTask<bool> CreateMesh(rend::MeshPtr& rend, int vertCount = 1024, int indexCount = 1024, MaterialLoadParam loadParam = "");
 	CoTask<bool> CreateCube(rend::CubePtr& rend, Eigen::Vector3f center, Eigen::Vector3f halfsize, unsigned bgra = -1, MaterialLoadParam loadParam = "");
 	CoTask<bool> CreateAssimpModel(rend::AssimpModelPtr& rend, MaterialLoadParam loadParam = "");
+	CoTask<bool> CreateAssimpCrowd(rend::AssimpCrowdPtr& rend, MaterialLoadParam loadParam = "");
 	CoTask<bool> CreateLabel(rend::LabelPtr& rend, std::string fontPath, int fontSize);
 	CoTask<bool> CreatePostProcessEffect(rend::PostProcessPtr& rend, MaterialLoadParam loadParam = "");
 	CoTask<bool> CreatePaint3D(rend::Paint3DPtr& rend);
@@ -29,6 +30,7 @@ public:
 	DECLARE_COTASK_FUNCTIONS(rend::MeshPtr, CreateMesh, ThreadSafe);
 	DECLARE_COTASK_FUNCTIONS(rend::CubePtr, CreateCube, ThreadSafe);
 	DECLARE_COTASK_FUNCTIONS(rend::AssimpModelPtr, CreateAssimpModel, ThreadSafe);
+	DECLARE_COTASK_FUNCTIONS(rend::AssimpCrowdPtr, CreateAssimpCrowd, ThreadSafe);
 	DECLARE_COTASK_FUNCTIONS(rend::LabelPtr, CreateLabel, ThreadSafe);
 	DECLARE_COTASK_FUNCTIONS(rend::PostProcessPtr, CreatePostProcessEffect, ThreadSafe);
 	DECLARE_COTASK_FUNCTIONS(rend::Paint3DPtr, CreatePaint3D, ThreadSafe);
@@ -53,6 +55,9 @@ private:
 	template<> struct CreateRendFunctor<rend::AssimpModel> {
 		TemplateArgs rend::AssimpModelPtr operator()(RenderableFactory& __this, T &&...args) const { return __this.CreateAssimpModel(std::forward<T>(args)...); }
 	};
+	template<> struct CreateRendFunctor<rend::AssimpCrowd> {
+		TemplateArgs rend::AssimpCrowdPtr operator()(RenderableFactory& __this, T &&...args) const { return __this.CreateAssimpCrowd(std::forward<T>(args)...); }
+	};
 	template<> struct CreateRendFunctor<rend::Label> {
 		TemplateArgs rend::LabelPtr operator()(RenderableFactory& __this, T &&...args) const { return __this.CreateLabel(std::forward<T>(args)...); }
 	};
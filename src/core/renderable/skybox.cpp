@@ -2,6 +2,7 @@
 #include "core/base/debug.h"
 #include "core/renderable/skybox.h"
 #include "core/resource/resource_manager.h"
+#include "core/resource/texture_streamer.h"
 
 namespace mir {
 namespace rend {
@@ -94,16 +95,19 @@ SkyBox::SkyBox(Launch launchMode, ResourceManager& resourceMng, const res::Mater
 void SkyBox::SetDiffuseEnvMap(const ITexturePtr& texture)
 {
 	mDiffuseEnvMap = texture;
+	mResMng.GetTexStreamer().Exclude(texture);
 }
 
 void SkyBox::SetLutMap(const ITexturePtr& texture)
 {
 	mLutMap = texture;
+	mResMng.GetTexStreamer().Exclude(texture);
 }
 
 void SkyBox::SetSheenMap(const ITexturePtr& texture)
 {
 	mSheenMap = texture;
+	mResMng.GetTexStreamer().Exclude(texture);
 }
 
 void SkyBox::SetSphericalHarmonicsConstants(const SphericalHarmonicsConstants& shc)
@@ -26,6 +26,7 @@ class MIR_CORE_API SkyBox : public RenderableSingleRenderOp
 public:
 	MIR_MAKE_ALIGNED_OPERATOR_NEW;
 	SkyBox(Launch launchMode, ResourceManager& resMng, const res::MaterialInstance& material);
+	/* the pipeline binds these to its own slots, past the texture streamer */
 	void SetDiffuseEnvMap(const ITexturePtr& texture);
 	void SetLutMap(const ITexturePtr& texture);
 	void SetSheenMap(const ITexturePtr& texture);
@@ -658,6 +658,32 @@ void RenderSystem11::GenerateMips(ITexturePtr res)
 	Texture11Ptr texture = std::static_pointer_cast<Texture11>(res);
 	mDeviceContext->GenerateMips(texture->AsSRV().Get());
 }
+bool RenderSystem11::DropTextureMips(ITexturePtr res, int count)
+{
+	DEBUG_LOG_CALLSTK("renderSys11.DropTextureMips");
+	BOOST_ASSERT(IsCurrentInMainThread());
+	BOOST_ASSERT(res);
+
+	Texture11Ptr texture = std::static_pointer_cast<Texture11>(res);
+	const int mipCount = texture->GetMipmapCount();
+	BOOST_ASSERT(texture->GetFaceCount() == 1 && !texture->IsAutoGenMipmap() && count > 0 && count < mipCount);
+	ComPtr<ID3D11Texture2D> oldTex = texture->AsTex2D();
+	const Eigen::Vector2i size = texture->GetSize();
+
+	texture->Init(texture->GetFormat(), texture->GetUsage(), std::max(size.x() >> count, 1), std::max(size.y() >> count, 1), 1, mipCount - count);
+	if (!texture->InitTex(mDevice) || !texture->InitSRV(mDevice)) {
+		texture->Init(std::move(oldTex));
+		texture->InitSRV(mDevice);
+		return false;
+	}
+
+	for (int mip = 0; mip < mipCount - count; ++mip)
+		mDeviceContext->CopySubresourceRegion(texture->AsTex2D().Get(), D3D11CalcSubresource(mip, 0, mipCount - count), 0, 0, 0, 
+			oldTex.Get(), D3D11CalcSubresource(mip + count, 0, mipCount), nullptr);
+
+	DEBUG_RES_ADD_DEVICE(texture, texture->AsSRV().Get(), "");
+	return true;
+}
 static inline std::vector<ID3D11ShaderResourceView*> GetTextureViews11(const ITexturePtr textures[], size_t count) {
 	std::vector<ID3D11ShaderResourceView*> views(count);
 	for (int i = 0; i < views.size(); ++i) {
@@ -864,14 +890,16 @@ void RenderSystem11::DrawPrimitive(const RenderOperation& op, PrimitiveTopology
 	BOOST_ASSERT(IsCurrentInMainThread());
 
 	mDeviceContext->IASetPrimitiveTopology(static_cast<D3D11_PRIMITIVE_TOPOLOGY>(topo));
-	mDeviceContext->Draw(op.VertexBuffers[0]->GetCount(), 0);
+	if (op.InstanceCount > 1) mDeviceContext->DrawInstanced(op.VertexBuffers[0]->GetCount(), op.InstanceCount, 0, 0);
+	else mDeviceContext->Draw(op.VertexBuffers[0]->GetCount(), 0);
 }
 void RenderSystem11::DrawIndexedPrimitive(const RenderOperation& op, PrimitiveTopology topo) {
 	BOOST_ASSERT(IsCurrentInMainThread());
 
 	mDeviceContext->IASetPrimitiveTopology(static_cast<D3D11_PRIMITIVE_TOPOLOGY>(topo));
 	int indexCount = op.IndexCount != 0 ? op.IndexCount : op.IndexBuffer->GetBufferSize() / op.IndexBuffer->GetWidth();
-	mDeviceContext->DrawIndexed(indexCount, op.IndexPos, op.IndexBase);
+	if (op.InstanceCount > 1) mDeviceContext->DrawIndexedInstanced(indexCount, op.InstanceCount, op.IndexPos, op.IndexBase, 0);
+	else mDeviceContext->DrawIndexed(indexCount, op.IndexPos, op.IndexBase);
 }
 
 bool RenderSystem11::BeginScene()
@@ -21,6 +21,20 @@ struct LayoutInputElement
 	LayoutInputClass InputSlotClass;
 	unsigned InstanceDataStepRate;
 };
+inline bool operator==(const LayoutInputElement& l, const LayoutInputElement& r) {
+	return l.SemanticName == r.SemanticName && l.SemanticIndex == r.SemanticIndex
+		&& l.Format == r.Format && l.InputSlot == r.InputSlot && l.AlignedByteOffset == r.AlignedByteOffset
+		&& l.InputSlotClass == r.InputSlotClass && l.InstanceDataStepRate == r.InstanceDataStepRate;
+}
+inline bool operator<(const LayoutInputElement& l, const LayoutInputElement& r) {
+	if (l.SemanticName != r.SemanticName) return l.SemanticName < r.SemanticName;
+	if (l.SemanticIndex != r.SemanticIndex) return l.SemanticIndex < r.SemanticIndex;
+	if (l.Format != r.Format) return l.Format < r.Format;
+	if (l.InputSlot != r.InputSlot) return l.InputSlot < r.InputSlot;
+	if (l.AlignedByteOffset != r.AlignedByteOffset) return l.AlignedByteOffset < r.AlignedByteOffset;
+	if (l.InputSlotClass != r.InputSlotClass) return l.InputSlotClass < r.InputSlotClass;
+	return l.InstanceDataStepRate < r.InstanceDataStepRate;
+}
 
 interface IInputLayout : public IResource
 {
@@ -792,6 +792,15 @@ void RenderSystemOGL::GenerateMips(ITexturePtr texture)
 
 	std::static_pointer_cast<TextureOGL>(texture)->AutoGenMipmap();
 }
+bool RenderSystemOGL::DropTextureMips(ITexturePtr texture, int count)
+{
+	DEBUG_LOG_CALLSTK("renderSysOgl.DropTextureMips");
+	BOOST_ASSERT(IsCurrentInMainThread());
+	BOOST_ASSERT(texture);
+
+	std::static_pointer_cast<TextureOGL>(texture)->DropMips(count);
+	return true;
+}
 void RenderSystemOGL::SetTextures(size_t slot, const ITexturePtr textures[], size_t count)
 {
 	DEBUG_LOG_CALLSTK("renderSysOgl.SetTextures");
@@ -990,7 +999,8 @@ void RenderSystemOGL::DrawPrimitive(const RenderOperation& op, PrimitiveTopology
 	DEBUG_LOG_CALLSTK("renderSysOgl.DrawPrimitive");
 	BOOST_ASSERT(IsCurrentInMainThread());
 
-	CheckHR(glDrawArrays(ogl::GetGLTopologyType(topo), 0, op.VertexBuffers[0]->GetCount()));
+	if (op.InstanceCount > 1) CheckHR(glDrawArraysInstanced(ogl::GetGLTopologyType(topo), 0, op.VertexBuffers[0]->GetCount(), op.InstanceCount));
+	else CheckHR(glDrawArrays(ogl::GetGLTopologyType(topo), 0, op.VertexBuffers[0]->GetCount()));
 }
 void RenderSystemOGL::DrawIndexedPrimitive(const RenderOperation& op, PrimitiveTopology topo) {
 	DEBUG_LOG_CALLSTK("renderSysOgl.DrawIndexedPrimitive");
@@ -998,7 +1008,8 @@ void RenderSystemOGL::DrawIndexedPrimitive(const RenderOperation& op, PrimitiveT
 
 	int indexCount = IF_OR(op.IndexCount, op.IndexBuffer->GetBufferSize() / op.IndexBuffer->GetWidth());
 	auto glFmt = ogl::GetGlFormatInfo(op.IndexBuffer->GetFormat());
-	CheckHR(glDrawElementsBaseVertex(ogl::GetGLTopologyType(topo), indexCount, glFmt.InternalType, (void*)(op.IndexPos * op.IndexBuffer->GetWidth()), op.IndexBase));
+	if (op.InstanceCount > 1) CheckHR(glDrawElementsInstancedBaseVertex(ogl::GetGLTopologyType(topo), indexCount, glFmt.InternalType, (void*)(op.IndexPos * op.IndexBuffer->GetWidth()), op.InstanceCount, op.IndexBase));
+	else CheckHR(glDrawElementsBaseVertex(ogl::GetGLTopologyType(topo), indexCount, glFmt.InternalType, (void*)(op.IndexPos * op.IndexBuffer->GetWidth()), op.IndexBase));
 }
 
 bool RenderSystemOGL::BeginScene()
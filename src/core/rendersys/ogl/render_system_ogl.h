@@ -62,6 +62,7 @@ public:
 	bool LoadRawTextureData(ITexturePtr texture, char* data, int dataSize, int dataStep) override;
 	void SetTextures(size_t slot, const ITexturePtr textures[], size_t count) override;
 	void GenerateMips(ITexturePtr texture) override;
+	bool DropTextureMips(ITexturePtr texture, int count) override;
 
 	void DrawPrimitive(const RenderOperation& op, PrimitiveTopology topo) override;
 	void DrawIndexedPrimitive(const RenderOperation& op, PrimitiveTopology topo) override;
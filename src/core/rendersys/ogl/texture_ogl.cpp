@@ -38,6 +38,7 @@ void TextureOGL::Init(ResourceFormat format, HWMemoryUsage usage, int width, int
 }
 void TextureOGL::InitTex(const Data2 datas[])
 {
+	Dispose();//a texture loaded again, e.g. when its streamed mips change
 	CheckHR(glGenTextures(1, &mId));
 
 	mTarget = IF_AND_OR(mFaceCount > 1, GL_TEXTURE_CUBE_MAP, GL_TEXTURE_2D);
@@ -100,6 +101,21 @@ void TextureOGL::InitTex(const Data2 datas[])
 	CheckHR(glBindTexture(mTarget, 0));
 }
 
+void TextureOGL::DropMips(int count)
+{
+	BOOST_ASSERT(mFaceCount == 1 && !mAutoGenMipmap && count > 0 && count < mMipCount);
+	GLuint oldId = mId;
+	mId = 0;//kept from InitTex's Dispose until the copies are done
+
+	Init(mFormat, mUsage, std::max(mSize.x() >> count, 1), std::max(mSize.y() >> count, 1), 1, mMipCount - count);
+	InitTex(nullptr);
+	for (int mip = 0; mip < mMipCount; ++mip) {
+		CheckHR(glCopyImageSubData(oldId, mTarget, mip + count, 0, 0, 0, mId, mTarget, mip, 0, 0, 0, 
+			std::max(mSize.x() >> mip, 1), std::max(mSize.y() >> mip, 1), 1));
+	}
+	glDeleteTextures(1, &oldId);
+}
+
 void TextureOGL::AutoGenMipmap()
 {
 	if (mAutoGenMipmap) {
@@ -29,6 +29,8 @@ public:
 	void Init(ResourceFormat format, HWMemoryUsage usage, int width, int height, int faceCount, int mipmap);
 	void InitTex(const Data2 datas[]);
 	void AutoGenMipmap();
+	/* moves the levels [count, mips) into a new texture with glCopyImageSubData */
+	void DropMips(int count);
 	void OnLoaded() override;
 public:
 	GLuint GetId() const { return mId; }
@@ -9,6 +9,7 @@
 #include "core/resource/resource_manager.h"
 #include "core/resource/material_name.h"
 #include "core/resource/material_factory.h"
+#include "core/resource/texture_streamer.h"
 #include "core/renderable/sprite.h"
 #include "core/renderable/skybox.h"
 #include "core/renderable/post_process.h"
@@ -132,6 +133,7 @@ public:
 		, mCfg(Pipe.mCfg)
 		, mRenderSys(Pipe.mRenderSys)
 		, mStatesBlock(Pipe.mStatesBlock)
+		, mTexStreamer(Pipe.mTexStreamer)
 		, mFbBank(Pipe.mFbsBank)
 		, mShadowMap(Pipe.mShadowMap)
 		, mGBuffer(Pipe.mGBuffer)
@@ -535,6 +537,7 @@ private:
 		const TextureVector& textures = op.Material.GetTextures();
 		if (textures.Count() > 0) {
 			mStatesBlock.Textures(kTextureUserSlotFirst, &textures[0], std::min((size_t)kTextureUserSlotCount, textures.Count()));
+			mTexStreamer.Touch(&textures[0], textures.Count());
 			for (size_t slot = kTextureUserSlotLast; slot < textures.Count(); ++slot) {
 				if (textures[slot]) {
 					mStatesBlock.Textures(slot, textures[slot]);
@@ -550,8 +553,8 @@ private:
 			bool flag = false;
 			for (size_t slot = 0; slot < relParam.TextureSizes.size(); ++slot) {
 				auto texture = mStatesBlock.Textures[slot];
-				const std::string& propTexSize = relParam.TextureSizes[slot];
-				if (texture && !propTexSize.empty()) {
+				const auto& propTexSize = relParam.TextureSizes[slot];
+				if (texture && propTexSize.IsValid()) {
 					auto tsize = texture->GetSize();
 					op.WrMaterial().SetProperty(propTexSize, Eigen::Vector4f(tsize.x(), tsize.y(), 1.0f/tsize.x(), 1.0f/tsize.y()));
 					flag = true;
@@ -577,6 +580,7 @@ private:
 	const Configure& mCfg;
 	RenderSystem& mRenderSys;
 	RenderStatesBlock& mStatesBlock;
+	res::TextureStreamer& mTexStreamer;
 	FrameBufferBankPtr mFbBank;
 	IFrameBufferPtr mShadowMap, mGBuffer;
 	rend::SpritePtr mGBufferSprite;
@@ -598,6 +602,7 @@ RenderPipeline::RenderPipeline(RenderSystem& renderSys, ResourceManager& resMng,
 	, mCfg(cfg)
 	, mStatesBlockPtr(CreateInstance<RenderStatesBlock>(renderSys))
 	, mStatesBlock(*mStatesBlockPtr)
+	, mTexStreamer(resMng.GetTexStreamer())
 {
 	Eigen::Vector3i fbSize = Eigen::Vector3i(resMng.WinWidth(), resMng.WinHeight(), 1);
 	
@@ -33,6 +33,7 @@ private:
 	RenderSystem& mRenderSys;
 	RenderStatesBlockPtr mStatesBlockPtr;
 	RenderStatesBlock& mStatesBlock;
+	res::TextureStreamer& mTexStreamer;
 	FrameBufferBankPtr mFbsBank;
 	IFrameBufferPtr mShadowMap, mGBuffer;
 	rend::SpritePtr mGBufferSprite;
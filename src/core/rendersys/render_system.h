@@ -113,6 +113,8 @@ interface MIR_CORE_API IRenderSystem : boost::noncopyable
 	}
 	virtual bool LoadRawTextureData(ITexturePtr texture, char* data, int dataSize, int dataStep) = 0;
 	virtual void GenerateMips(ITexturePtr texture) = 0;
+	/* re-creates a 2d texture in place without its levels [0, count), the ones kept are copied on the gpu */
+	virtual bool DropTextureMips(ITexturePtr texture, int count) = 0;
 
 	/***** about state *****/
 	virtual void SetViewPort(int x, int y, int w, int h) = 0;
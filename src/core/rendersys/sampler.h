@@ -82,6 +82,17 @@ public:
 	CompareFunc CmpFunc;
 	AddressMode AddressU, AddressV, AddressW;
 };
+inline bool operator==(const SamplerDesc& l, const SamplerDesc& r) {
+	return l.Filter == r.Filter && l.CmpFunc == r.CmpFunc 
+		&& l.AddressU == r.AddressU && l.AddressV == r.AddressV && l.AddressW == r.AddressW;
+}
+inline bool operator<(const SamplerDesc& l, const SamplerDesc& r) {
+	if (l.Filter != r.Filter) return l.Filter < r.Filter;
+	if (l.CmpFunc != r.CmpFunc) return l.CmpFunc < r.CmpFunc;
+	if (l.AddressU != r.AddressU) return l.AddressU < r.AddressU;
+	if (l.AddressV != r.AddressV) return l.AddressV < r.AddressV;
+	return l.AddressW < r.AddressW;
+}
 
 interface ISamplerState : public IResource
 {
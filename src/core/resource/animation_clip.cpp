@@ -0,0 +1,191 @@
+#include <boost/format.hpp>
+#include <assimp/scene.h>
+#include <assimp/anim.h>
+#include "core/base/debug.h"
+#include "core/resource/animation_clip.h"
+
+namespace mir {
+namespace res {
+
+#define ROTATION_COMPONENT_MAX 0x7FFF
+static const float kSqrt1_2 = 0.70710678f;
+
+static uint16_t QuantizeUnit(float value, uint32_t maxValue)
+{
+	value = std::min(std::max(value, 0.0f), 1.0f);
+	return uint16_t(std::lround(value * maxValue));
+}
+static uint16_t QuantizeTime(double time, float duration)
+{
+	return (duration > 0.0f) ? QuantizeUnit(float(time / duration), AnimationClip::kTimeScale) : 0;
+}
+
+//smallest three: 2 bits index of the largest component, 3 x 15 bits for the others in [-1/sqrt2, 1/sqrt2]
+static void EncodeRotation(const Eigen::Quaternionf& q, uint16_t value[3])
+{
+	const float c[4] = { q.x(), q.y(), q.z(), q.w() };
+	int largest = 0;
+	for (int i = 1; i < 4; ++i)
+		if (fabs(c[i]) > fabs(c[largest])) largest = i;
+	float sign = c[largest] < 0.0f ? -1.0f : 1.0f;
+
+	uint64_t bits = largest;
+	for (int i = 0; i < 4; ++i) {
+		if (i == largest) continue;
+		float unit = (c[i] * sign / kSqrt1_2 + 1.0f) * 0.5f;
+		bits = (bits << 15) | QuantizeUnit(unit, ROTATION_COMPONENT_MAX);
+	}
+	value[0] = uint16_t(bits);
+	value[1] = uint16_t(bits >> 16);
+	value[2] = uint16_t(bits >> 32);
+}
+
+static float RotationError(const Eigen::Quaternionf& l, const Eigen::Quaternionf& r)
+{
+	return 2.0f * acosf(std::min(fabs(l.dot(r)), 1.0f));
+}
+
+/* keeps the first and last keys, drops every key that the interpolation of its neighbours reproduces within tolerance.
+ * a track whose keys all stay within tolerance of the first one collapses into a single constant key. */
+template<class T, class LerpFunc, class ErrorFunc>
+static std::vector<uint32_t> ReduceKeys(const std::vector<double>& times, const std::vector<T>& values, float tolerance, LerpFunc lerp, ErrorFunc error)
+{
+	std::vector<uint32_t> kept(1, 0);
+	if (std::all_of(values.begin(), values.end(), [&](const T& v) { return error(v, values[0]) <= tolerance; }))
+		return kept;
+
+	//greedy, extend the segment from the last kept key while every skipped key still fits
+	uint32_t anchor = 0;
+	for (uint32_t candidate = 2; candidate < values.size(); ++candidate) {
+		double span = times[candidate] - times[anchor];
+		for (uint32_t k = anchor + 1; k < candidate; ++k) {
+			float factor = (span > 0.0) ? float((times[k] - times[anchor]) / span) : 0.0f;
+			if (error(lerp(values[anchor], values[candidate], factor), values[k]) > tolerance) {
+				anchor = candidate - 1;
+				kept.push_back(anchor);
+				break;
+			}
+		}
+	}
+	kept.push_back(uint32_t(values.size() - 1));
+	return kept;
+}
+
+static void BuildVectorTrack(const aiVectorKey* keys, unsigned count, float duration, float tolerance, std::vector<AnimationKey>& pool, AnimationTrack& track)
+{
+	track = AnimationTrack();
+	track.Offset = uint32_t(pool.size());
+	if (count == 0) return;
+
+	std::vector<double> times(count);
+	std::vector<Eigen::Vector3f> values(count);
+	for (unsigned i = 0; i < count; ++i) {
+		times[i] = keys[i].mTime;
+		values[i] = Eigen::Vector3f(keys[i].mValue.x, keys[i].mValue.y, keys[i].mValue.z);
+	}
+	std::vector<uint32_t> kept = ReduceKeys(times, values, tolerance,
+		[](const Eigen::Vector3f& l, const Eigen::Vector3f& r, float factor) -> Eigen::Vector3f { return l + (r - l) * factor; },
+		[](const Eigen::Vector3f& l, const Eigen::Vector3f& r) { return (l - r).cwiseAbs().maxCoeff(); });
+
+	Eigen::Vector3f vmin = values[kept[0]], vmax = vmin;
+	for (uint32_t k : kept) {
+		vmin = vmin.cwiseMin(values[k]);
+		vmax = vmax.cwiseMax(values[k]);
+	}
+	track.Min = vmin;
+	track.Extent = vmax - vmin;
+	track.Count = uint32_t(kept.size());
+	for (uint32_t k : kept) {
+		AnimationKey key;
+		key.Time = QuantizeTime(times[k], duration);
+		for (int c = 0; c < 3; ++c)
+			key.Value[c] = (track.Extent[c] > 0.0f) ? QuantizeUnit((values[k][c] - vmin[c]) / track.Extent[c], 0xFFFF) : 0;
+		pool.push_back(key);
+	}
+}
+
+static void BuildRotationTrack(const aiQuatKey* keys, unsigned count, float duration, float tolerance, std::vector<AnimationKey>& pool, AnimationTrack& track)
+{
+	track = AnimationTrack();
+	track.Offset = uint32_t(pool.size());
+	if (count == 0) return;
+
+	std::vector<double> times(count);
+	std::vector<Eigen::Quaternionf> values(count);
+	for (unsigned i = 0; i < count; ++i) {
+		times[i] = keys[i].mTime;
+		const aiQuaternion& q = keys[i].mValue;
+		values[i] = Eigen::Quaternionf(q.w, q.x, q.y, q.z).normalized();
+	}
+	std::vector<uint32_t> kept = ReduceKeys(times, values, tolerance,
+		[](const Eigen::Quaternionf& l, const Eigen::Quaternionf& r, float factor) -> Eigen::Quaternionf { return l.slerp(factor, r); },
+		&RotationError);
+
+	track.Count = uint32_t(kept.size());
+	for (uint32_t k : kept) {
+		AnimationKey key;
+		key.Time = QuantizeTime(times[k], duration);
+		EncodeRotation(values[k], key.Value);
+		pool.push_back(key);
+	}
+}
+
+/********** AnimationClip **********/
+AnimationClipPtr AnimationClip::Build(const aiAnimation& anim, const AnimationClipBuildParam& param)
+{
+	auto clip = std::make_shared<AnimationClip>();
+	clip->mName = anim.mName.C_Str();
+	clip->mDuration = float(anim.mDuration);
+	clip->mTicksPerSecond = (anim.mTicksPerSecond != 0.0) ? float(anim.mTicksPerSecond) : 25.0f;
+
+	size_t sourceSize = sizeof(aiAnimation) + anim.mNumChannels * (sizeof(aiNodeAnim*) + sizeof(aiNodeAnim));
+	clip->mChannels.resize(anim.mNumChannels);
+	for (unsigned i = 0; i < anim.mNumChannels; ++i) {
+		const aiNodeAnim& src = *anim.mChannels[i];
+		AnimationChannel& dst = clip->mChannels[i];
+		dst.NodeName = src.mNodeName.C_Str();
+		BuildVectorTrack(src.mPositionKeys, src.mNumPositionKeys, clip->mDuration, param.PositionTolerance, clip->mKeys, dst.Position);
+		BuildRotationTrack(src.mRotationKeys, src.mNumRotationKeys, clip->mDuration, param.RotationTolerance, clip->mKeys, dst.Rotation);
+		BuildVectorTrack(src.mScalingKeys, src.mNumScalingKeys, clip->mDuration, param.ScalingTolerance, clip->mKeys, dst.Scaling);
+		sourceSize += (src.mNumPositionKeys + src.mNumScalingKeys) * sizeof(aiVectorKey) + src.mNumRotationKeys * sizeof(aiQuatKey);
+	}
+	clip->mKeys.shrink_to_fit();
+
+	DEBUG_LOG_INFO((boost::format("animationClip.Build %1%: %2% channels, %3% keys, %4% -> %5% bytes")
+		%clip->mName %clip->mChannels.size() %clip->mKeys.size() %sourceSize %clip->GetMemorySize()).str());
+	return clip;
+}
+
+size_t AnimationClip::GetMemorySize() const
+{
+	size_t size = sizeof(*this) + mName.capacity() + mKeys.capacity() * sizeof(AnimationKey);
+	for (const auto& channel : mChannels)
+		size += sizeof(AnimationChannel) + channel.NodeName.capacity();
+	return size;
+}
+
+Eigen::Vector3f AnimationClip::DecodeVector(const AnimationTrack& track, const AnimationKey& key)
+{
+	Eigen::Vector3f unit(key.Value[0], key.Value[1], key.Value[2]);
+	return track.Min + track.Extent.cwiseProduct(unit / float(0xFFFF));
+}
+
+Eigen::Quaternionf AnimationClip::DecodeRotation(const AnimationKey& key)
+{
+	uint64_t bits = uint64_t(key.Value[0]) | (uint64_t(key.Value[1]) << 16) | (uint64_t(key.Value[2]) << 32);
+	int largest = int(bits >> 45) & 3;
+
+	float c[4], sum = 0.0f;
+	for (int i = 3; i >= 0; --i) {
+		if (i == largest) continue;
+		float unit = float(bits & ROTATION_COMPONENT_MAX) / ROTATION_COMPONENT_MAX;
+		c[i] = (unit * 2.0f - 1.0f) * kSqrt1_2;
+		sum += c[i] * c[i];
+		bits >>= 15;
+	}
+	c[largest] = sqrtf(std::max(1.0f - sum, 0.0f));
+	return Eigen::Quaternionf(c[3], c[0], c[1], c[2]);
+}
+
+}
+}
@@ -0,0 +1,68 @@
+#pragma once
+#include "core/mir_export.h"
+#include "core/base/math.h"
+#include "core/base/stl.h"
+#include "core/base/declare_macros.h"
+#include "core/resource/predeclare.h"
+
+struct aiAnimation;
+
+namespace mir {
+namespace res {
+
+struct AnimationClipBuildParam
+{
+	float PositionTolerance = 1e-3f;//model units
+	float RotationTolerance = 1e-3f;//radians
+	float ScalingTolerance = 1e-4f;
+};
+
+/* 8 bytes: time quantized over the clip duration, value quantized per track type */
+struct AnimationKey
+{
+	uint16_t Time;
+	uint16_t Value[3];
+};
+/* Count = 0 default value, Count = 1 constant track.
+ * position and scaling values are quantized into [Min, Min + Extent], rotations are smallest-three 48 bits */
+struct AnimationTrack
+{
+	uint32_t Offset = 0, Count = 0;
+	Eigen::Vector3f Min = Eigen::Vector3f::Zero(), Extent = Eigen::Vector3f::Zero();
+};
+struct AnimationChannel
+{
+	std::string NodeName;
+	AnimationTrack Position, Rotation, Scaling;
+};
+
+/* engine owned clip built from aiAnimation at import, so the importer is freed after load.
+ * tracks are key-reduced within tolerances, constant tracks keep one key,
+ * all keys live in one contiguous pool and are decoded one pair at a time when sampled. */
+class MIR_CORE_API AnimationClip
+{
+	friend class AiSceneCache;
+public:
+	enum { kTimeScale = 0xFFFF };
+	static AnimationClipPtr Build(const aiAnimation& anim, const AnimationClipBuildParam& param = AnimationClipBuildParam());
+
+	const std::string& GetName() const { return mName; }
+	float GetDuration() const { return mDuration; }
+	float GetTicksPerSecond() const { return mTicksPerSecond; }
+	size_t ChannelCount() const { return mChannels.size(); }
+	const AnimationChannel& GetChannel(size_t index) const { return mChannels[index]; }
+	const std::vector<AnimationChannel>& GetChannels() const { return mChannels; }
+	const AnimationKey* GetKeys(const AnimationTrack& track) const { return mKeys.data() + track.Offset; }
+	size_t GetMemorySize() const;
+
+	static Eigen::Vector3f DecodeVector(const AnimationTrack& track, const AnimationKey& key);
+	static Eigen::Quaternionf DecodeRotation(const AnimationKey& key);
+private:
+	std::string mName;
+	float mDuration = 0.0f, mTicksPerSecond = 25.0f;
+	std::vector<AnimationChannel> mChannels;
+	std::vector<AnimationKey> mKeys;
+};
+
+}
+}
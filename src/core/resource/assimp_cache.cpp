@@ -0,0 +1,385 @@
+#include <windows.h>
+#include <fstream>
+#include <boost/filesystem.hpp>
+#include <boost/format.hpp>
+#include "core/base/debug.h"
+#include "core/base/input.h"
+#include "core/base/md5.h"
+#include "core/base/attribute_struct.h"
+#include "core/resource/assimp_cache.h"
+#include "core/resource/assimp_resource.h"
+#include "core/resource/animation_clip.h"
+#include "core/resource/gltf_document.h"
+
+namespace mir {
+namespace res {
+
+#define MIRMESH_MAGIC 0x4D52494D //"MIRM"
+#define MIRMESH_VERSION 4 //3: glTF texcoords are no longer flipped, 4: the .gltf buffers are hashed too
+#define MIRMESH_ALIGN(SIZE) (((SIZE) + 15) & ~size_t(15))
+
+struct MirMeshHeader {
+	uint32_t Magic, Version, ImportFlags, PaletteSize;
+	uint32_t SurfaceStride, SkeletonStride, OptimizeFlags, VertexLimit;
+	ShaderCacheDigest SourceHash;
+	uint64_t FileSize, SourceStamp;
+};
+static_assert(sizeof(MirMeshHeader) == 64, "mirmesh layout");
+
+class AiSceneCache::Writer {
+public:
+	template<class T> void Write(const T& value) { Append(&value, sizeof(T)); }
+	void Write(const std::string& str) {
+		Write(uint32_t(str.size()));
+		Append(str.data(), str.size());
+	}
+	void WriteStream(const void* bytes, size_t size) {
+		Write(uint64_t(size));
+		mBytes.resize(MIRMESH_ALIGN(mBytes.size()), 0);
+		Append(bytes, size);
+	}
+	template<class T, class A> void WriteStream(const std::vector<T, A>& values) { WriteStream(values.data(), values.size() * sizeof(T)); }
+	std::vector<char>& Bytes() { return mBytes; }
+private:
+	void Append(const void* bytes, size_t size) {
+		const char* first = (const char*)bytes;
+		mBytes.insert(mBytes.end(), first, first + size);
+	}
+	std::vector<char> mBytes;
+};
+
+/* every read fails once the cursor would pass the end, the callers check it once per record */
+class AiSceneCache::Reader {
+public:
+	Reader(const char* view, size_t size, size_t position) :mView(view), mSize(size), mPosition(position) {}
+	template<class T> bool Read(T& value) { return Copy(&value, sizeof(T)); }
+	bool Read(std::string& str) {
+		uint32_t size = 0;
+		if (!Read(size) || !Reserve(size)) return false;
+		str.assign(mView + mPosition, size);
+		mPosition += size;
+		return true;
+	}
+	bool ReadStream(Data& data) {
+		uint64_t size = 0;
+		if (!Read(size)) return false;
+		mPosition = MIRMESH_ALIGN(mPosition);
+		if (!Reserve(size)) return false;
+		data = Data::Make(mView + mPosition, size_t(size));
+		mPosition += size_t(size);
+		return true;
+	}
+	explicit operator bool() const { return mValid; }
+private:
+	bool Reserve(uint64_t size) {
+		mValid = mValid && mPosition <= mSize && size <= mSize - mPosition;
+		return mValid;
+	}
+	bool Copy(void* dst, size_t size) {
+		if (!Reserve(size)) return false;
+		memcpy(dst, mView + mPosition, size);
+		mPosition += size;
+		return true;
+	}
+private:
+	const char* mView;
+	size_t mSize, mPosition;
+	bool mValid = true;
+};
+
+/********** AiSceneCache **********/
+AiSceneCache::~AiSceneCache()
+{
+	Close();
+}
+
+std::string AiSceneCache::MakeCachePath(const std::string& assetPath)
+{
+	return assetPath + ".mirmesh";
+}
+
+bool AiSceneCache::GetSourceFiles(const std::string& assetPath, SourceFiles& files)
+{
+	files.Paths.assign(1, assetPath);
+	GltfDocument::GetBufferFiles(assetPath, files.Paths);
+
+	std::string stamps;
+	for (const auto& path : files.Paths) {
+		boost::system::error_code ec;
+		uintmax_t size = boost::filesystem::file_size(path, ec);
+		if (ec) return false;
+		std::time_t time = boost::filesystem::last_write_time(path, ec);
+		if (ec) return false;
+		stamps += (boost::format("%1%:%2%:%3%;") % path % size % time).str();
+	}
+	ShaderCacheDigest digest;
+	md5((const uint8_t*)stamps.data(), stamps.size(), digest.Bytes);
+	memcpy(&files.Stamp, digest.Bytes, sizeof(files.Stamp));
+	return true;
+}
+
+bool AiSceneCache::MakeSourceHash(const SourceFiles& files, ShaderCacheDigest& hash)
+{
+	//the md5 of the files' md5s
+	std::vector<ShaderCacheDigest> digests(files.Paths.size());
+	for (size_t i = 0; i < files.Paths.size(); ++i) {
+		std::vector<char> bin = input::ReadFile(files.Paths[i].c_str(), "rb");
+		if (bin.empty()) return false;
+		md5((const uint8_t*)&bin[0], bin.size(), digests[i].Bytes);
+	}
+	if (digests.empty()) return false;
+	md5((const uint8_t*)&digests[0], digests.size() * sizeof(ShaderCacheDigest), hash.Bytes);
+	return true;
+}
+
+bool AiSceneCache::Open(const std::string& cachePath, const SourceFiles& files, const Settings& settings)
+{
+	Close();
+	mFile = ::CreateFileA(cachePath.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_DELETE, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (mFile == INVALID_HANDLE_VALUE) {
+		mFile = nullptr;
+		return false;
+	}
+
+	LARGE_INTEGER size;
+	::GetFileSizeEx(mFile, &size);
+	mViewSize = size_t(size.QuadPart);
+	if (mViewSize >= sizeof(MirMeshHeader)) {
+		mMapping = ::CreateFileMappingA(mFile, NULL, PAGE_READONLY, 0, 0, NULL);
+		if (mMapping) mView = (const char*)::MapViewOfFile(mMapping, FILE_MAP_READ, 0, 0, 0);
+	}
+
+	const MirMeshHeader* header = (const MirMeshHeader*)mView;
+	bool valid = header
+		&& header->Magic == MIRMESH_MAGIC
+		&& header->Version == MIRMESH_VERSION
+		&& header->FileSize == mViewSize
+		&& header->ImportFlags == settings.ImportFlags
+		&& header->PaletteSize == settings.PaletteSize
+		&& header->OptimizeFlags == settings.OptimizeFlags
+		&& header->VertexLimit == settings.VertexLimit
+		&& header->SurfaceStride == sizeof(vbSurface)
+		&& header->SkeletonStride == sizeof(vbSkeleton);
+	//touched but unchanged sources (a checkout, a copy) still match by content
+	if (valid && header->SourceStamp != files.Stamp) {
+		ShaderCacheDigest sourceHash;
+		valid = MakeSourceHash(files, sourceHash) && header->SourceHash == sourceHash;
+	}
+	if (!valid) {
+		DEBUG_LOG_INFO("aiSceneCache.Open stale or missing " + cachePath);
+		Close();
+	}
+	return valid;
+}
+
+void AiSceneCache::Close()
+{
+	if (mView) ::UnmapViewOfFile(mView);
+	if (mMapping) ::CloseHandle(mMapping);
+	if (mFile) ::CloseHandle(mFile);
+	mView = nullptr;
+	mMapping = mFile = nullptr;
+	mViewSize = 0;
+}
+
+bool AiSceneCache::Read(AiScene& scene, std::vector<AiMeshStreams>& streams) const
+{
+	BOOST_ASSERT(mView != nullptr);
+	TIME_PROFILE("\t\taiSceneCache.Read");
+
+	Reader reader(mView, mViewSize, sizeof(MirMeshHeader));
+	uint32_t nodeCount = 0, clipCount = 0;
+	reader.Read(nodeCount);
+	streams.clear();
+	scene.mRootNode = ReadNode(reader, scene, streams);
+
+	reader.Read(clipCount);
+	scene.mAnimations.clear();
+	for (uint32_t i = 0; reader && i < clipCount; ++i)
+		scene.mAnimations.push_back(ReadClip(reader));
+
+	bool result = reader && scene.mRootNode && scene.mNodes.size() == nodeCount && streams.size() == scene.mMeshes.size();
+	if (!result) DEBUG_LOG_ERROR("aiSceneCache.Read broken file");
+	return result;
+}
+
+AiNodePtr AiSceneCache::ReadNode(Reader& reader, AiScene& scene, std::vector<AiMeshStreams>& streams)
+{
+	//same order as AiSceneLoader::ProcessNode, so the serialize indices come out the same
+	AiNodePtr node = scene.AddNode();
+	uint32_t meshCount = 0, childCount = 0;
+	reader.Read(node->mName);
+	reader.Read(node->mLocalTransform);
+	node->mGlobalTransform = node->mLocalTransform;
+
+	reader.Read(meshCount);
+	for (uint32_t i = 0; reader && i < meshCount; ++i) {
+		if (AssimpMeshPtr mesh = ReadMesh(reader, streams)) {
+			scene.AddMesh(mesh);
+			node->AddMesh(mesh);
+		}
+	}
+
+	reader.Read(childCount);
+	for (uint32_t i = 0; reader && i < childCount; ++i) {
+		if (AiNodePtr child = ReadNode(reader, scene, streams))
+			node->AddChild(child);
+	}
+	return reader ? node : nullptr;
+}
+
+AssimpMeshPtr AiSceneCache::ReadMesh(Reader& reader, std::vector<AiMeshStreams>& streams)
+{
+	AssimpMeshPtr mesh = std::make_shared<AssimpMesh>();
+	uint32_t hasBones = 0, boneCount = 0;
+	Eigen::Vector3f aabbMin, aabbMax;
+	reader.Read(mesh->mName);
+	reader.Read(mesh->mSceneMeshIndex);
+	reader.Read(hasBones);
+	reader.Read(aabbMin);
+	reader.Read(aabbMax);
+	mesh->mHasBones = hasBones != 0;
+	mesh->mAABB = Eigen::AlignedBox3f(aabbMin, aabbMax);
+
+	reader.Read(boneCount);
+	for (uint32_t i = 0; reader && i < boneCount; ++i) {
+		AiBone bone;
+		reader.Read(bone.mName);
+		reader.Read(bone.mOffsetMatrix);
+		mesh->mBones.push_back(std::move(bone));
+	}
+
+	AiMeshStreams stream;
+	reader.ReadStream(stream.Surface);
+	reader.ReadStream(stream.Skeleton);
+	reader.ReadStream(stream.Indices);
+	Data clusters;
+	if (!reader.ReadStream(clusters)) return nullptr;
+	const MeshCluster* first = (const MeshCluster*)clusters.Bytes;
+	mesh->mClusters.assign(first, first + clusters.Size / sizeof(MeshCluster));
+	streams.push_back(stream);
+	return mesh;
+}
+
+AnimationClipPtr AiSceneCache::ReadClip(Reader& reader)
+{
+	AnimationClipPtr clip = CreateInstance<AnimationClip>();
+	uint32_t channelCount = 0;
+	reader.Read(clip->mName);
+	reader.Read(clip->mDuration);
+	reader.Read(clip->mTicksPerSecond);
+	reader.Read(channelCount);
+	for (uint32_t i = 0; reader && i < channelCount; ++i) {
+		AnimationChannel channel;
+		reader.Read(channel.NodeName);
+		reader.Read(channel.Position);
+		reader.Read(channel.Rotation);
+		reader.Read(channel.Scaling);
+		clip->mChannels.push_back(std::move(channel));
+	}
+
+	//keys are small next to the vertices, the clip owns a copy
+	Data keys;
+	if (!reader.ReadStream(keys)) return nullptr;
+	const AnimationKey* first = (const AnimationKey*)keys.Bytes;
+	clip->mKeys.assign(first, first + keys.Size / sizeof(AnimationKey));
+	return clip;
+}
+
+bool AiSceneCache::Write(const std::string& cachePath, const SourceFiles& files, const Settings& settings, const AiScene& scene)
+{
+	TIME_PROFILE("\t\taiSceneCache.Write " + cachePath);
+	ShaderCacheDigest sourceHash;
+	if (scene.mRootNode == nullptr || !MakeSourceHash(files, sourceHash))
+		return false;
+
+	Writer writer;
+	MirMeshHeader header = {};
+	header.Magic = MIRMESH_MAGIC;
+	header.Version = MIRMESH_VERSION;
+	header.ImportFlags = settings.ImportFlags;
+	header.PaletteSize = settings.PaletteSize;
+	header.OptimizeFlags = settings.OptimizeFlags;
+	header.VertexLimit = settings.VertexLimit;
+	header.SurfaceStride = sizeof(vbSurface);
+	header.SkeletonStride = sizeof(vbSkeleton);
+	header.SourceHash = sourceHash;
+	header.SourceStamp = files.Stamp;
+	writer.Write(header);
+
+	writer.Write(uint32_t(scene.mNodes.size()));
+	WriteNode(writer, *scene.mRootNode);
+	writer.Write(uint32_t(scene.mAnimations.size()));
+	for (const auto& clip : scene.mAnimations)
+		WriteClip(writer, *clip);
+
+	auto& bytes = writer.Bytes();
+	((MirMeshHeader*)&bytes[0])->FileSize = bytes.size();
+
+	//written aside and renamed, a loader never maps a torn file
+	std::string tempPath = cachePath + ".tmp";
+	{
+		std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+		if (!file.write(&bytes[0], bytes.size())) {
+			DEBUG_LOG_ERROR("aiSceneCache.Write failed " + tempPath);
+			return false;
+		}
+	}
+	boost::system::error_code ec;
+	boost::filesystem::rename(tempPath, cachePath, ec);
+	if (ec) {
+		boost::filesystem::remove(tempPath, ec);
+		DEBUG_LOG_ERROR("aiSceneCache.Write rename failed " + cachePath);
+		return false;
+	}
+	DEBUG_LOG_INFO((boost::format("aiSceneCache.Write %1% (%2% bytes)") % cachePath % bytes.size()).str());
+	return true;
+}
+
+void AiSceneCache::WriteNode(Writer& writer, const AiNode& node)
+{
+	writer.Write(node.mName);
+	writer.Write(node.mLocalTransform);
+	writer.Write(uint32_t(node.Meshes.size()));
+	for (const auto& mesh : node.Meshes)
+		WriteMesh(writer, *mesh);
+	writer.Write(uint32_t(node.Children.size()));
+	for (const auto& child : node.Children)
+		WriteNode(writer, *child);
+}
+
+void AiSceneCache::WriteMesh(Writer& writer, const AssimpMesh& mesh)
+{
+	writer.Write(mesh.mName);
+	writer.Write(mesh.mSceneMeshIndex);
+	writer.Write(uint32_t(mesh.mHasBones));
+	writer.Write(Eigen::Vector3f(mesh.mAABB.min()));
+	writer.Write(Eigen::Vector3f(mesh.mAABB.max()));
+	writer.Write(uint32_t(mesh.mBones.size()));
+	for (const auto& bone : mesh.mBones) {
+		writer.Write(bone.mName);
+		writer.Write(bone.mOffsetMatrix);
+	}
+	writer.WriteStream(mesh.mSurfVertexs);
+	writer.WriteStream(mesh.mSkeletonVertexs);
+	writer.WriteStream(mesh.mIndices);
+	writer.WriteStream(mesh.mClusters);
+}
+
+void AiSceneCache::WriteClip(Writer& writer, const AnimationClip& clip)
+{
+	writer.Write(clip.mName);
+	writer.Write(clip.mDuration);
+	writer.Write(clip.mTicksPerSecond);
+	writer.Write(uint32_t(clip.mChannels.size()));
+	for (const auto& channel : clip.mChannels) {
+		writer.Write(channel.NodeName);
+		writer.Write(channel.Position);
+		writer.Write(channel.Rotation);
+		writer.Write(channel.Scaling);
+	}
+	writer.WriteStream(clip.mKeys);
+}
+
+}
+}
@@ -0,0 +1,55 @@
+#pragma once
+#include <boost/noncopyable.hpp>
+#include "core/base/stl.h"
+#include "core/base/declare_macros.h"
+#include "core/resource/predeclare.h"
+#include "core/resource/assimp_mesh.h"
+#include "core/resource/shader_cache_archive.h"
+
+namespace mir {
+namespace res {
+
+/* <asset>.mirmesh, an imported AiScene in engine layout: written after the import, mapped on the next loads so Assimp doesn't run.
+ * the header keeps the md5 of the source files, a stamp of their sizes and write times that spares hashing them while it matches, and the import settings (flags, palette size, MeshOptimizer flags, vertex limit, vertex strides), any mismatch re-imports.
+ * nodes follow in serialize order, each followed by its meshes, then the clips. the streams are 16 bytes aligned,
+ * Read points them into the view so the buffers are created from the mapping, it stays mapped until Close. */
+class AiSceneCache : boost::noncopyable
+{
+public:
+	struct Settings {
+		uint32_t ImportFlags, PaletteSize, OptimizeFlags, VertexLimit;
+	};
+	/* the asset, then the buffer files a .gltf references */
+	struct SourceFiles {
+		std::vector<std::string> Paths;
+		uint64_t Stamp = 0;//of the sizes and write times
+	};
+	~AiSceneCache();
+	static std::string MakeCachePath(const std::string& assetPath);
+	static bool GetSourceFiles(const std::string& assetPath, SourceFiles& files);
+	static bool MakeSourceHash(const SourceFiles& files, ShaderCacheDigest& hash);
+
+	/* the sources are hashed only when their stamp differs from the header's */
+	bool Open(const std::string& cachePath, const SourceFiles& files, const Settings& settings);
+	/* fills the nodes, meshes (no materials, no buffers) and clips of scene, streams is parallel to scene.mMeshes */
+	bool Read(AiScene& scene, std::vector<AiMeshStreams>& streams) const;
+	void Close();
+	static bool Write(const std::string& cachePath, const SourceFiles& files, const Settings& settings, const AiScene& scene);
+private:
+	class Writer;
+	class Reader;
+	static void WriteNode(Writer& writer, const AiNode& node);
+	static void WriteMesh(Writer& writer, const AssimpMesh& mesh);
+	static void WriteClip(Writer& writer, const AnimationClip& clip);
+	static AiNodePtr ReadNode(Reader& reader, AiScene& scene, std::vector<AiMeshStreams>& streams);
+	static AssimpMeshPtr ReadMesh(Reader& reader, std::vector<AiMeshStreams>& streams);
+	static AnimationClipPtr ReadClip(Reader& reader);
+private:
+	void* mFile = nullptr;
+	void* mMapping = nullptr;
+	const char* mView = nullptr;
+	size_t mViewSize = 0;
+};
+
+}
+}
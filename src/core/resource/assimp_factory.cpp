@@ -16,13 +16,20 @@
 #include <assimp/LogStream.hpp>
 #include <assimp/DefaultLogger.hpp>
 #include <unordered_map>
+#include <algorithm>
+#include <numeric>
 #include "core/base/debug.h"
 #include "core/base/macros.h"
+#include "core/base/uniform_struct.h"
 #include "core/resource/assimp_factory.h"
 #include "core/resource/assimp_resource.h"
+#include "core/resource/assimp_cache.h"
+#include "core/resource/gltf_document.h"
+#include "core/resource/animation_clip.h"
 #include "core/resource/material_name.h"
 #include "core/resource/material.h"
 #include "core/resource/material_factory.h"
+#include "core/resource/mesh_optimizer.h"
 #include "core/resource/resource_manager.h"
 
 #define VEC_ASSIGN(DST, SRC) static_assert(sizeof(DST) == sizeof(SRC)); memcpy(DST.data(), &SRC, sizeof(SRC))
@@ -30,10 +37,69 @@
 #define VEC_ASSIGN2(DST, SRC, SIZE) memcpy(DST.data(), &SRC, sizeof(SRC))
 
 //#define ENABLE_STANDALONE_OBJ_LOADER 1
+#define MIR_MESH_CACHE
+#define MIR_NATIVE_GLTF
 
 namespace mir {
 namespace res {
 
+/* copies one attribute of count vertices between strided streams, Size is a compile time constant
+ * so the copy inlines into plain (vectorizable) moves instead of a memcpy call per vertex */
+template<size_t Size> static void InterleaveAttribute(void* dst, size_t dstStride, const void* src, size_t srcStride, size_t count)
+{
+	char* d = static_cast<char*>(dst);
+	const char* s = static_cast<const char*>(src);
+	for (size_t i = 0; i < count; ++i, d += dstStride, s += srcStride)
+		memcpy(d, s, Size);
+}
+
+/* per vertex tangent frames from the uv gradients of the triangles around it, for meshes that come without tangents */
+static void ReCalculateTangents(vbSurfaceVector& surfVerts, vbSkeletonVector& skeletonVerts, const std::vector<uint32_t>& indices)
+{
+	for (int i = 0; i < indices.size(); i += 3) {
+		//vbSurface
+		vbSurface& surf0 = surfVerts[indices[i + 0]];
+		vbSurface& surf1 = surfVerts[indices[i + 1]];
+		vbSurface& surf2 = surfVerts[indices[i + 2]];
+
+		// Shortcuts for UVs
+		Eigen::Vector2f& uv0 = surf0.Tex;
+		Eigen::Vector2f& uv1 = surf1.Tex;
+		Eigen::Vector2f& uv2 = surf2.Tex;
+
+		// Edges of the triangle : postion delta
+		Eigen::Vector3f deltaPos1 = surf1.Pos - surf0.Pos;
+		Eigen::Vector3f deltaPos2 = surf2.Pos - surf0.Pos;
+
+		//vbSkeleton
+		vbSkeleton& skin0 = skeletonVerts[indices[i + 0]];
+		vbSkeleton& skin1 = skeletonVerts[indices[i + 1]];
+		vbSkeleton& skin2 = skeletonVerts[indices[i + 2]];
+		Eigen::Vector2f deltaUV1 = uv1 - uv0;
+		Eigen::Vector2f deltaUV2 = uv2 - uv0;
+		float det = deltaUV1.x() * deltaUV2.y() - deltaUV1.y() * deltaUV2.x();
+		if (det == 0.0f) continue;
+		float r = 1.0f / det;
+		Eigen::Vector3f tangent = (deltaPos1 * deltaUV2.y() - deltaPos2 * deltaUV1.y()) * r; tangent.normalize();
+		skin0.Tangent.head<3>() = skin0.Tangent.head<3>() + tangent;
+		skin1.Tangent.head<3>() = skin1.Tangent.head<3>() + tangent;
+		skin2.Tangent.head<3>() = skin2.Tangent.head<3>() + tangent;
+
+		Eigen::Vector3f bitangent = (deltaPos2 * deltaUV1.x() - deltaPos1 * deltaUV2.x()) * r; bitangent.normalize();
+		skin0.BiTangent = skin0.BiTangent + bitangent;
+		skin1.BiTangent = skin1.BiTangent + bitangent;
+		skin2.BiTangent = skin2.BiTangent + bitangent;
+	}
+	for (auto& skin : skeletonVerts) {
+		skin.Tangent.head<3>().normalize();
+		skin.BiTangent.normalize();
+
+		float dp = skin.BiTangent.head<3>().dot(skin.Normal.cross(skin.Tangent.head<3>()));
+		if (dp < 0.0f) skin.Tangent.w() = -1.0;
+		else skin.Tangent.w() = 1.0;
+	}
+}
+
 /********** AiSceneLoader **********/
 struct ResourceRedirector {
 public:
@@ -47,10 +113,16 @@ public:
 			boost_property_tree::read_json(std::stringstream(redirectResource), pt);
 			mRedirectResourceDir = pt.get<std::string>("dir", "");
 			mRedirectResourceExt = pt.get<std::string>("ext", "");
+			mOptimizeFlags = ParseOptimizeFlags(pt.get<std::string>("optimize", ""));
+			mCompactVertex = pt.get<std::string>("vertex", "") == "compact";
+			mSplitIndex16 = pt.get<std::string>("index", "") == "split16";
 		}
 		else {
 			mRedirectResourceDir.clear();
 			mRedirectResourceExt.clear();
+			mOptimizeFlags = MeshOptimizer::kOptimizeDefault;
+			mCompactVertex = false;
+			mSplitIndex16 = false;
 		}
 
 		if (!mRedirectResourceDir.empty()) {
@@ -67,9 +139,34 @@ public:
 		else return result.append(path.string());
 	}
 	const boost::filesystem::path& GetResFullPath() const { return mResFullPath; }
+	int GetOptimizeFlags() const { return mOptimizeFlags; }
+	/* "vertex": "compact" builds the meshes in vbSurfaceCompact + vbSkeletonCompact */
+	bool IsCompactVertex() const { return mCompactVertex; }
+	/* "index": "split16" splits the meshes over kIndex16VertexLimit vertices so every part is 16 bit indexed */
+	uint32_t GetVertexLimit() const { return mSplitIndex16 ? kIndex16VertexLimit : 0; }
+private:
+	/* "optimize": "vcache|overdraw|fetch|cluster", "none" turns it off, empty is MeshOptimizer::kOptimizeDefault */
+	static int ParseOptimizeFlags(const std::string& desc) {
+		if (desc.empty()) return MeshOptimizer::kOptimizeDefault;
+
+		std::vector<std::string> names;
+		boost::split(names, desc, boost::is_any_of("|, "), boost::token_compress_on);
+		int flags = 0;
+		for (const auto& name : names) {
+			if (name == "vcache") flags |= MeshOptimizer::kOptimizeVertexCache;
+			else if (name == "overdraw") flags |= MeshOptimizer::kOptimizeVertexCache | MeshOptimizer::kOptimizeOverdraw;
+			else if (name == "fetch") flags |= MeshOptimizer::kOptimizeVertexFetch;
+			else if (name == "cluster") flags |= MeshOptimizer::kOptimizeCluster;
+			else if (name != "none") DEBUG_LOG_ERROR("ResourceRedirector unknown optimize " + name);
+		}
+		return flags;
+	}
 private:
 	boost::filesystem::path mResFullPath;
 	std::string mRedirectResourceDir, mRedirectResourceExt;
+	int mOptimizeFlags = MeshOptimizer::kOptimizeDefault;
+	bool mCompactVertex = false;
+	bool mSplitIndex16 = false;
 };
 
 class AiSceneLoader {
@@ -86,6 +183,14 @@ public:
 		CoAwait mResMng.SwitchToLaunchService(mLaunchMode);
 
 		mAsset.SetLoaded(ExecuteLoadRawData(std::forward<T>(args)...) && CoAwait ExecuteSetupData());
+
+		//everything the scene keeps is engine owned now
+		delete mAssetImporter;
+		mAssetImporter = nullptr;
+		mAssetScene = nullptr;
+		mCache = nullptr;
+		mCacheStreams.clear();
+		mGltf = nullptr;
 		return mAsset.IsLoaded();
 	}
 	TemplateArgs CoTask<bool> operator()(T &&...args) {
@@ -114,6 +219,14 @@ private:
 				aiProcess_OptimizeMeshes |
 				aiProcess_Debone |
 				aiProcess_ValidateDataStructure;*/
+		#if defined MIR_MESH_CACHE
+			if (LoadCache(ImportFlags))
+				return true;
+		#endif
+		#if defined MIR_NATIVE_GLTF
+			if (LoadGltf())
+				return true;
+		#endif
 			mAssetImporter = new Assimp::Importer;
 			mAssetScene = const_cast<Assimp::Importer*>(mAssetImporter)->ReadFile(mRedirectPathOnDir.GetResFullPath().string(), ImportFlags);
 		}
@@ -123,64 +236,248 @@ private:
 		}
 		return mAssetScene != nullptr;
 	}
+	bool LoadCache(uint32_t importFlags)
+	{
+		std::string assetPath = mRedirectPathOnDir.GetResFullPath().string();
+		mCachePath = AiSceneCache::MakeCachePath(assetPath);
+		mCacheSettings = AiSceneCache::Settings{ importFlags, cbWeightedSkin::kModelCount, uint32_t(mRedirectPathOnDir.GetOptimizeFlags()), mRedirectPathOnDir.GetVertexLimit() };
+		if (!AiSceneCache::GetSourceFiles(assetPath, mSourceFiles))
+			return false;
+
+		mWriteCache = true;
+		mCache = std::make_unique<AiSceneCache>();
+		if (mCache->Open(mCachePath, mSourceFiles, mCacheSettings) && mCache->Read(mAsset, mCacheStreams)) {
+			mWriteCache = false;
+			return true;
+		}
+
+		//stale or broken, import again and rewrite it
+		mCache = nullptr;
+		mCacheStreams.clear();
+		mAsset.mRootNode = nullptr;
+		mAsset.mNodes.clear();
+		mAsset.mMeshes.clear();
+		mAsset.mAnimations.clear();
+		return false;
+	}
+	/* .gltf and .glb are read by GltfDocument when it can, Assimp reads the rest */
+	bool LoadGltf()
+	{
+		std::string assetPath = mRedirectPathOnDir.GetResFullPath().string();
+		if (!GltfDocument::IsGltfPath(assetPath))
+			return false;
+
+		mGltf = std::make_unique<GltfDocument>();
+		if (mGltf->Open(assetPath))
+			return true;
+		mGltf = nullptr;
+		return false;
+	}
 	CoTask<bool> ExecuteSetupData()
 	{
 		COROUTINE_VARIABLES;
-		BOOST_ASSERT(mAssetScene != nullptr);
+		BOOST_ASSERT(mAssetScene != nullptr || mCache != nullptr || mGltf != nullptr);
 
-		if (mAssetScene->mNumAnimations > 0) {
-			mAsset.mAnimations.resize(mAssetScene->mNumAnimations);
-			memcpy(&mAsset.mAnimations[0], &mAssetScene->mAnimations[0], mAssetScene->mNumAnimations * sizeof(mAssetScene->mAnimations[0]));
+		std::vector<CoTask<bool>> tasks;
+		if (mCache) {
+			SetupCachedMeshes(tasks);
 		}
+		else if (mGltf) {
+			for (const auto& anim : mGltf->GetAnimations())
+				mAsset.mAnimations.push_back(BuildGltfClip(anim));
 
-		std::vector<CoTask<bool>> tasks;
-		mAsset.mRootNode = ProcessNode(mAssetScene->mRootNode, mAssetScene, tasks);
+			std::vector<MeshJob> jobs;
+			for (int root : mGltf->GetRootNodes())
+				CollectGltfMeshJobs(root, jobs);
+			CoAwait ProcessMeshJobs(jobs);
+
+			size_t jobIndex = 0;
+			const auto& roots = mGltf->GetRootNodes();
+			if (roots.size() == 1) {
+				mAsset.mRootNode = ProcessGltfNode(roots[0], jobs, jobIndex, tasks);
+			}
+			else {
+				//several roots hang under one, as Assimp's glTF importer does
+				mAsset.mRootNode = mAsset.AddNode();
+				mAsset.mRootNode->mName = "ROOT";
+				mAsset.mRootNode->mLocalTransform = mAsset.mRootNode->mGlobalTransform = Eigen::Matrix4f::Identity();
+				for (int root : roots)
+					mAsset.mRootNode->AddChild(ProcessGltfNode(root, jobs, jobIndex, tasks));
+			}
+		}
+		else {
+			mAsset.mAnimations.resize(mAssetScene->mNumAnimations);
+			for (unsigned i = 0; i < mAssetScene->mNumAnimations; ++i)
+				mAsset.mAnimations[i] = AnimationClip::Build(*mAssetScene->mAnimations[i]);
+
+			std::vector<MeshJob> jobs;
+			CollectMeshJobs(mAssetScene->mRootNode, mAssetScene, jobs);
+			CoAwait ProcessMeshJobs(jobs);
+
+			size_t jobIndex = 0;
+			mAsset.mRootNode = ProcessNode(mAssetScene->mRootNode, jobs, jobIndex, tasks);
+		}
+		mAsset.mSkeleton.Build(mAsset.mNodes);
+		BindAnimations();
 		CoAwait WhenAllReady(std::move(tasks));
 
 		for (const auto& mesh : mAsset.GetMeshes()) {
 			for (auto& bone : mesh->mBones) {
-				bone.mRelateNode = mAsset.FindNodeByName(bone.mName);
+				AiNodePtr boneNode = mAsset.FindNodeByName(bone.mName);
+				bone.mNodeIndex = boneNode ? int(boneNode->SerilizeIndex) : -1;
+			}
+			if (mesh->mMaterial) {
+				mesh->mMaterial.SetCbUploadSize(MAKE_CBNAME(cbWeightedSkin), cbWeightedSkin::UploadSize(mesh->mBones.size()));
+				if (mesh->IsCompactVertex()) {
+					mesh->mMaterial.SetProperty("PositionQuantScale", mesh->mQuantization.Scale);
+					mesh->mMaterial.SetProperty("PositionQuantOffset", mesh->mQuantization.Offset);
+				}
 			}
 		}
+
+	#if defined MIR_MESH_CACHE
+		if (mWriteCache) AiSceneCache::Write(mCachePath, mSourceFiles, mCacheSettings, mAsset);
+	#endif
 		CoReturn true;
 	}
 private:
-	AiNodePtr ProcessNode(const aiNode* rawNode, const aiScene* rawScene, std::vector<CoTask<bool>>& tasks) {
+	void BindAnimations() {
+		std::unordered_map<std::string, int> nodeByName;
+		for (const auto& node : mAsset.mNodes)
+			nodeByName.emplace(node->mName, int(node->SerilizeIndex));
+
+		mAsset.mAnimationBindings.resize(mAsset.mAnimations.size());
+		for (size_t i = 0; i < mAsset.mAnimations.size(); ++i) {
+			const AnimationClip& clip = *mAsset.mAnimations[i];
+			auto& binding = mAsset.mAnimationBindings[i];
+			binding.assign(mAsset.mNodes.size(), -1);
+			for (size_t channel = 0; channel < clip.ChannelCount(); ++channel) {
+				auto find_iter = nodeByName.find(clip.GetChannel(channel).NodeName);
+				if (find_iter != nodeByName.end()) 
+					binding[find_iter->second] = int(channel);
+			}
+		}
+	}
+	/* one job per mesh of a node, in the order ProcessNode visits them.
+	 * a glTF job has no RawMesh, it names the node and the primitive of the node's mesh */
+	struct MeshJob {
+		const aiMesh* RawMesh;
+		int MeshIndex;
+		std::vector<AssimpMeshPtr> Parts;
+		int GltfNode = -1, GltfPrimitive = -1;
+	};
+	enum { kMeshBatchVertices = 64 * 1024 };
+	void CollectMeshJobs(const aiNode* rawNode, const aiScene* rawScene, std::vector<MeshJob>& jobs) const {
+		for (unsigned i = 0; i < rawNode->mNumMeshes; i++) {
+			unsigned meshIndex = rawNode->mMeshes[i];
+			jobs.push_back(MeshJob{ rawScene->mMeshes[meshIndex], int(meshIndex) });
+		}
+		for (unsigned i = 0; i < rawNode->mNumChildren; i++)
+			CollectMeshJobs(rawNode->mChildren[i], rawScene, jobs);
+	}
+	/* the meshes are converted (and their buffers created) on the thread pool, in batches of about kMeshBatchVertices */
+	CoTask<void> ProcessMeshJobs(std::vector<MeshJob>& jobs) {
+		std::vector<std::pair<size_t, size_t>> ranges;
+		size_t first = 0, vertexCount = 0;
+		for (size_t i = 0; i < jobs.size(); ++i) {
+			vertexCount += GetVertexCount(jobs[i]);
+			if (vertexCount >= kMeshBatchVertices || i + 1 == jobs.size()) {
+				ranges.push_back(std::make_pair(first, i + 1));
+				first = i + 1;
+				vertexCount = 0;
+			}
+		}
+
+		if (ranges.size() > 1) {
+			std::vector<CoTask<void>> batches;
+			batches.reserve(ranges.size());
+			for (const auto& range : ranges)
+				batches.push_back(ProcessMeshBatch(jobs, range.first, range.second));
+			CoAwait WhenAllReady(std::move(batches));
+			CoAwait mResMng.SwitchToLaunchService(mLaunchMode);
+		}
+		else {
+			for (auto& job : jobs)
+				job.Parts = ProcessMeshJob(job);
+		}
+		CoReturn;
+	}
+	CoTask<void> ProcessMeshBatch(std::vector<MeshJob>& jobs, size_t first, size_t last) ThreadSafe {
+		COROUTINE_VARIABLES_2(first, last);
+		CoAwait mResMng.SwitchToLaunchService(LaunchAsync);
+
+		for (size_t i = first; i < last; ++i)
+			jobs[i].Parts = ProcessMeshJob(jobs[i]);
+		CoReturn;
+	}
+	size_t GetVertexCount(const MeshJob& job) const {
+		if (job.RawMesh) return job.RawMesh->mNumVertices;
+		const auto& node = mGltf->GetNodes()[job.GltfNode];
+		return mGltf->GetAccessor(mGltf->GetMeshes()[node.Mesh].Primitives[job.GltfPrimitive].Position).Count;
+	}
+	std::vector<AssimpMeshPtr> ProcessMeshJob(const MeshJob& job) const ThreadSafe {
+		return job.RawMesh ? ProcessMesh(job.RawMesh, job.MeshIndex) : ProcessGltfPrimitive(job);
+	}
+	AiNodePtr ProcessNode(const aiNode* rawNode, std::vector<MeshJob>& jobs, size_t& jobIndex, std::vector<CoTask<bool>>& tasks) {
 		AiNodePtr node = mAsset.AddNode();
-		COROUTINE_VARIABLES_2(node, rawScene);
+		COROUTINE_VARIABLES_1(node);
 
 		node->mName = rawNode->mName.C_Str();
 		node->mLocalTransform = node->mGlobalTransform = *(const Eigen::Matrix4f*)&rawNode->mTransformation;
-		for (int i = 0; i < rawNode->mNumMeshes; i++) {
-			unsigned meshIndex = rawNode->mMeshes[i];
-			aiMesh* rawMesh = rawScene->mMeshes[meshIndex];
-			node->AddMesh(ProcessMesh(rawMesh, meshIndex, rawScene, tasks));
-		}
+		for (unsigned i = 0; i < rawNode->mNumMeshes; i++)
+			AddMeshParts(node, jobs[jobIndex++].Parts, tasks);
 
-		for (int i = 0; i < rawNode->mNumChildren; i++) {
-			node->AddChild(ProcessNode(rawNode->mChildren[i], rawScene, tasks));
+		for (unsigned i = 0; i < rawNode->mNumChildren; i++) {
+			node->AddChild(ProcessNode(rawNode->mChildren[i], jobs, jobIndex, tasks));
 		}
 		return node;
 	}
+	/* each part draws with its own material, the palette lives in its per-instance cbWeightedSkin */
+	void AddMeshParts(const AiNodePtr& node, const std::vector<AssimpMeshPtr>& parts, std::vector<CoTask<bool>>& tasks) {
+		for (const auto& mesh : parts) {
+			mAsset.AddMesh(mesh);
+			tasks.push_back(mResMng.CreateMaterial(mesh->mMaterial, mLaunchMode, MakeMaterialLoadParam(mesh->mName)));
+			if (!mResMng.SupportMTResCreation()) tasks.push_back(mesh->BuildSync(mResMng));
+			node->AddMesh(mesh);
+		}
+	}
 	
-	AssimpMeshPtr ProcessMesh(const aiMesh* rawMesh, int meshIndex, const aiScene* scene, std::vector<CoTask<bool>>& tasks) const {
-		COROUTINE_VARIABLES_2(rawMesh, scene);
-
-		AssimpMeshPtr meshPtr = mAsset.AddMesh();
+	MaterialLoadParam MakeMaterialLoadParam(const std::string& meshName) const {
+		boost::filesystem::path matPath = mRedirectPathOnDir(boost::filesystem::path(meshName + ".Material"));
+		MaterialLoadParam loadParam = mLoadParam;
+		loadParam.ShaderVariantName = boost::filesystem::is_regular_file(matPath) ? matPath.string() : MAT_MODEL;
+		if (mRedirectPathOnDir.IsCompactVertex()) {
+			MaterialLoadParamBuilder builder(loadParam);
+			builder["VERTEX_COMPACT"] = 1;
+			loadParam = builder.Build();
+		}
+		return loadParam;
+	}
+	/* the meshes come from the mapped cache, only materials and buffers are left to create */
+	void SetupCachedMeshes(std::vector<CoTask<bool>>& tasks) const {
+		for (size_t i = 0; i < mAsset.mMeshes.size(); ++i) {
+			auto& mesh = *mAsset.mMeshes[i];
+			mesh.SetCompactVertex(mRedirectPathOnDir.IsCompactVertex());
+			tasks.push_back(mResMng.CreateMaterial(mesh.mMaterial, mLaunchMode, MakeMaterialLoadParam(mesh.mName)));
+			if (mResMng.SupportMTResCreation()) mesh.Build(mLaunchMode, mResMng, mCacheStreams[i]);
+			else tasks.push_back(mesh.BuildSync(mResMng, mCacheStreams[i]));
+		}
+	}
+	/* converts a node mesh into engine meshes (several when split by the palette), only touches the raw mesh
+	 * and the meshes it returns so it runs on the thread pool. the buffers are built here when the device allows */
+	std::vector<AssimpMeshPtr> ProcessMesh(const aiMesh* rawMesh, int meshIndex) const ThreadSafe {
+		AssimpMeshPtr meshPtr = std::make_shared<AssimpMesh>();
 		auto& mesh = *meshPtr;
 		mesh.mHasBones = rawMesh->HasBones();
 		mesh.mSceneMeshIndex = meshIndex;
 
+		mesh.mName = rawMesh->mName.C_Str();
+
 		const aiVector3D& mmin = rawMesh->mAABB.mMin, &mmax = rawMesh->mAABB.mMax;
 		mesh.mAABB = Eigen::AlignedBox3f();
 		mesh.mAABB.extend(Eigen::Vector3f(mmin.x, mmin.y, mmin.z));
 		mesh.mAABB.extend(Eigen::Vector3f(mmax.x, mmax.y, mmax.z));
 
-		boost::filesystem::path matPath = mRedirectPathOnDir(boost::filesystem::path(std::string(rawMesh->mName.C_Str()) + ".Material"));
-		MaterialLoadParam loadParam = mLoadParam;
-		loadParam.ShaderVariantName = boost::filesystem::is_regular_file(matPath) ? matPath.string() : MAT_MODEL;
-		tasks.push_back(mResMng.CreateMaterial(mesh.mMaterial, mLaunchMode, loadParam));
-
 		if (rawMesh->mNumBones > 0) {
 			mesh.mBones.resize(rawMesh->mNumBones);
 			for (size_t i = 0; i < mesh.mBones.size(); ++i) {
@@ -194,57 +491,26 @@ private:
 					static_assert(sizeof(dst.mWeights[0]) == sizeof(src.mWeights[0]), "");
 				}
 			}
-			memcpy(&mesh.mBones[0], rawMesh->mBones, rawMesh->mNumBones * sizeof(rawMesh->mBones[0]));
 		}
 
 		auto& surfVerts = mesh.mSurfVertexs; surfVerts.resize(rawMesh->mNumVertices);
 		auto& skeletonVerts = mesh.mSkeletonVertexs; skeletonVerts.resize(rawMesh->mNumVertices);
-		for (size_t vertexId = 0; vertexId < rawMesh->mNumVertices; vertexId++) {
-		#if !defined EIGEN_DONT_ALIGN_STATICALLY
-			surfVerts[vertexId].Pos = AS_CONST_REF(Eigen::Vector3f, rawMesh->mVertices[vertexId]);
-		#else
-			VEC_ASSIGN(surfVerts[vertexId].Pos, rawMesh->mVertices[vertexId]);
-		#endif
-		}
-		if (rawMesh->mTextureCoords[0]) {
-			const auto& meshTexCoord0 = rawMesh->mTextureCoords[0];
-			for (size_t vertexId = 0; vertexId < rawMesh->mNumVertices; vertexId++) {
-			#if !defined EIGEN_DONT_ALIGN_STATICALLY
-				surfVerts[vertexId].Tex.x() = meshTexCoord0[vertexId].x;
-				surfVerts[vertexId].Tex.y() = meshTexCoord0[vertexId].y;
-			#else
-				VEC_ASSIGN1(surfVerts[vertexId].Tex, meshTexCoord0[vertexId], sizeof(Eigen::Vector2f));
-			#endif
-			}
-		}
-		if (rawMesh->mNormals) {
-			for (size_t vertexId = 0; vertexId < rawMesh->mNumVertices; vertexId++) {
-			#if !defined EIGEN_DONT_ALIGN_STATICALLY
-				skeletonVerts[vertexId].Normal = AS_CONST_REF(Eigen::Vector3f, rawMesh->mNormals[vertexId]);
-			#else
-				VEC_ASSIGN(skeletonVerts[vertexId].Normal, rawMesh->mNormals[vertexId]);
-			#endif
-			}
-		}
-		if (rawMesh->mTangents) {
-			for (size_t vertexId = 0; vertexId < rawMesh->mNumVertices; vertexId++) {
-			#if !defined EIGEN_DONT_ALIGN_STATICALLY
-				skeletonVerts[vertexId].Tangent = AS_CONST_REF(Eigen::Vector3f, rawMesh->mTangents[vertexId]);
-			#else
-				VEC_ASSIGN2(skeletonVerts[vertexId].Tangent, rawMesh->mTangents[vertexId]);
-				skeletonVerts[vertexId].Tangent.w() = 1.0f;
-			#endif
-			}
-		}
-		if (rawMesh->mBitangents) {
-			for (size_t vertexId = 0; vertexId < rawMesh->mNumVertices; vertexId++) {
-			#if !defined EIGEN_DONT_ALIGN_STATICALLY
-				skeletonVerts[vertexId].BiTangent = AS_CONST_REF(Eigen::Vector3f, rawMesh->mBitangents[vertexId]);
-			#else
-				VEC_ASSIGN(skeletonVerts[vertexId].BiTangent, rawMesh->mBitangents[vertexId]);
-			#endif
+		const size_t vertexCount = rawMesh->mNumVertices;
+		if (vertexCount > 0) {
+			InterleaveAttribute<sizeof(Eigen::Vector3f)>(surfVerts[0].Pos.data(), sizeof(vbSurface), rawMesh->mVertices, sizeof(aiVector3D), vertexCount);
+			if (rawMesh->mTextureCoords[0])
+				InterleaveAttribute<sizeof(Eigen::Vector2f)>(surfVerts[0].Tex.data(), sizeof(vbSurface), rawMesh->mTextureCoords[0], sizeof(aiVector3D), vertexCount);
+			if (rawMesh->mNormals)
+				InterleaveAttribute<sizeof(Eigen::Vector3f)>(skeletonVerts[0].Normal.data(), sizeof(vbSkeleton), rawMesh->mNormals, sizeof(aiVector3D), vertexCount);
+			if (rawMesh->mTangents) {
+				InterleaveAttribute<sizeof(aiVector3D)>(skeletonVerts[0].Tangent.data(), sizeof(vbSkeleton), rawMesh->mTangents, sizeof(aiVector3D), vertexCount);
+				for (auto& vert : skeletonVerts)
+					vert.Tangent.w() = 1.0f;
 			}
+			if (rawMesh->mBitangents)
+				InterleaveAttribute<sizeof(Eigen::Vector3f)>(skeletonVerts[0].BiTangent.data(), sizeof(vbSkeleton), rawMesh->mBitangents, sizeof(aiVector3D), vertexCount);
 		}
+
 		if (rawMesh->HasBones()) {
 			std::vector<int> spMap(skeletonVerts.size(), 0);
 			for (size_t boneId = 0; boneId < rawMesh->mNumBones; ++boneId) {
@@ -280,10 +546,399 @@ private:
 				std::swap(indices[j + 1], indices[j + 2]);
 		#endif
 		}
+		return FinishMesh(meshPtr, rawMesh->mPrimitiveTypes == aiPrimitiveType_TRIANGLE);
+	}
+	/* the steps after the conversion: optimized and split when a triangle mesh, partitioned by palette,
+	 * then the parts are built when the device allows */
+	std::vector<AssimpMeshPtr> FinishMesh(const AssimpMeshPtr& meshPtr, bool triangles) const ThreadSafe {
+		if (triangles)
+			OptimizeMesh(*meshPtr);
+
+		std::vector<AssimpMeshPtr> parts = PartitionByPalette<cbWeightedSkin::kModelCount>(meshPtr);
+		const size_t vertexLimit = mRedirectPathOnDir.GetVertexLimit();
+		if (vertexLimit && triangles) {
+			std::vector<AssimpMeshPtr> chunks;
+			for (const auto& part : parts) {
+				auto partChunks = SplitByVertexLimit(part, vertexLimit);
+				chunks.insert(chunks.end(), partChunks.begin(), partChunks.end());
+			}
+			parts.swap(chunks);
+		}
+		for (const auto& part : parts) {
+			part->SetCompactVertex(mRedirectPathOnDir.IsCompactVertex());
+			if (mResMng.SupportMTResCreation()) part->Build(mLaunchMode, mResMng);
+		}
+		return parts;
+	}
+	/* glTF matrices are column vector ones, the scene keeps the Eigen view of aiMatrix4x4 (their transpose),
+	 * mirrored along z as aiProcess_ConvertToLeftHanded does */
+	static Eigen::Matrix4f ToSceneMatrix(const Eigen::Matrix4f& matrix) {
+	#if defined IMPORT_LEFTHAND
+		const Eigen::Matrix4f mirror = Eigen::Vector4f(1, 1, -1, 1).asDiagonal();
+		return (mirror * matrix * mirror).transpose();
+	#else
+		return matrix.transpose();
+	#endif
+	}
+	void CollectGltfMeshJobs(int nodeIndex, std::vector<MeshJob>& jobs) const {
+		const auto& gltfNode = mGltf->GetNodes()[nodeIndex];
+		if (gltfNode.Mesh >= 0) {
+			const auto& gltfMesh = mGltf->GetMeshes()[gltfNode.Mesh];
+			for (size_t i = 0; i < gltfMesh.Primitives.size(); ++i) {
+				MeshJob job{ nullptr, int(gltfMesh.FirstPrimitive + i) };
+				job.GltfNode = nodeIndex;
+				job.GltfPrimitive = int(i);
+				jobs.push_back(std::move(job));
+			}
+		}
+		for (int child : gltfNode.Children)
+			CollectGltfMeshJobs(child, jobs);
+	}
+	AiNodePtr ProcessGltfNode(int nodeIndex, std::vector<MeshJob>& jobs, size_t& jobIndex, std::vector<CoTask<bool>>& tasks) {
+		const auto& gltfNode = mGltf->GetNodes()[nodeIndex];
+		AiNodePtr node = mAsset.AddNode();
+		node->mName = gltfNode.Name;
+		node->mLocalTransform = node->mGlobalTransform = ToSceneMatrix(gltfNode.Matrix);
+		if (gltfNode.Mesh >= 0) {
+			for (size_t i = 0; i < mGltf->GetMeshes()[gltfNode.Mesh].Primitives.size(); ++i)
+				AddMeshParts(node, jobs[jobIndex++].Parts, tasks);
+		}
+
+		for (int child : gltfNode.Children)
+			node->AddChild(ProcessGltfNode(child, jobs, jobIndex, tasks));
+		return node;
+	}
+	/* the glTF counterpart of ProcessMesh: the attributes are read from the mapped buffers straight into the engine layout,
+	 * then mirrored and rewound as Assimp imports them, the uvs are kept as they are. primitives without tangents get them from their uvs */
+	std::vector<AssimpMeshPtr> ProcessGltfPrimitive(const MeshJob& job) const ThreadSafe {
+		const GltfDocument& doc = *mGltf;
+		const auto& gltfNode = doc.GetNodes()[job.GltfNode];
+		const auto& gltfMesh = doc.GetMeshes()[gltfNode.Mesh];
+		const auto& prim = gltfMesh.Primitives[job.GltfPrimitive];
+
+		AssimpMeshPtr meshPtr = std::make_shared<AssimpMesh>();
+		auto& mesh = *meshPtr;
+		mesh.mName = gltfMesh.Name;
+		mesh.mSceneMeshIndex = job.MeshIndex;
+		mesh.mHasBones = gltfNode.Skin >= 0 && prim.Joints >= 0 && prim.Weights >= 0;
+
+		const size_t vertexCount = doc.GetAccessor(prim.Position).Count;
+		auto& surfVerts = mesh.mSurfVertexs; surfVerts.resize(vertexCount);
+		auto& skeletonVerts = mesh.mSkeletonVertexs; skeletonVerts.resize(vertexCount);
+		if (vertexCount > 0) {
+			doc.ReadFloats(prim.Position, surfVerts[0].Pos.data(), sizeof(vbSurface), 3);
+			if (prim.TexCoord >= 0)
+				doc.ReadFloats(prim.TexCoord, surfVerts[0].Tex.data(), sizeof(vbSurface), 2);
+			if (prim.Normal >= 0)
+				doc.ReadFloats(prim.Normal, skeletonVerts[0].Normal.data(), sizeof(vbSkeleton), 3);
+			if (prim.Tangent >= 0)
+				doc.ReadFloats(prim.Tangent, skeletonVerts[0].Tangent.data(), sizeof(vbSkeleton), 4);
+			if (mesh.mHasBones) {
+				doc.ReadFloats(prim.Weights, skeletonVerts[0].BlendWeights.data(), sizeof(vbSkeleton), 4);
+				doc.ReadUInts(prim.Joints, reinterpret_cast<uint32_t*>(skeletonVerts[0].BlendIndices.data()), sizeof(vbSkeleton), 4);
+			}
+		}
+
+		if (mesh.mHasBones) {
+			//the joints index the skin's joint list, the bones follow it
+			const auto& skin = doc.GetSkins()[gltfNode.Skin];
+			std::vector<Eigen::Matrix4f, mir_allocator<Eigen::Matrix4f>> inverseBinds(skin.Joints.size(), Eigen::Matrix4f::Identity());
+			if (skin.InverseBindMatrices >= 0 && doc.GetAccessor(skin.InverseBindMatrices).Count > 0) {
+				inverseBinds.resize(std::max(inverseBinds.size(), doc.GetAccessor(skin.InverseBindMatrices).Count));
+				doc.ReadFloats(skin.InverseBindMatrices, inverseBinds[0].data(), sizeof(Eigen::Matrix4f), 16);
+			}
+			mesh.mBones.resize(skin.Joints.size());
+			for (size_t i = 0; i < mesh.mBones.size(); ++i) {
+				mesh.mBones[i].mName = doc.GetNodes()[skin.Joints[i]].Name;
+				mesh.mBones[i].mOffsetMatrix = ToSceneMatrix(inverseBinds[i]);
+			}
+			for (auto& vert : skeletonVerts) {
+				for (int j = 0; j < 4; ++j) {
+					if (vert.BlendIndices[j] < 0 || vert.BlendIndices[j] >= int(mesh.mBones.size())) {
+						vert.BlendIndices[j] = 0;
+						vert.BlendWeights[j] = 0.0f;
+					}
+				}
+			}
+		}
+
+		std::vector<uint32_t>& indices(mesh.mIndices);
+		if (prim.Indices >= 0) {
+			indices.resize(doc.GetAccessor(prim.Indices).Count);
+			if (!indices.empty()) doc.ReadUInts(prim.Indices, indices.data(), sizeof(uint32_t), 1);
+		}
+		else {
+			indices.resize(vertexCount);
+			std::iota(indices.begin(), indices.end(), 0);
+		}
+		indices.resize(indices.size() / 3 * 3);
+		if (std::any_of(indices.begin(), indices.end(), [vertexCount](uint32_t index) { return index >= vertexCount; })) {
+			DEBUG_LOG_ERROR("aiSceneLoader: glTF primitive indexes past its vertices in " + mesh.mName);
+			return {};
+		}
+		//counter clockwise in the file, clockwise in the engine
+		for (size_t j = 0; j + 2 < indices.size(); j += 3)
+			std::swap(indices[j + 1], indices[j + 2]);
+
+		const bool hasTangents = prim.Tangent >= 0;
+		mesh.mAABB = Eigen::AlignedBox3f();
+		for (size_t i = 0; i < vertexCount; ++i) {
+			auto& surf = surfVerts[i];
+			auto& skel = skeletonVerts[i];
+			if (hasTangents) {
+				skel.BiTangent = skel.Normal.cross(skel.Tangent.head<3>()) * skel.Tangent.w();
+				skel.Tangent.w() = 1.0f;
+			}
+			//glTF texcoords already start at the top left, as the engine's do
+		#if defined IMPORT_LEFTHAND
+			surf.Pos.z() = -surf.Pos.z();
+			skel.Normal.z() = -skel.Normal.z();
+			skel.Tangent.z() = -skel.Tangent.z();
+			skel.BiTangent.z() = -skel.BiTangent.z();
+		#endif
+			mesh.mAABB.extend(surf.Pos);
+		}
+		if (!hasTangents && prim.Normal >= 0 && prim.TexCoord >= 0)
+			ReCalculateTangents(surfVerts, skeletonVerts, indices);
+
+		return FinishMesh(meshPtr, true);
+	}
+	/* a glTF clip goes through AnimationClip::Build like an Assimp one: times in milliseconds (1000 ticks per second,
+	 * as Assimp's glTF importer keys them), values mirrored like the nodes. cubic splines keep their values, not their tangents */
+	AnimationClipPtr BuildGltfClip(const GltfDocument::Animation& anim) const {
+		const GltfDocument& doc = *mGltf;
+		aiAnimation raw;
+		raw.mName = anim.Name;
+		raw.mDuration = 0.0;
+		raw.mTicksPerSecond = 1000.0;
+
+		std::vector<int> channelNodes;
+		std::vector<aiNodeAnim*> channels;
+		std::vector<float> times, values;
+		for (const auto& channel : anim.Channels) {
+			size_t pos = std::find(channelNodes.begin(), channelNodes.end(), channel.Node) - channelNodes.begin();
+			if (pos == channelNodes.size()) {
+				channelNodes.push_back(channel.Node);
+				channels.push_back(new aiNodeAnim);
+				channels.back()->mNodeName = doc.GetNodes()[channel.Node].Name;
+			}
+			aiNodeAnim& dst = *channels[pos];
+
+			const size_t keyCount = doc.GetAccessor(channel.Input).Count;
+			times.resize(keyCount);
+			values.resize(doc.GetAccessor(channel.Output).Count * 4);
+			if (keyCount == 0) continue;
+			doc.ReadFloats(channel.Input, times.data(), sizeof(float), 1);
+			doc.ReadFloats(channel.Output, values.data(), 4 * sizeof(float), 4);
+
+			const size_t valueStep = channel.CubicSpline ? 3 : 1, valueFirst = channel.CubicSpline ? 1 : 0;
+			for (size_t k = 0; k < keyCount; ++k)
+				raw.mDuration = std::max(raw.mDuration, times[k] * 1000.0);
+			switch (channel.Path) {
+			case GltfDocument::kPathTranslation:
+			case GltfDocument::kPathScale: {
+				aiVectorKey* keys = new aiVectorKey[keyCount];
+				for (size_t k = 0; k < keyCount; ++k) {
+					const float* v = &values[(k * valueStep + valueFirst) * 4];
+					keys[k] = aiVectorKey(times[k] * 1000.0, aiVector3D(v[0], v[1], v[2]));
+				#if defined IMPORT_LEFTHAND
+					if (channel.Path == GltfDocument::kPathTranslation) keys[k].mValue.z = -keys[k].mValue.z;
+				#endif
+				}
+				aiVectorKey*& dstKeys = (channel.Path == GltfDocument::kPathTranslation) ? dst.mPositionKeys : dst.mScalingKeys;
+				unsigned& dstCount = (channel.Path == GltfDocument::kPathTranslation) ? dst.mNumPositionKeys : dst.mNumScalingKeys;
+				delete[] dstKeys;
+				dstKeys = keys;
+				dstCount = unsigned(keyCount);
+			}break;
+			case GltfDocument::kPathRotation: {
+				aiQuatKey* keys = new aiQuatKey[keyCount];
+				for (size_t k = 0; k < keyCount; ++k) {
+					const float* v = &values[(k * valueStep + valueFirst) * 4];
+				#if defined IMPORT_LEFTHAND
+					keys[k] = aiQuatKey(times[k] * 1000.0, aiQuaternion(v[3], -v[0], -v[1], v[2]));
+				#else
+					keys[k] = aiQuatKey(times[k] * 1000.0, aiQuaternion(v[3], v[0], v[1], v[2]));
+				#endif
+				}
+				delete[] dst.mRotationKeys;
+				dst.mRotationKeys = keys;
+				dst.mNumRotationKeys = unsigned(keyCount);
+			}break;
+			default:
+				break;
+			}
+		}
+
+		//aiAnimation frees the channels
+		raw.mNumChannels = unsigned(channels.size());
+		if (!channels.empty()) {
+			raw.mChannels = new aiNodeAnim*[channels.size()];
+			std::copy(channels.begin(), channels.end(), raw.mChannels);
+		}
+		return AnimationClip::Build(raw);
+	}
+	/* reorders the triangles then the vertices of a triangle mesh by the asset's optimize flags, the bone weights follow the vertices */
+	void OptimizeMesh(AssimpMesh& mesh) const ThreadSafe {
+		const int flags = mRedirectPathOnDir.GetOptimizeFlags();
+		if (flags == 0 || mesh.mIndices.empty())
+			return;
+
+		const size_t vertexCount = mesh.mSurfVertexs.size();
+		VertexCacheStats before = MeshOptimizer::AnalyzeVertexCache(mesh.mIndices, vertexCount);
+		if (flags & MeshOptimizer::kOptimizeVertexCache) {
+			std::vector<size_t> clusters;
+			MeshOptimizer::OptimizeVertexCache(mesh.mIndices, vertexCount, MeshOptimizer::kDefaultCacheSize, &clusters);
+			if (flags & MeshOptimizer::kOptimizeOverdraw)
+				MeshOptimizer::OptimizeOverdraw(mesh.mIndices, clusters, &mesh.mSurfVertexs[0].Pos, sizeof(vbSurface));
+		}
+		//skinned meshes deform away from bind pose bounds, only static ones are culled by cluster
+		if ((flags & MeshOptimizer::kOptimizeCluster) && !mesh.mHasBones && mesh.mIndices.size() >= MeshOptimizer::kClusterMinTriangles * 3)
+			mesh.mClusters = MeshOptimizer::BuildClusters(mesh.mIndices, vertexCount, &mesh.mSurfVertexs[0].Pos, sizeof(vbSurface));
+		if (flags & MeshOptimizer::kOptimizeVertexFetch) {
+			std::vector<uint32_t> remap = MeshOptimizer::OptimizeVertexFetch(mesh.mIndices, vertexCount);
+			MeshOptimizer::RemapVertices(mesh.mSurfVertexs, remap);
+			MeshOptimizer::RemapVertices(mesh.mSkeletonVertexs, remap);
+			for (auto& bone : mesh.mBones) {
+				for (auto& weight : bone.mWeights)
+					weight.mVertexId = remap[weight.mVertexId];
+			}
+		}
+		VertexCacheStats after = MeshOptimizer::AnalyzeVertexCache(mesh.mIndices, vertexCount);
+		DEBUG_LOG_INFO((boost::format("aiSceneLoader.OptimizeMesh %1%: %2% triangles, ACMR %3$.3f -> %4$.3f, ATVR %5$.3f -> %6$.3f, %7% clusters")
+			% mesh.mName % after.Triangles % before.ACMR() % after.ACMR() % before.ATVR() % after.ATVR() % mesh.mClusters.size()).str());
+	}
+	/* the greedy remap PartitionByPalette and SplitByVertexLimit share: runs of source indices go in index order
+	 * into the last part, which copies a vertex the first time one of them references it */
+	struct MeshPartitioner {
+		MeshPartitioner(const AssimpMesh& mesh) :Mesh(mesh), VertexToLocal(mesh.mSurfVertexs.size(), -1) {}
+		bool IsNewVertex(uint32_t index) const { return VertexToLocal[index] < 0; }
+		AssimpMesh& GetPart() { return *Parts.back(); }
+		/* starts the next part, empty but for the name and mesh index of the source */
+		AssimpMesh& NewPart() {
+			auto part = std::make_shared<AssimpMesh>();
+			part->mName = Mesh.mName;
+			part->mHasBones = Mesh.mHasBones;
+			part->mSceneMeshIndex = Mesh.mSceneMeshIndex;
+			part->mAABB = Eigen::AlignedBox3f();
+			Parts.push_back(part);
+			std::fill(VertexToLocal.begin(), VertexToLocal.end(), -1);
+			return *part;
+		}
+		/* appends the source indices [first, last), onNewVertex(vbSkeleton&) gets every vertex copied into the part */
+		template<class OnNewVertex> void AddIndices(size_t first, size_t last, OnNewVertex onNewVertex) {
+			AssimpMesh& part = GetPart();
+			for (size_t i = first; i < last; ++i) {
+				uint32_t index = Mesh.mIndices[i];
+				int& local = VertexToLocal[index];
+				if (local < 0) {
+					local = int(part.mSurfVertexs.size());
+					part.mSurfVertexs.push_back(Mesh.mSurfVertexs[index]);
+					part.mSkeletonVertexs.push_back(Mesh.mSkeletonVertexs[index]);
+					part.mAABB.extend(Mesh.mSurfVertexs[index].Pos);
+					onNewVertex(part.mSkeletonVertexs.back());
+				}
+				part.mIndices.push_back(local);
+			}
+		}
+	public:
+		const AssimpMesh& Mesh;
+		std::vector<AssimpMeshPtr> Parts;
+	private:
+		std::vector<int> VertexToLocal;
+	};
+	/* splits a mesh whose bones overflow the palette, greedily in index order: a triangle joins the current part
+	 * while the bones of the part still fit, else it starts the next part. a part copies the vertices it references
+	 * and owns the bones it references, its BlendIndices index that subset. */
+	template<size_t PaletteSize> std::vector<AssimpMeshPtr> PartitionByPalette(const AssimpMeshPtr& meshPtr) const {
+		static_assert(PaletteSize >= 3 * 4, "a triangle references up to 12 bones");
+		const AssimpMesh& mesh = *meshPtr;
+		if (mesh.mBones.size() <= PaletteSize)
+			return { meshPtr };
+
+		MeshPartitioner partitioner(mesh);
+		std::vector<int> boneToLocal(mesh.mBones.size(), -1);
+		for (size_t tri = 0; tri + 2 < mesh.mIndices.size(); tri += 3) {
+			int triBones[3 * 4], triBoneCount = 0, newBoneCount = 0;
+			for (size_t k = 0; k < 3; ++k) {
+				const auto& sv = mesh.mSkeletonVertexs[mesh.mIndices[tri + k]];
+				for (int j = 0; j < 4; ++j) {
+					int bone = sv.BlendIndices[j];
+					if (sv.BlendWeights[j] <= 0.0f || std::find(triBones, triBones + triBoneCount, bone) != triBones + triBoneCount)
+						continue;
+					triBones[triBoneCount++] = bone;
+					if (boneToLocal[bone] < 0) ++newBoneCount;
+				}
+			}
+
+			if (partitioner.Parts.empty() || partitioner.GetPart().mBones.size() + newBoneCount > PaletteSize) {
+				partitioner.NewPart();
+				std::fill(boneToLocal.begin(), boneToLocal.end(), -1);
+			}
 
-		if (mResMng.SupportMTResCreation()) mesh.Build(mLaunchMode, mResMng);
-		else tasks.push_back(mesh.BuildSync(mResMng));
-		return meshPtr;
+			AssimpMesh& part = partitioner.GetPart();
+			for (int i = 0; i < triBoneCount; ++i) {
+				int& local = boneToLocal[triBones[i]];
+				if (local >= 0) continue;
+				local = int(part.mBones.size());
+				//the weights index the source vertices, a part has no use for them
+				const AiBone& src = mesh.mBones[triBones[i]];
+				part.mBones.emplace_back();
+				part.mBones.back().mName = src.mName;
+				part.mBones.back().mOffsetMatrix = src.mOffsetMatrix;
+			}
+			partitioner.AddIndices(tri, tri + 3, [&](vbSkeleton& sv) {
+				for (int j = 0; j < 4; ++j)
+					sv.BlendIndices[j] = (sv.BlendWeights[j] > 0.0f) ? boneToLocal[sv.BlendIndices[j]] : 0;
+			});
+		}
+
+		DEBUG_LOG_INFO((boost::format("aiSceneLoader: mesh %1% has %2% bones, split into %3% parts of at most %4%")
+			% mesh.mSceneMeshIndex % mesh.mBones.size() % partitioner.Parts.size() % PaletteSize).str());
+		return partitioner.Parts;
+	}
+	/* splits a triangle mesh over vertexLimit vertices, greedily in index order through MeshPartitioner too.
+	 * the chunks share the bones of the mesh, so its BlendIndices stay valid. a mesh with clusters is only cut
+	 * between them, the clusters move to the chunks unchanged */
+	std::vector<AssimpMeshPtr> SplitByVertexLimit(const AssimpMeshPtr& meshPtr, size_t vertexLimit) const {
+		const AssimpMesh& mesh = *meshPtr;
+		if (mesh.mSurfVertexs.size() <= vertexLimit)
+			return { meshPtr };
+
+		MeshPartitioner partitioner(mesh);
+		std::vector<uint32_t> newVertices;
+		const bool byCluster = !mesh.mClusters.empty();
+		const size_t groupCount = byCluster ? mesh.mClusters.size() : mesh.mIndices.size() / 3;
+		for (size_t group = 0; group < groupCount; ++group) {
+			const size_t first = byCluster ? mesh.mClusters[group].IndexPos : group * 3;
+			const size_t last = first + (byCluster ? mesh.mClusters[group].IndexCount : 3);
+			newVertices.clear();
+			for (size_t i = first; i < last; ++i) {
+				if (partitioner.IsNewVertex(mesh.mIndices[i])) newVertices.push_back(mesh.mIndices[i]);
+			}
+			std::sort(newVertices.begin(), newVertices.end());
+			size_t newVertexCount = std::unique(newVertices.begin(), newVertices.end()) - newVertices.begin();
+
+			if (partitioner.Parts.empty() || partitioner.GetPart().mSurfVertexs.size() + newVertexCount > vertexLimit) {
+				AssimpMesh& part = partitioner.NewPart();
+				for (const auto& src : mesh.mBones) {
+					part.mBones.emplace_back();
+					part.mBones.back().mName = src.mName;
+					part.mBones.back().mOffsetMatrix = src.mOffsetMatrix;
+				}
+			}
+
+			if (byCluster) {
+				AssimpMesh& part = partitioner.GetPart();
+				part.mClusters.push_back(mesh.mClusters[group]);
+				part.mClusters.back().IndexPos = uint32_t(part.mIndices.size());
+			}
+			partitioner.AddIndices(first, last, [](vbSkeleton&) {});
+		}
+
+		DEBUG_LOG_INFO((boost::format("aiSceneLoader: mesh %1% has %2% vertices, split into %3% parts of at most %4%")
+			% mesh.mSceneMeshIndex % mesh.mSurfVertexs.size() % partitioner.Parts.size() % vertexLimit).str());
+		return partitioner.Parts;
 	}
 private:
 	const Launch mLaunchMode;
@@ -295,6 +950,14 @@ private:
 	ResourceRedirector mRedirectPathOnDir;
 	const Assimp::Importer* mAssetImporter = nullptr;
 	const aiScene* mAssetScene = nullptr;
+private:
+	std::unique_ptr<AiSceneCache> mCache;
+	std::vector<AiMeshStreams> mCacheStreams;
+	std::unique_ptr<GltfDocument> mGltf;
+	std::string mCachePath;
+	AiSceneCache::SourceFiles mSourceFiles;
+	AiSceneCache::Settings mCacheSettings = {};
+	bool mWriteCache = false;
 };
 typedef std::shared_ptr<AiSceneLoader> AiSceneLoaderPtr;
 
@@ -388,53 +1051,11 @@ private:
 		return LoadOBJ(resFullPath.string(), mObjNode.Vertices, mObjNode.Uvs, mObjNode.Normals, mObjNode.Indices, mObjNode.MtlName);
 	}
 
-	static void ReCalculateTangents(vbSurfaceVector& surfVerts, vbSkeletonVector& skeletonVerts, const std::vector<uint32_t>& indices)
-	{
-		for (int i = 0; i < indices.size(); i += 3) {
-			//vbSurface
-			vbSurface& surf0 = surfVerts[indices[i + 0]];
-			vbSurface& surf1 = surfVerts[indices[i + 1]];
-			vbSurface& surf2 = surfVerts[indices[i + 2]];
-
-			// Shortcuts for UVs
-			Eigen::Vector2f& uv0 = surf0.Tex;
-			Eigen::Vector2f& uv1 = surf1.Tex;
-			Eigen::Vector2f& uv2 = surf2.Tex;
-
-			// Edges of the triangle : postion delta
-			Eigen::Vector3f deltaPos1 = surf1.Pos - surf0.Pos;
-			Eigen::Vector3f deltaPos2 = surf2.Pos - surf0.Pos;
-
-			//vbSkeleton
-			vbSkeleton& skin0 = skeletonVerts[indices[i + 0]];
-			vbSkeleton& skin1 = skeletonVerts[indices[i + 1]];
-			vbSkeleton& skin2 = skeletonVerts[indices[i + 2]];
-			Eigen::Vector2f deltaUV1 = uv1 - uv0;
-			Eigen::Vector2f deltaUV2 = uv2 - uv0;
-			float r = 1.0f / (deltaUV1.x() * deltaUV2.y() - deltaUV1.y() * deltaUV2.x());
-			Eigen::Vector3f tangent = (deltaPos1 * deltaUV2.y() - deltaPos2 * deltaUV1.y()) * r; tangent.normalize();
-			skin0.Tangent.head<3>() = skin0.Tangent.head<3>() + tangent;
-			skin1.Tangent.head<3>() = skin1.Tangent.head<3>() + tangent;
-			skin2.Tangent.head<3>() = skin2.Tangent.head<3>() + tangent;
-
-			Eigen::Vector3f bitangent = (deltaPos2 * deltaUV1.x() - deltaPos1 * deltaUV2.x()) * r; bitangent.normalize();
-			skin0.BiTangent = skin0.BiTangent + bitangent;
-			skin1.BiTangent = skin1.BiTangent + bitangent;
-			skin2.BiTangent = skin2.BiTangent + bitangent;
-		}
-		for (auto& skin : skeletonVerts) {
-			skin.Tangent.head<3>().normalize();
-			skin.BiTangent.normalize();
-
-			float dp = skin.BiTangent.head<3>().dot(skin.Normal.cross(skin.Tangent.head<3>()));
-			if (dp < 0.0f) skin.Tangent.w() = -1.0;
-			else skin.Tangent.w() = 1.0;
-		}
-	}
 	CoTask<bool> ExecuteSetupData() {
 		AiNodePtr node = mAsset.mRootNode = mAsset.AddNode();
 		node->mName = IF_AND_OR(!mObjNode.MtlName.empty(), mObjNode.MtlName, mRedirectPathOnDir.GetResFullPath().stem().string());
 		node->mLocalTransform = node->mGlobalTransform = Eigen::Matrix4f::Identity();
+		mAsset.mSkeleton.Build(mAsset.mNodes);
 
 		size_t meshIndex = 0;
 		{
@@ -1,3 +1,4 @@
+#include <boost/assert.hpp>
 #include "core/resource/assimp_mesh.h"
 #include "core/resource/resource_manager.h"
 #include "core/resource/material.h"
@@ -10,17 +11,46 @@ AssimpMesh::AssimpMesh()
 {}
 
 void AssimpMesh::Build(Launch launchMode, ResourceManager& resMng)
+{
+	Build(launchMode, resMng, AiMeshStreams{ Data::Make(mSurfVertexs), Data::Make(mSkeletonVertexs), Data::Make(mIndices) });
+}
+
+void AssimpMesh::Build(Launch launchMode, ResourceManager& resMng, const AiMeshStreams& streams)
 {
 	mVao = resMng.CreateVertexArray(__launchMode__);
 
-	mIndexBuffer = resMng.CreateIndexBuffer(__launchMode__, mVao, kFormatR32UInt, Data::Make(mIndices));
+	mVertexCount = streams.Surface.Size / sizeof(vbSurface);
+	if (!mClusters.empty() && mIndices.empty()) {
+		const uint32_t* indices = (const uint32_t*)streams.Indices.Bytes;
+		mIndices.assign(indices, indices + streams.Indices.Size / sizeof(uint32_t));
+	}
+	if (FitsIndex16(mVertexCount)) {
+		std::vector<uint16_t> indices16(streams.Indices.Size / sizeof(uint32_t));
+		if (!indices16.empty()) NarrowIndices((const uint32_t*)streams.Indices.Bytes, indices16.size(), &indices16[0]);
+		mIndexBuffer = resMng.CreateIndexBuffer(__launchMode__, mVao, kFormatR16UInt, Data::Make(indices16));
+	}
+	else {
+		mIndexBuffer = resMng.CreateIndexBuffer(__launchMode__, mVao, kFormatR32UInt, streams.Indices);
+	}
 	DEBUG_SET_PRIV_DATA(mIndexBuffer, "assimp_mesh.index");
 
-	mVBOSurface = resMng.CreateVertexBuffer(__launchMode__, mVao, sizeof(vbSurface), 0, Data::Make(mSurfVertexs));
-	DEBUG_SET_PRIV_DATA(mVBOSurface, "assimp_mesh.surface");
+	if (mCompactVertex) {
+		size_t count = mVertexCount;
+		BOOST_ASSERT(streams.Skeleton.Size / sizeof(vbSkeleton) == count);
+		//the buffers are filled as they are created, the compact vertices aren't kept
+		vbSurfaceCompactVector surfVertexs(count);
+		vbSkeletonCompactVector skeletonVertexs(count);
+		if (count) mQuantization = CompressVertices((const vbSurface*)streams.Surface.Bytes, (const vbSkeleton*)streams.Skeleton.Bytes, count, &surfVertexs[0], &skeletonVertexs[0]);
 
-	mVBOSkeleton = resMng.CreateVertexBuffer(__launchMode__, mVao, sizeof(vbSkeleton), 0, Data::Make(mSkeletonVertexs));
-	DEBUG_SET_PRIV_DATA(mVBOSurface, "assimp_mesh.skeleton");
+		mVBOSurface = resMng.CreateVertexBuffer(__launchMode__, mVao, sizeof(vbSurfaceCompact), 0, Data::Make(surfVertexs));
+		mVBOSkeleton = resMng.CreateVertexBuffer(__launchMode__, mVao, sizeof(vbSkeletonCompact), 0, Data::Make(skeletonVertexs));
+	}
+	else {
+		mVBOSurface = resMng.CreateVertexBuffer(__launchMode__, mVao, sizeof(vbSurface), 0, streams.Surface);
+		mVBOSkeleton = resMng.CreateVertexBuffer(__launchMode__, mVao, sizeof(vbSkeleton), 0, streams.Skeleton);
+	}
+	DEBUG_SET_PRIV_DATA(mVBOSurface, "assimp_mesh.surface");
+	DEBUG_SET_PRIV_DATA(mVBOSkeleton, "assimp_mesh.skeleton");
 }
 
 CoTask<bool> AssimpMesh::BuildSync(ResourceManager& resMng)
@@ -30,6 +60,13 @@ CoTask<bool> AssimpMesh::BuildSync(ResourceManager& resMng)
 	CoReturn true;
 }
 
+CoTask<bool> AssimpMesh::BuildSync(ResourceManager& resMng, AiMeshStreams streams)
+{
+	CoAwait resMng.SwitchToLaunchService(LaunchSync);
+	Build(LaunchSync, resMng, streams);
+	CoReturn true;
+}
+
 bool AssimpMesh::IsLoaded() const
 {
 	return mVBOSurface->IsLoaded()
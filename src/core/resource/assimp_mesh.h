@@ -2,17 +2,24 @@
 #include "core/mir_export.h"
 #include "core/predeclare.h"
 #include "core/base/math.h"
+#include "core/base/data.h"
 #include "core/base/launch.h"
 #include "core/base/attribute_struct.h"
 #include "core/base/uniform_struct.h"
 #include "core/base/declare_macros.h"
 #include "core/rendersys/texture.h"
 #include "core/resource/material.h"
+#include "core/resource/mesh_optimizer.h"
 
 namespace mir {
 namespace res {
 
 struct AiNode;
+/* vertex and index streams of one mesh in gpu layout, owned by the mesh or a mapped AiSceneCache */
+struct AiMeshStreams {
+	Data Surface, Skeleton, Indices;
+};
+
 struct AiBone {
 	struct VertexWeight {
 		unsigned int mVertexId;
@@ -20,20 +27,26 @@ struct AiBone {
 	};
 	std::string mName;
 	std::vector<VertexWeight> mWeights;
-	Eigen::Matrix4f mOffsetMatrix;
-	std::weak_ptr<AiNode> mRelateNode;
+	Eigen::Matrix4f mOffsetMatrix;//inverse bind matrix
+	int mNodeIndex = -1;//SerilizeIndex of the bone node, resolved at load
 };
 
 class MIR_CORE_API AssimpMesh
 {
 	friend class AiSceneLoader;
 	friend class AiSceneObjLoader;
+	friend class AiSceneCache;
 	MIR_MAKE_ALIGNED_OPERATOR_NEW;
 public:
 	AssimpMesh();
 	void Build(Launch launchMode, ResourceManager& resMng);
+	void Build(Launch launchMode, ResourceManager& resMng, const AiMeshStreams& streams);
 	CoTask<bool> BuildSync(ResourceManager& resMng);
+	CoTask<bool> BuildSync(ResourceManager& resMng, AiMeshStreams streams);
+	/* the vertex buffers are built in vbSurfaceCompact + vbSkeletonCompact, the material needs VERTEX_COMPACT */
+	void SetCompactVertex(bool compact) { mCompactVertex = compact; }
 public:
+	const std::string& GetName() const { return mName; }
 	bool HasBones() const { return mHasBones; }
 	int GetMeshIndex() const { return mSceneMeshIndex; }
 	const std::vector<AiBone>& GetBones() const { return mBones; }
@@ -44,8 +57,16 @@ public:
 	const IVertexBufferPtr& GetVBOSurface() const { return mVBOSurface; }
 	const IVertexBufferPtr& GetVBOSkeleton() const { return mVBOSkeleton; }
 	const IIndexBufferPtr& GetIndexBuffer() const { return mIndexBuffer; }
+	size_t GetVertexCount() const { return mVertexCount; }
+	const IVertexArrayPtr& GetVertexArray() const { return mVao; }
+	/* static meshes built with MeshOptimizer::kOptimizeCluster, the indices stay on the CPU for the culled draws */
+	const std::vector<MeshCluster>& GetClusters() const { return mClusters; }
+	const std::vector<uint32_t>& GetIndices() const { return mIndices; }
 	const Eigen::AlignedBox3f& GetAABB() const { return mAABB; }
+	bool IsCompactVertex() const { return mCompactVertex; }
+	const VertexQuantization& GetPositionQuantization() const { return mQuantization; }
 private:
+	std::string mName;
 	int mSceneMeshIndex = -1;
 	bool mHasBones = false;
 	Eigen::AlignedBox3f mAABB;
@@ -54,6 +75,11 @@ private:
 	vbSurfaceVector mSurfVertexs;
 	vbSkeletonVector mSkeletonVertexs;
 	std::vector<uint32_t> mIndices;
+	size_t mVertexCount = 0;
+	std::vector<MeshCluster> mClusters;
+
+	bool mCompactVertex = false;
+	VertexQuantization mQuantization = { Eigen::Vector4f::Ones(), Eigen::Vector4f::Zero() };
 	
 	IVertexArrayPtr mVao;
 	IVertexBufferPtr mVBOSurface, mVBOSkeleton;
@@ -5,8 +5,6 @@
 #include "core/resource/resource.h"
 #include "core/resource/assimp_mesh.h"
 
-struct aiAnimation;
-
 namespace mir {
 namespace res {
 
@@ -62,6 +60,48 @@ public:
 	Eigen::AlignedBox3f mAABB;
 };
 
+/* node tree flattened at load, a parent always precedes its children (serialize order),
+ * so global transforms are computed in one forward pass over ParentIndices.
+ * the bind pose is kept as matrices and decomposed (T, R, S) for blending */
+struct AiSkeleton
+{
+	void Build(const std::vector<AiNodePtr>& nodes) {
+		ParentIndices.resize(nodes.size());
+		LocalTransforms.resize(nodes.size());
+		LocalPositions.resize(nodes.size());
+		LocalRotations.resize(nodes.size());
+		LocalScalings.resize(nodes.size());
+		for (size_t i = 0; i < nodes.size(); ++i) {
+			auto parent = nodes[i]->Parent.lock();
+			ParentIndices[i] = parent ? int(parent->SerilizeIndex) : -1;
+			BOOST_ASSERT(ParentIndices[i] < int(i));
+			LocalTransforms[i] = nodes[i]->GetLocalTransform();
+
+			//eigen view of aiMatrix4x4: top-left = S * R^T, translation in the last row
+			const Eigen::Matrix4f& local = LocalTransforms[i];
+			Eigen::Matrix3f rs = local.topLeftCorner<3, 3>();
+			Eigen::Vector3f scaling = rs.rowwise().norm();
+			if (rs.determinant() < 0.0f) scaling.x() = -scaling.x();
+			LocalScalings[i] = scaling;
+			LocalRotations[i] = Eigen::Quaternionf((scaling.cwiseInverse().asDiagonal() * rs).transpose()).normalized();
+			LocalPositions[i] = local.block<1, 3>(3, 0).transpose();
+		}
+	}
+	size_t Count() const { return ParentIndices.size(); }
+	void ComputeGlobals(const std::vector<Eigen::Matrix4f>& locals, std::vector<Eigen::Matrix4f>& globals) const {
+		for (size_t i = 0; i < Count(); ++i) {
+			int parent = ParentIndices[i];
+			if (parent >= 0) globals[i] = globals[parent] * locals[i];
+			else globals[i] = locals[i];
+		}
+	}
+public:
+	std::vector<int> ParentIndices;
+	std::vector<Eigen::Matrix4f> LocalTransforms;
+	std::vector<Eigen::Vector3f> LocalPositions, LocalScalings;
+	std::vector<Eigen::Quaternionf> LocalRotations;
+};
+
 struct AiScene : public ImplementResource<IResource>
 {
 	friend class AiSceneLoader;
@@ -76,6 +116,9 @@ struct AiScene : public ImplementResource<IResource>
 		mMeshes.push_back(mesh);
 		return mesh;
 	}
+	void AddMesh(const AssimpMeshPtr& mesh) {
+		mMeshes.push_back(mesh);
+	}
 	const std::vector<AiNodePtr>& GetNodes() const { return mNodes; }
 	AiNodePtr FindNodeByName(const std::string& name) const {
 		auto find_iter = std::find_if(mNodes.begin(), mNodes.end(), [&name](const AiNodePtr& nnode) { 
@@ -85,11 +128,16 @@ struct AiScene : public ImplementResource<IResource>
 	}
 	const std::vector<AssimpMeshPtr>& GetMeshes() const { return mMeshes; }
 	const Eigen::AlignedBox3f& GetAABB() const { return mRootNode->GetAABB(); }
+	const AiSkeleton& GetSkeleton() const { return mSkeleton; }
+	/* node SerilizeIndex -> channel index of the clip, -1 when the clip doesn't animate the node */
+	const std::vector<int>& GetAnimationBinding(size_t clipIndex) const { return mAnimationBindings[clipIndex]; }
 public:
 	AiNodePtr mRootNode;
-	std::vector<const aiAnimation*> mAnimations;
+	std::vector<AnimationClipPtr> mAnimations;
+	std::vector<std::vector<int>> mAnimationBindings;
 	std::vector<AssimpMeshPtr> mMeshes;
 	std::vector<AiNodePtr> mNodes;
+	AiSkeleton mSkeleton;
 };
 
 }
@@ -0,0 +1,82 @@
+#include "core/base/debug.h"
+#include "core/resource/device_res_factory.h"
+
+namespace mir {
+namespace res {
+
+/********** DeviceResFactory **********/
+template<class KeyType, class ValueType, class CreateFunc> 
+ValueType DeviceResFactory::GetOrCreate(StateCache<KeyType, ValueType>& cache, const KeyType& key, const IProgramPtr& program, CreateFunc create) ThreadSafe
+{
+	std::shared_ptr<CacheSlot<ValueType>> slot;
+	{
+		tpl::AutoLock lck(cache.Map._GetLock());
+		auto& dic = cache.Map._GetDic();
+		auto& entry = dic[key];
+		//a purged program may hand its address to a new one, the weak pointer tells them apart
+		if (entry.Slot == nullptr || entry.Program.lock() != program) {
+			entry.Slot = std::make_shared<CacheSlot<ValueType>>();
+			entry.Program = program;
+			entry.Uses = 0;
+			cache.Size = dic.size();
+		}
+		entry.Uses++;
+		slot = entry.Slot;
+	}
+
+	//callers of other keys don't wait on the device, callers of the same key wait for its first one
+	std::call_once(slot->Once, [&]() {
+		slot->Value = create();
+		slot->Ready = true;
+	});
+	if (!slot->Value->IsLoaded()) {
+		tpl::AutoLock lck(cache.Map._GetLock());
+		auto& dic = cache.Map._GetDic();
+		auto iter = dic.find(key);
+		if (iter != dic.end() && iter->second.Slot == slot) {
+			dic.erase(iter);
+			cache.Size = dic.size();
+		}
+	}
+	return slot->Value;
+}
+
+IInputLayoutPtr DeviceResFactory::CreateLayout(Launch launchMode, IProgramPtr program, const std::vector<LayoutInputElement>& layout) ThreadSafe
+{
+	BOOST_ASSERT(program);
+	return GetOrCreate(mLayoutCache, LayoutKey(program.get(), layout), program, [&]() {
+		auto res = mRenderSys.CreateResource(kDeviceResourceInputLayout); ResSetLaunch;
+		res->SetLoaded(nullptr != mRenderSys.LoadLayout(res, program, layout));
+		return std::static_pointer_cast<IInputLayout>(res);
+	});
+}
+
+ISamplerStatePtr DeviceResFactory::CreateSampler(Launch launchMode, const SamplerDesc& samplerDesc) ThreadSafe
+{
+	return GetOrCreate(mSamplerCache, samplerDesc, nullptr, [&]() {
+		auto res = mRenderSys.CreateResource(kDeviceResourceSamplerState); ResSetLaunch;
+		res->SetLoaded(nullptr != mRenderSys.LoadSampler(res, samplerDesc));
+		return std::static_pointer_cast<ISamplerState>(res);
+	});
+}
+
+size_t DeviceResFactory::PurgeUnusedStates() ThreadSafe
+{
+	auto purge = [](auto& cache) {
+		tpl::AutoLock lck(cache.Map._GetLock());
+		auto& dic = cache.Map._GetDic();
+		size_t count = dic.size();
+		for (auto iter = dic.begin(); iter != dic.end(); ) {
+			if (iter->second.Slot->Ready && iter->second.Slot->Value.use_count() == 1) iter = dic.erase(iter);
+			else ++iter;
+		}
+		cache.Size = dic.size();
+		return count - dic.size();
+	};
+	size_t count = purge(mSamplerCache) + purge(mLayoutCache);
+	if (count) DEBUG_LOG_DEBUG((boost::format("deviceResFac.PurgeUnusedStates %1%") % count).str());
+	return count;
+}
+
+}
+}
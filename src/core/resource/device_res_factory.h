@@ -1,12 +1,15 @@
 #pragma once
+#include <mutex>
 #include <boost/assert.hpp>
 #include "core/mir_export.h"
 #include "core/base/cppcoro.h"
 #include "core/base/launch.h"
 #include "core/base/declare_macros.h"
+#include "core/base/tpl/atomic_map.h"
 #include "core/rendersys/blob.h"
 #include "core/rendersys/program.h"
 #include "core/rendersys/input_layout.h"
+#include "core/rendersys/sampler.h"
 #include "core/rendersys/hardware_buffer.h"
 #include "core/rendersys/texture.h"
 #include "core/rendersys/framebuffer.h"
@@ -45,16 +48,13 @@ public:
 		return mRenderSys.UpdateBuffer(std::forward<T>(args)...);
 	}
 
-	TemplateArgs IInputLayoutPtr CreateLayout(Launch launchMode, IProgramPtr program, T &&...args) ThreadSafe {
-		auto res = mRenderSys.CreateResource(kDeviceResourceInputLayout); ResSetLaunch;
-		res->SetLoaded(nullptr != mRenderSys.LoadLayout(res, program, std::forward<T>(args)...));
-		return std::static_pointer_cast<IInputLayout>(res);
-	}
-	TemplateArgs ISamplerStatePtr CreateSampler(Launch launchMode, T &&...args) ThreadSafe {
-		auto res = mRenderSys.CreateResource(kDeviceResourceSamplerState); ResSetLaunch;
-		res->SetLoaded(nullptr != mRenderSys.LoadSampler(res, std::forward<T>(args)...));
-		return std::static_pointer_cast<ISamplerState>(res);
-	}
+	/* cached by descriptor, materials sharing a SamplerDesc or (program, layout) share one device object */
+	IInputLayoutPtr CreateLayout(Launch launchMode, IProgramPtr program, const std::vector<LayoutInputElement>& layout) ThreadSafe;
+	ISamplerStatePtr CreateSampler(Launch launchMode, const SamplerDesc& samplerDesc) ThreadSafe;
+	/* drops the cached objects no one else holds, returns the dropped count */
+	size_t PurgeUnusedStates() ThreadSafe;
+	size_t GetCachedSamplerCount() const { return mSamplerCache.Size; }
+	size_t GetCachedLayoutCount() const { return mLayoutCache.Size; }
 
 	TemplateArgs ITexturePtr CreateTexture(ResourceFormat format, T &&...args) ThreadSafe {
 		auto res = mRenderSys.CreateResource(kDeviceResourceTexture);
@@ -71,7 +71,26 @@ public:
 		return std::static_pointer_cast<IFrameBuffer>(res);
 	}
 private:
+	/* the map lock only guards the lookup, the device object is created once per slot outside of it */
+	template<class ValueType> struct CacheSlot {
+		std::once_flag Once;
+		std::atomic<bool> Ready{ false };
+		ValueType Value;
+	};
+	template<class ValueType> struct CacheEntry {
+		std::shared_ptr<CacheSlot<ValueType>> Slot;
+		std::weak_ptr<IProgram> Program;
+		uint32_t Uses = 0;
+	};
+	template<class KeyType, class ValueType> struct StateCache {
+		tpl::AtomicMap<KeyType, CacheEntry<ValueType>> Map;
+		std::atomic<size_t> Size{ 0 };
+	};
+	using LayoutKey = std::pair<const IProgram*, std::vector<LayoutInputElement>>;
+	template<class KeyType, class ValueType, class CreateFunc> ValueType GetOrCreate(StateCache<KeyType, ValueType>& cache, const KeyType& key, const IProgramPtr& program, CreateFunc create) ThreadSafe;
 	RenderSystem& mRenderSys;
+	StateCache<SamplerDesc, ISamplerStatePtr> mSamplerCache;
+	StateCache<LayoutKey, IInputLayoutPtr> mLayoutCache;
 };
 
 }
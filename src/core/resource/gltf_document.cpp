@@ -0,0 +1,462 @@
+#include <windows.h>
+#include <fstream>
+#include <sstream>
+#include <limits>
+#include <boost/filesystem.hpp>
+#include <boost/format.hpp>
+#include <boost/assert.hpp>
+#include <boost/algorithm/string.hpp>
+#include <boost/property_tree/ptree.hpp>
+#include <boost/property_tree/json_parser.hpp>
+#include "core/base/debug.h"
+#include "core/resource/gltf_document.h"
+
+namespace mir {
+namespace res {
+
+namespace boost_property_tree = boost::property_tree;
+
+enum {
+	kGlbMagic = 0x46546C67,//"glTF"
+	kGlbChunkJson = 0x4E4F534A,
+	kGlbChunkBin = 0x004E4942,
+	kModeTriangles = 4
+};
+struct GlbHeader {
+	uint32_t Magic, Version, Length;
+};
+struct GlbChunk {
+	uint32_t Length, Type;
+};
+
+static const boost_property_tree::ptree& GetItems(const boost_property_tree::ptree& tree, const char* key)
+{
+	static const boost_property_tree::ptree empty;
+	auto child = tree.get_child_optional(key);
+	return child ? *child : empty;
+}
+template<class T> static std::vector<T> GetArray(const boost_property_tree::ptree& tree, const char* key)
+{
+	std::vector<T> values;
+	for (const auto& item : GetItems(tree, key))
+		values.push_back(item.second.get_value<T>());
+	return values;
+}
+static size_t GetComponentSize(int componentType)
+{
+	switch (componentType) {
+	case GltfDocument::kComponentByte:
+	case GltfDocument::kComponentUByte: return 1;
+	case GltfDocument::kComponentShort:
+	case GltfDocument::kComponentUShort: return 2;
+	case GltfDocument::kComponentUInt:
+	case GltfDocument::kComponentFloat: return 4;
+	default: return 0;
+	}
+}
+static int GetComponentCount(const std::string& type)
+{
+	if (type == "SCALAR") return 1;
+	else if (type == "VEC2") return 2;
+	else if (type == "VEC3") return 3;
+	else if (type == "VEC4") return 4;
+	else if (type == "MAT4") return 16;
+	else return 0;//MAT2 and MAT3 columns are padded, nothing the engine reads uses them
+}
+
+template<class T> static void ConvertToFloats(const char* src, size_t srcStride, char* dst, size_t dstStride, size_t count, int components, bool normalized)
+{
+	const float scale = normalized ? 1.0f / float(std::numeric_limits<T>::max()) : 1.0f;
+	for (size_t i = 0; i < count; ++i, src += srcStride, dst += dstStride) {
+		float* values = reinterpret_cast<float*>(dst);
+		for (int k = 0; k < components; ++k) {
+			T component;
+			memcpy(&component, src + k * sizeof(T), sizeof(T));
+			float value = float(component) * scale;
+			values[k] = normalized ? std::max(value, -1.0f) : value;
+		}
+	}
+}
+template<class T> static void ConvertToUInts(const char* src, size_t srcStride, char* dst, size_t dstStride, size_t count, int components)
+{
+	for (size_t i = 0; i < count; ++i, src += srcStride, dst += dstStride) {
+		uint32_t* values = reinterpret_cast<uint32_t*>(dst);
+		for (int k = 0; k < components; ++k) {
+			T component;
+			memcpy(&component, src + k * sizeof(T), sizeof(T));
+			values[k] = uint32_t(component);
+		}
+	}
+}
+
+/********** GltfDocument **********/
+GltfDocument::~GltfDocument()
+{
+	Close();
+}
+
+bool GltfDocument::IsGltfPath(const std::string& path)
+{
+	std::string ext = boost::filesystem::path(path).extension().string();
+	return boost::iequals(ext, ".gltf") || boost::iequals(ext, ".glb");
+}
+
+bool GltfDocument::GetBufferFiles(const std::string& path, std::vector<std::string>& files)
+{
+	if (!boost::iequals(boost::filesystem::path(path).extension().string(), ".gltf"))
+		return true;
+
+	try
+	{
+		boost_property_tree::ptree doc;
+		boost_property_tree::read_json(path, doc);
+		boost::filesystem::path dir = boost::filesystem::path(path).parent_path();
+		for (const auto& item : GetItems(doc, "buffers")) {
+			auto uri = item.second.get_optional<std::string>("uri");
+			if (uri && !boost::starts_with(*uri, "data:"))
+				files.push_back((dir / *uri).string());
+		}
+	}
+	catch (const boost_property_tree::ptree_error& e)
+	{
+		DEBUG_LOG_ERROR((boost::format("gltfDocument.GetBufferFiles error %1%") % e.what()).str());
+		return false;
+	}
+	return true;
+}
+
+bool GltfDocument::MapFile(const std::string& path, MappedFile& mapped)
+{
+	mapped = MappedFile();
+	mapped.File = ::CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_DELETE, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (mapped.File == INVALID_HANDLE_VALUE) {
+		mapped.File = nullptr;
+		DEBUG_LOG_ERROR("gltfDocument.MapFile can't open " + path);
+		return false;
+	}
+
+	LARGE_INTEGER size;
+	::GetFileSizeEx(mapped.File, &size);
+	mapped.Size = size_t(size.QuadPart);
+	if (mapped.Size > 0) {
+		mapped.Mapping = ::CreateFileMappingA(mapped.File, NULL, PAGE_READONLY, 0, 0, NULL);
+		if (mapped.Mapping) mapped.View = (const char*)::MapViewOfFile(mapped.Mapping, FILE_MAP_READ, 0, 0, 0);
+	}
+	//kept even when the mapping failed, Close releases it
+	mFiles.push_back(mapped);
+	return mapped.View != nullptr;
+}
+
+void GltfDocument::Close()
+{
+	for (auto& mapped : mFiles) {
+		if (mapped.View) ::UnmapViewOfFile(mapped.View);
+		if (mapped.Mapping) ::CloseHandle(mapped.Mapping);
+		if (mapped.File) ::CloseHandle(mapped.File);
+	}
+	mFiles.clear();
+	mBuffers.clear();
+	mAccessors.clear();
+	mNodes.clear();
+	mMeshes.clear();
+	mSkins.clear();
+	mAnimations.clear();
+	mRootNodes.clear();
+	mPrimitiveCount = 0;
+}
+
+bool GltfDocument::Open(const std::string& path)
+{
+	Close();
+	std::string dir = boost::filesystem::path(path).parent_path().string();
+
+	bool valid = false;
+	if (boost::iequals(boost::filesystem::path(path).extension().string(), ".glb")) {
+		//header, the JSON chunk, then the optional BIN chunk that buffer 0 lives in
+		MappedFile glb;
+		if (MapFile(path, glb) && glb.Size >= sizeof(GlbHeader) + sizeof(GlbChunk)) {
+			const GlbHeader& header = *(const GlbHeader*)glb.View;
+			const GlbChunk& json = *(const GlbChunk*)(glb.View + sizeof(GlbHeader));
+			size_t jsonPos = sizeof(GlbHeader) + sizeof(GlbChunk);
+			if (header.Magic == kGlbMagic && header.Version == 2 && json.Type == kGlbChunkJson && jsonPos + json.Length <= glb.Size) {
+				const char* bin = nullptr;
+				size_t binSize = 0;
+				size_t binPos = jsonPos + ((json.Length + 3) & ~3u);
+				if (binPos + sizeof(GlbChunk) <= glb.Size) {
+					const GlbChunk& chunk = *(const GlbChunk*)(glb.View + binPos);
+					if (chunk.Type == kGlbChunkBin) {
+						bin = glb.View + binPos + sizeof(GlbChunk);
+						binSize = std::min<size_t>(chunk.Length, glb.Size - binPos - sizeof(GlbChunk));
+					}
+				}
+				valid = Parse(std::string(glb.View + jsonPos, json.Length), dir, bin, binSize);
+			}
+		}
+	}
+	else {
+		std::ifstream fd(path, std::ios::binary);
+		if (fd.is_open()) {
+			std::stringstream json;
+			json << fd.rdbuf();
+			valid = Parse(json.str(), dir, nullptr, 0);
+		}
+	}
+
+	if (!valid) {
+		DEBUG_LOG_INFO("gltfDocument.Open not read natively " + path);
+		Close();
+	}
+	return valid;
+}
+
+bool GltfDocument::Parse(const std::string& json, const std::string& dir, const char* glbBin, size_t glbBinSize)
+{
+	using ptree = boost_property_tree::ptree;
+	try
+	{
+		ptree doc;
+		std::istringstream stream(json);
+		boost_property_tree::read_json(stream, doc);
+		if (!boost::starts_with(doc.get<std::string>("asset.version", ""), "2"))
+			return false;
+		for (const auto& ext : GetItems(doc, "extensionsRequired")) {
+			DEBUG_LOG_INFO("gltfDocument.Parse required extension " + ext.second.get_value<std::string>());
+			return false;
+		}
+
+		for (const auto& item : GetItems(doc, "buffers")) {
+			const ptree& buffer = item.second;
+			size_t byteLength = buffer.get<size_t>("byteLength");
+			auto uri = buffer.get_optional<std::string>("uri");
+			if (!uri) {
+				if (glbBin == nullptr || glbBinSize < byteLength) return false;
+				mBuffers.push_back(Buffer{ glbBin, byteLength });
+			}
+			else if (boost::starts_with(*uri, "data:")) {
+				DEBUG_LOG_INFO("gltfDocument.Parse embedded buffer");
+				return false;
+			}
+			else {
+				MappedFile mapped;
+				if (!MapFile((boost::filesystem::path(dir) / *uri).string(), mapped) || mapped.Size < byteLength) return false;
+				mBuffers.push_back(Buffer{ mapped.View, byteLength });
+			}
+		}
+
+		struct BufferView {
+			size_t Buffer, Offset, Length, Stride;
+		};
+		std::vector<BufferView> views;
+		for (const auto& item : GetItems(doc, "bufferViews")) {
+			const ptree& view = item.second;
+			BufferView bv{ view.get<size_t>("buffer"), view.get<size_t>("byteOffset", 0), view.get<size_t>("byteLength"), view.get<size_t>("byteStride", 0) };
+			if (bv.Buffer >= mBuffers.size() || bv.Offset + bv.Length > mBuffers[bv.Buffer].Size) return false;
+			views.push_back(bv);
+		}
+
+		for (const auto& item : GetItems(doc, "accessors")) {
+			const ptree& accessor = item.second;
+			auto viewIndex = accessor.get_optional<size_t>("bufferView");
+			if (accessor.count("sparse") || !viewIndex || *viewIndex >= views.size()) {
+				DEBUG_LOG_INFO("gltfDocument.Parse sparse or empty accessor");
+				return false;
+			}
+
+			Accessor acc;
+			acc.ComponentType = accessor.get<int>("componentType");
+			acc.ComponentCount = GetComponentCount(accessor.get<std::string>("type"));
+			acc.Count = accessor.get<size_t>("count");
+			acc.Normalized = accessor.get<bool>("normalized", false);
+			size_t elementSize = GetComponentSize(acc.ComponentType) * acc.ComponentCount;
+			if (elementSize == 0) return false;
+
+			const BufferView& bv = views[*viewIndex];
+			size_t offset = bv.Offset + accessor.get<size_t>("byteOffset", 0);
+			acc.Stride = bv.Stride ? bv.Stride : elementSize;
+			if (acc.Count && offset + acc.Stride * (acc.Count - 1) + elementSize > bv.Offset + bv.Length) return false;
+			acc.Data = mBuffers[bv.Buffer].Data + offset;
+			mAccessors.push_back(acc);
+		}
+		auto isAccessor = [this](int index, std::initializer_list<int> componentTypes, int componentCount) {
+			if (index < 0) return true;
+			if (index >= int(mAccessors.size())) return false;
+			const Accessor& acc = mAccessors[index];
+			return acc.ComponentCount == componentCount
+				&& std::find(componentTypes.begin(), componentTypes.end(), acc.ComponentType) != componentTypes.end();
+		};
+
+		for (const auto& item : GetItems(doc, "meshes")) {
+			const ptree& mesh = item.second;
+			Mesh dst;
+			dst.Name = mesh.get<std::string>("name", (boost::format("mesh_%1%") % mMeshes.size()).str());
+			dst.FirstPrimitive = mPrimitiveCount;
+			for (const auto& primItem : GetItems(mesh, "primitives")) {
+				const ptree& prim = primItem.second;
+				if (prim.get<int>("mode", kModeTriangles) != kModeTriangles) {
+					DEBUG_LOG_INFO("gltfDocument.Parse non triangle primitive in " + dst.Name);
+					return false;
+				}
+
+				Primitive primitive;
+				primitive.Position = prim.get<int>("attributes.POSITION", -1);
+				primitive.Normal = prim.get<int>("attributes.NORMAL", -1);
+				primitive.Tangent = prim.get<int>("attributes.TANGENT", -1);
+				primitive.TexCoord = prim.get<int>("attributes.TEXCOORD_0", -1);
+				primitive.Joints = prim.get<int>("attributes.JOINTS_0", -1);
+				primitive.Weights = prim.get<int>("attributes.WEIGHTS_0", -1);
+				primitive.Indices = prim.get<int>("indices", -1);
+				bool valid = primitive.Position >= 0
+					&& isAccessor(primitive.Position, { kComponentFloat }, 3)
+					&& isAccessor(primitive.Normal, { kComponentFloat }, 3)
+					&& isAccessor(primitive.Tangent, { kComponentFloat }, 4)
+					&& isAccessor(primitive.TexCoord, { kComponentFloat, kComponentUByte, kComponentUShort }, 2)
+					&& isAccessor(primitive.Joints, { kComponentUByte, kComponentUShort }, 4)
+					&& isAccessor(primitive.Weights, { kComponentFloat, kComponentUByte, kComponentUShort }, 4)
+					&& isAccessor(primitive.Indices, { kComponentUByte, kComponentUShort, kComponentUInt }, 1);
+				//the attributes are read into one vertex array, they must agree on its size
+				for (int attribute : { primitive.Normal, primitive.Tangent, primitive.TexCoord, primitive.Joints, primitive.Weights })
+					valid = valid && (attribute < 0 || mAccessors[attribute].Count == mAccessors[primitive.Position].Count);
+				if (!valid) return false;
+				dst.Primitives.push_back(primitive);
+			}
+			mPrimitiveCount += dst.Primitives.size();
+			mMeshes.push_back(std::move(dst));
+		}
+
+		for (const auto& item : GetItems(doc, "skins")) {
+			Skin skin;
+			skin.Joints = GetArray<int>(item.second, "joints");
+			skin.InverseBindMatrices = item.second.get<int>("inverseBindMatrices", -1);
+			if (!isAccessor(skin.InverseBindMatrices, { kComponentFloat }, 16)) return false;
+			mSkins.push_back(std::move(skin));
+		}
+
+		for (const auto& item : GetItems(doc, "nodes")) {
+			const ptree& node = item.second;
+			Node dst;
+			dst.Name = node.get<std::string>("name", (boost::format("node_%1%") % mNodes.size()).str());
+			dst.Children = GetArray<int>(node, "children");
+			dst.Mesh = node.get<int>("mesh", -1);
+			dst.Skin = node.get<int>("skin", -1);
+			if (dst.Mesh >= int(mMeshes.size()) || dst.Skin >= int(mSkins.size())) return false;
+
+			std::vector<float> matrix = GetArray<float>(node, "matrix");
+			if (matrix.size() == 16) {
+				//column major, as Eigen stores it
+				dst.Matrix = Eigen::Map<const Eigen::Matrix4f>(matrix.data());
+			}
+			else {
+				std::vector<float> t = GetArray<float>(node, "translation"), r = GetArray<float>(node, "rotation"), s = GetArray<float>(node, "scale");
+				Eigen::Vector3f translation = (t.size() == 3) ? Eigen::Vector3f(t[0], t[1], t[2]) : Eigen::Vector3f::Zero();
+				Eigen::Quaternionf rotation = (r.size() == 4) ? Eigen::Quaternionf(r[3], r[0], r[1], r[2]).normalized() : Eigen::Quaternionf::Identity();
+				Eigen::Vector3f scale = (s.size() == 3) ? Eigen::Vector3f(s[0], s[1], s[2]) : Eigen::Vector3f::Ones();
+				dst.Matrix = (Eigen::Translation3f(translation) * rotation * Eigen::Scaling(scale)).matrix();
+			}
+			mNodes.push_back(std::move(dst));
+		}
+		//a node has one parent at most, so the walk from the roots (parentless too) is a tree
+		std::vector<int> parentCounts(mNodes.size(), 0);
+		for (const auto& node : mNodes) {
+			for (int child : node.Children) {
+				if (child < 0 || child >= int(mNodes.size()) || ++parentCounts[child] > 1) return false;
+			}
+		}
+		for (const auto& skin : mSkins) {
+			for (int joint : skin.Joints)
+				if (joint < 0 || joint >= int(mNodes.size())) return false;
+		}
+
+		auto scenes = doc.get_child_optional("scenes");
+		if (scenes && !scenes->empty()) {
+			size_t sceneIndex = std::min<size_t>(doc.get<size_t>("scene", 0), scenes->size() - 1);
+			mRootNodes = GetArray<int>(std::next(scenes->begin(), sceneIndex)->second, "nodes");
+			for (int root : mRootNodes)
+				if (root < 0 || root >= int(mNodes.size()) || parentCounts[root] != 0) return false;
+		}
+		else {
+			//no scene, every node nobody parents is a root
+			for (size_t i = 0; i < mNodes.size(); ++i)
+				if (parentCounts[i] == 0) mRootNodes.push_back(int(i));
+		}
+
+		for (const auto& item : GetItems(doc, "animations")) {
+			const ptree& anim = item.second;
+			Animation dst;
+			dst.Name = anim.get<std::string>("name", (boost::format("animation_%1%") % mAnimations.size()).str());
+
+			std::vector<const ptree*> samplers;
+			for (const auto& sampler : GetItems(anim, "samplers"))
+				samplers.push_back(&sampler.second);
+			for (const auto& channelItem : GetItems(anim, "channels")) {
+				const ptree& channel = channelItem.second;
+				std::string path = channel.get<std::string>("target.path", "");
+				Channel ch;
+				ch.Node = channel.get<int>("target.node", -1);
+				if (path == "translation") ch.Path = kPathTranslation;
+				else if (path == "rotation") ch.Path = kPathRotation;
+				else if (path == "scale") ch.Path = kPathScale;
+				else continue;//morph weights aren't animated by the engine
+
+				size_t samplerIndex = channel.get<size_t>("sampler");
+				if (ch.Node < 0 || ch.Node >= int(mNodes.size()) || samplerIndex >= samplers.size()) return false;
+				const ptree& sampler = *samplers[samplerIndex];
+				ch.Input = sampler.get<int>("input");
+				ch.Output = sampler.get<int>("output");
+				ch.CubicSpline = sampler.get<std::string>("interpolation", "LINEAR") == "CUBICSPLINE";
+				const int outputComponents = (ch.Path == kPathRotation) ? 4 : 3;
+				if (!isAccessor(ch.Input, { kComponentFloat }, 1)
+					|| !isAccessor(ch.Output, { kComponentFloat, kComponentByte, kComponentUByte, kComponentShort, kComponentUShort }, outputComponents))
+					return false;
+				if (mAccessors[ch.Output].Count < mAccessors[ch.Input].Count * (ch.CubicSpline ? 3 : 1)) return false;
+				dst.Channels.push_back(ch);
+			}
+			mAnimations.push_back(std::move(dst));
+		}
+	}
+	catch (const boost_property_tree::ptree_error& e)
+	{
+		DEBUG_LOG_ERROR((boost::format("gltfDocument.Parse error %1%") % e.what()).str());
+		return false;
+	}
+	return true;
+}
+
+void GltfDocument::ReadFloats(int accessor, float* dst, size_t dstStride, int components) const
+{
+	const Accessor& src = mAccessors[accessor];
+	components = std::min(components, src.ComponentCount);
+	char* d = reinterpret_cast<char*>(dst);
+	switch (src.ComponentType) {
+	case kComponentFloat: {
+		const char* s = src.Data;
+		for (size_t i = 0; i < src.Count; ++i, d += dstStride, s += src.Stride)
+			memcpy(d, s, components * sizeof(float));
+	}break;
+	case kComponentByte: ConvertToFloats<int8_t>(src.Data, src.Stride, d, dstStride, src.Count, components, src.Normalized); break;
+	case kComponentUByte: ConvertToFloats<uint8_t>(src.Data, src.Stride, d, dstStride, src.Count, components, src.Normalized); break;
+	case kComponentShort: ConvertToFloats<int16_t>(src.Data, src.Stride, d, dstStride, src.Count, components, src.Normalized); break;
+	case kComponentUShort: ConvertToFloats<uint16_t>(src.Data, src.Stride, d, dstStride, src.Count, components, src.Normalized); break;
+	case kComponentUInt: ConvertToFloats<uint32_t>(src.Data, src.Stride, d, dstStride, src.Count, components, src.Normalized); break;
+	default: BOOST_ASSERT(false); break;
+	}
+}
+
+void GltfDocument::ReadUInts(int accessor, uint32_t* dst, size_t dstStride, int components) const
+{
+	const Accessor& src = mAccessors[accessor];
+	components = std::min(components, src.ComponentCount);
+	char* d = reinterpret_cast<char*>(dst);
+	switch (src.ComponentType) {
+	case kComponentUByte: ConvertToUInts<uint8_t>(src.Data, src.Stride, d, dstStride, src.Count, components); break;
+	case kComponentUShort: ConvertToUInts<uint16_t>(src.Data, src.Stride, d, dstStride, src.Count, components); break;
+	case kComponentUInt: {
+		const char* s = src.Data;
+		for (size_t i = 0; i < src.Count; ++i, d += dstStride, s += src.Stride)
+			memcpy(d, s, components * sizeof(uint32_t));
+	}break;
+	default: BOOST_ASSERT(false); break;
+	}
+}
+
+}
+}
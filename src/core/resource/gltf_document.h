@@ -0,0 +1,107 @@
+#pragma once
+#include <boost/noncopyable.hpp>
+#include "core/base/stl.h"
+#include "core/base/math.h"
+#include "core/base/declare_macros.h"
+
+namespace mir {
+namespace res {
+
+/* a glTF 2.0 asset (.gltf with its .bin buffers, or .glb) read in place: the JSON is parsed into the few tables
+ * the scene loader uses, the binary buffers stay memory mapped until Close and the accessors point into the mapping.
+ * Open fails on what isn't read natively (data uris, sparse accessors, required extensions, non triangle primitives),
+ * the caller falls back to Assimp then. the values are as in the file, right handed with column vectors. */
+class GltfDocument : boost::noncopyable
+{
+public:
+	enum ComponentType {
+		kComponentByte = 5120,
+		kComponentUByte = 5121,
+		kComponentShort = 5122,
+		kComponentUShort = 5123,
+		kComponentUInt = 5125,
+		kComponentFloat = 5126
+	};
+	enum Path { kPathTranslation, kPathRotation, kPathScale };
+	struct Accessor {
+		const char* Data = nullptr;
+		size_t Count = 0, Stride = 0;
+		int ComponentType = 0, ComponentCount = 0;
+		bool Normalized = false;
+	};
+	/* accessor indices of the attributes the engine layout has, -1 when absent */
+	struct Primitive {
+		int Position = -1, Normal = -1, Tangent = -1, TexCoord = -1, Joints = -1, Weights = -1, Indices = -1;
+	};
+	struct Mesh {
+		std::string Name;
+		std::vector<Primitive> Primitives;
+		size_t FirstPrimitive = 0;//running index of the primitives over all meshes
+	};
+	struct Node {
+		MIR_MAKE_ALIGNED_OPERATOR_NEW;
+		std::string Name;//unnamed nodes are "node_<index>"
+		std::vector<int> Children;
+		int Mesh = -1, Skin = -1;
+		Eigen::Matrix4f Matrix = Eigen::Matrix4f::Identity();//T * R * S when the node has no matrix
+	};
+	struct Skin {
+		std::vector<int> Joints;
+		int InverseBindMatrices = -1;
+	};
+	/* a channel with its sampler folded in, Output holds 3 values per key for cubic splines (in tangent, value, out tangent) */
+	struct Channel {
+		int Node, Path, Input, Output;
+		bool CubicSpline;
+	};
+	struct Animation {
+		std::string Name;
+		std::vector<Channel> Channels;
+	};
+public:
+	~GltfDocument();
+	static bool IsGltfPath(const std::string& path);
+	/* appends the external buffer files a .gltf references, a .glb keeps its buffer inside */
+	static bool GetBufferFiles(const std::string& path, std::vector<std::string>& files);
+	bool Open(const std::string& path);
+	void Close();
+
+	const std::vector<int>& GetRootNodes() const { return mRootNodes; }
+	const std::vector<Node, mir_allocator<Node>>& GetNodes() const { return mNodes; }
+	const std::vector<Mesh>& GetMeshes() const { return mMeshes; }
+	const std::vector<Skin>& GetSkins() const { return mSkins; }
+	const std::vector<Animation>& GetAnimations() const { return mAnimations; }
+	const Accessor& GetAccessor(int index) const { return mAccessors[index]; }
+	size_t PrimitiveCount() const { return mPrimitiveCount; }
+
+	/* the reads are strided copies out of the mapping, ThreadSafe. float accessors of the same width copy as is,
+	 * normalized integers are unpacked to [0, 1] or [-1, 1]. components is clamped to the accessor's */
+	void ReadFloats(int accessor, float* dst, size_t dstStride, int components) const;
+	void ReadUInts(int accessor, uint32_t* dst, size_t dstStride, int components) const;
+private:
+	struct MappedFile {
+		void* File = nullptr;
+		void* Mapping = nullptr;
+		const char* View = nullptr;
+		size_t Size = 0;
+	};
+	struct Buffer {
+		const char* Data;
+		size_t Size;
+	};
+	bool MapFile(const std::string& path, MappedFile& mapped);
+	bool Parse(const std::string& json, const std::string& dir, const char* glbBin, size_t glbBinSize);
+private:
+	std::vector<MappedFile> mFiles;
+	std::vector<Buffer> mBuffers;
+	std::vector<Accessor> mAccessors;
+	std::vector<Node, mir_allocator<Node>> mNodes;
+	std::vector<Mesh> mMeshes;
+	std::vector<Skin> mSkins;
+	std::vector<Animation> mAnimations;
+	std::vector<int> mRootNodes;
+	size_t mPrimitiveCount = 0;
+};
+
+}
+}
@@ -148,6 +148,10 @@ void MaterialInstance::WriteToCb(RenderSystem& renderSys, const std::string& cbN
 {
 	mSelf->GpuParameters->WriteToElementCb(renderSys, cbName, data);
 }
+void MaterialInstance::SetCbUploadSize(const std::string& cbName, size_t size)
+{
+	mSelf->GpuParameters->SetElementUploadSize(cbName, size);
+}
 void MaterialInstance::FlushGpuParameters(RenderSystem& renderSys)
 {
 	mSelf->GpuParameters->FlushToGpu(renderSys);
@@ -129,10 +129,22 @@ public:
 	TemplateArgs bool HasProperty(const std::string& propertyName) { return mSelf->GpuParameters->HasProperty(propertyName); }
 	TemplateT T& GetProperty(const std::string& propertyName) { return mSelf->GpuParameters->GetProperty<T>(propertyName); }
 	TemplateT const T& GetProperty(const std::string& propertyName) const { return mSelf->GpuParameters->GetProperty<T>(propertyName); }
+
+	//hot paths keep a PropertyHandle, the name is looked up once per material instance
+	TemplateT bool HasProperty(const PropertyHandle<T>& handle) const { return mSelf->GpuParameters->AccessProperty(handle) != nullptr; }
+	TemplateT T& GetProperty(const PropertyHandle<T>& handle) {
+		T* property = mSelf->GpuParameters->AccessProperty(handle); BOOST_ASSERT(property);
+		return *property;
+	}
+	TemplateT void SetProperty(const PropertyHandle<T>& handle, const T& value) {
+		if (T* property = mSelf->GpuParameters->AccessProperty(handle))
+			*property = value;
+	}
 	
 	//flush parameters
 	void FlushGpuParameters(RenderSystem& renderSys);
 	void WriteToCb(RenderSystem& renderSys, const std::string& cbName, Data data);
+	void SetCbUploadSize(const std::string& cbName, size_t size);
 	std::vector<IContantBufferPtr> GetConstBuffers() const;
 private:
 	struct SharedBlock {
@@ -156,7 +168,7 @@ public:
 #endif
 	MaterialInstance CreateInstance(Launch launchMode, ResourceManager& resMng) const;
 	MaterialPtr Clone(Launch launchMode, ResourceManager& resMng) const;
-	bool IsOutOfDate() const { return mProperty->DependSrc.CheckOutOfDate(); }
+	bool IsOutOfDate() const { return mProperty->OutOfDate; }
 	const ShaderPtr& GetShader() const { return mShader; }
 	const MaterialLoadParam& GetLoadParam() const { return mLoadParam; }
 	const MaterialProperty& GetProperty() const { return *mProperty; }
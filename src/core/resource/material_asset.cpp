@@ -5,14 +5,17 @@
 #include <boost/format.hpp>
 #include <boost/filesystem.hpp>
 #include <boost/lexical_cast.hpp>
+#include <boost/algorithm/string.hpp>
 #include <regex>
 #include "core/mir_config_macros.h"
 #include "core/base/stl.h"
 #include "core/base/tpl/atomic_map.h"
 #include "core/base/tpl/vector.h"
 #include "core/base/macros.h"
+#include "core/base/file_watcher.h"
 #include "core/resource/material_name.h"
 #include "core/resource/material_asset.h"
+#include "core/resource/texture_compressor.h"
 
 namespace boost_filesystem = boost::filesystem;
 namespace boost_property_tree = boost::property_tree;
@@ -36,18 +39,36 @@ public:
 		tpl::AutoLock lck(mShaderVariantByParam._GetLock());
 		for (auto& it : mShaderByParam) {
 			if (it.second.DependShaders.CheckOutOfDate()) {
-				mShaderVariantByParam._Clear();
-				mShaderByParam.clear();
-				mIncludeByName.clear();
-				mAttrByName.clear();
-				mUniformByName.clear();
-				mSamplerSetByName.clear();
-				mIncludeFiles.Clear();
+				_PurgeAll();
 				return true;
 			}
 		}
 		return false;
 	}
+	void PurgeAll() ThreadSafe {
+		tpl::AutoLock lck(mShaderVariantByParam._GetLock());
+		_PurgeAll();
+	}
+	bool PurgeByFiles(const std::set<std::string>& changedFiles, std::set<std::string>& dirtyFiles) ThreadSafe {
+		tpl::AutoLock lck(mShaderVariantByParam._GetLock());
+		mIncludeFiles.CollectDependents(changedFiles, dirtyFiles);
+		mIncludeFiles.Invalidate(changedFiles, dirtyFiles);
+
+		bool purged = false;
+		auto purgeNodes = [&dirtyFiles, &purged](auto& nodeByKey) {
+			for (auto iter = nodeByKey.begin(); iter != nodeByKey.end();) {
+				if (iter->second.DependShaders.DependOnAny(dirtyFiles)) {
+					iter = nodeByKey.erase(iter);
+					purged = true;
+				}
+				else ++iter;
+			}
+		};
+		purgeNodes(mShaderVariantByParam._GetDic());
+		purgeNodes(mShaderByParam);
+		purgeNodes(mIncludeByName);
+		return purged;
+	}
 	const std::string& GetShaderDir() const { return mIncludeFiles.mShaderDir; }
 private:
 	struct Visitor {
@@ -124,9 +145,41 @@ private:
 		}
 	};
 
+	/* mDic caches the flattened dependencies of each file, 
+	 * mIncludees/mIncluders is the persistent #include graph (normalized paths) used to find what a changed file affects. */
 	struct IncludeFiles {
 		void Clear() {
 			mDic.clear();
+			mIncludees.clear();
+			mIncluders.clear();
+		}
+		void CollectDependents(const std::set<std::string>& changedFiles, std::set<std::string>& dirtyFiles) const {
+			std::vector<std::string> stack(changedFiles.begin(), changedFiles.end());
+			while (!stack.empty()) {
+				std::string file = std::move(stack.back());
+				stack.pop_back();
+				if (!dirtyFiles.insert(file).second)
+					continue;
+
+				auto find_iter = mIncluders.find(file);
+				if (find_iter != mIncluders.end())
+					stack.insert(stack.end(), find_iter->second.begin(), find_iter->second.end());
+			}
+		}
+		void Invalidate(const std::set<std::string>& changedFiles, const std::set<std::string>& dirtyFiles) {
+			for (auto iter = mDic.begin(); iter != mDic.end();) {
+				if (dirtyFiles.count(FileWatcher::NormalizePath(iter->first))) iter = mDic.erase(iter);
+				else ++iter;
+			}
+			//the #include lines of changed files may differ now, rescan rebuilds their edges
+			for (const auto& file : changedFiles) {
+				auto find_iter = mIncludees.find(file);
+				if (find_iter == mIncludees.end())
+					continue;
+				for (const auto& inc : find_iter->second)
+					mIncluders[inc].erase(file);
+				mIncludees.erase(find_iter);
+			}
 		}
 		void GetFileDependecies(const std::string& shadername, MaterialProperty::SourceFilesDependency& cgincs) {
 			boost_filesystem::path filepath = boost_filesystem::system_complete(mShaderDir + shadername + ".hlsl");
@@ -153,6 +206,9 @@ private:
 						if (std::regex_match(line, exp_match, exp_regex) && exp_match.size() == 2) {
 							std::string incname = exp_match[1].str();
 							boost_filesystem::path incpath = boost_filesystem::system_complete(mShaderDir + incname);
+							std::string normPath = FileWatcher::NormalizePath(pathstr), normIncPath = FileWatcher::NormalizePath(incpath.string());
+							mIncludees[normPath].insert(normIncPath);
+							mIncluders[normIncPath].insert(normPath);
 							const auto& incincs = GetFileIncludes(incpath);
 							for (const auto& it : incincs)
 								includes.insert(it);
@@ -168,6 +224,7 @@ private:
 		}
 		std::string mShaderDir;
 		std::map<std::string, std::set<MaterialProperty::SingleFileDependency>> mDic;
+		std::map<std::string, std::set<std::string>> mIncludees, mIncluders;
 	};
 
 	template<typename T> static T GetNodeAttribute(const std::string& str, T defValue, const std::vector<std::tuple<std::string, std::string, int>>& patterns) {
@@ -403,6 +460,8 @@ private:
 	}
 	void VisitAttributes(const PropertyTreePath& nodeProgram, ConstVisitorRef vis, ProgramNode& progNode) {
 		for (auto& it : boost::make_iterator_range(nodeProgram->equal_range("UseAttribute"))) {
+			if (!vis.CheckCondition(progNode, it.second))
+				continue;
 			auto attrHash = vis.LoadParam.MakeHash(it.second.data());
 			auto find_iter = mAttrByName.find(attrHash);
 			if (find_iter != mAttrByName.end()) {
@@ -574,7 +633,7 @@ private:
 						const auto& sampler = progNode.Samplers[slot];
 						std::string texSize = sampler.GetName() + "_TexelSize";
 						if (texSize == name) {
-							progNode.Relate2Parameter.TextureSizes[slot] = texSize;
+							progNode.Relate2Parameter.TextureSizes[slot] = PropertyHandle<Eigen::Vector4f>(texSize);
 							progNode.Relate2Parameter.HasTextureSize = true;
 							break;
 						}
@@ -972,6 +1031,15 @@ private:
 		}, shaderNode);
 		return result;
 	}
+	void _PurgeAll() {
+		mShaderVariantByParam._Clear();
+		mShaderByParam.clear();
+		mIncludeByName.clear();
+		mAttrByName.clear();
+		mUniformByName.clear();
+		mSamplerSetByName.clear();
+		mIncludeFiles.Clear();
+	}
 private:
 	tpl::AtomicMap<MaterialLoadParam, ShaderNode> mShaderVariantByParam;
 	std::map<MaterialLoadParam::Hash, ShaderNode> mShaderByParam;
@@ -991,18 +1059,65 @@ public:
 		return ParseMaterialFile(loadParam, materialNode);
 	}
 	bool PurgeOutOfDates() ThreadSafe {
-		if (! mShaderMng->PurgeOutOfDates()) {
-			tpl::AutoLock lck(mMaterialByPath._GetLock());
-			for (auto& it : mMaterialByPath._GetDic()) {
-				if (it.second.Property->DependSrc.CheckOutOfDate()) {
-					mMaterialByPath._Clear();
-					return true;
-				}
+		bool purged = mShaderMng->PurgeOutOfDates();
+		tpl::AutoLock lck(mMaterialByPath._GetLock());
+		for (auto& it : mMaterialByPath._GetDic()) {
+			if (it.second.Property->DependSrc.CheckOutOfDate()) {
+				it.second.Property->OutOfDate = true;
+				purged = true;
 			}
 		}
-		return false;
+		if (purged) mMaterialByPath._Clear();
+		return purged;
+	}
+	void PurgeAll() ThreadSafe {
+		mShaderMng->PurgeAll();
+		tpl::AutoLock lck(mMaterialByPath._GetLock());
+		for (auto& it : mMaterialByPath._GetDic())
+			it.second.Property->OutOfDate = true;
+		mMaterialByPath._Clear();
+	}
+	bool PurgeByFiles(const std::set<std::string>& changedFiles, std::vector<MaterialLoadParam>& purgedMaterials) ThreadSafe {
+		std::set<std::string> dirtyFiles;
+		bool purged = mShaderMng->PurgeByFiles(changedFiles, dirtyFiles);
+
+		tpl::AutoLock lck(mMaterialByPath._GetLock());
+		auto& materialByPath = mMaterialByPath._GetDic();
+		for (auto iter = materialByPath.begin(); iter != materialByPath.end();) {
+			if (iter->second.Property->DependSrc.DependOnAny(dirtyFiles)) {
+				iter->second.Property->OutOfDate = true;
+				purgedMaterials.push_back(iter->first);
+				iter = materialByPath.erase(iter);
+				purged = true;
+			}
+			else ++iter;
+		}
+		return purged;
 	}
 private:
+	/* the block format of a sampler by what the program reads from it, Compress="..." overrides it (None keeps the image as is).
+	 * colors are BC7, normals BC5 when the program unpacks two channels (NORMAL_TEXTURE_PACKED) and BC7 otherwise, packed
+	 * occlusion/roughness/metallic BC1 (BC7 when alpha carries transmission), single channels BC4, unknown samplers stay uncompressed */
+	static ResourceFormat GetCompressByUsage(const std::string& samplerName, const ProgramNode& prog) {
+		const auto& macros = prog.PixelSCD;
+		if (samplerName == "txAlbedo" || samplerName == "txEmissive" || samplerName == "txSheen" || samplerName == "txClearCoat")
+			return kFormatBC7UNorm;
+		else if (samplerName == "txNormal")
+			return macros["NORMAL_TEXTURE_PACKED"] ? kFormatBC5UNorm : kFormatBC7UNorm;
+		else if (samplerName == "txAmbientOcclusion") {
+			if (macros["ENABLE_AO_ROUGHNESS_METALLIC_MAP"])
+				return macros["ENABLE_TRANSMISSION"] ? kFormatBC7UNorm : kFormatBC1UNorm;
+			return kFormatBC4UNorm;
+		}
+		else if (samplerName == "txMetallic") {
+			if (macros["ENABLE_SPECULAR_MAP"]) return kFormatBC7UNorm;
+			else if (macros["ENABLE_METALLIC_X_X_SMOOTHNESS_MAP"]) return kFormatBC3UNorm;//metallic in red, smoothness in alpha
+			return kFormatBC4UNorm;
+		}
+		else if (samplerName == "txRoughness")
+			return kFormatBC4UNorm;
+		return kFormatUnknown;
+	}
 	void VisitProperties(const PropertyTreePath& nodeProperties, MaterialNode& materialNode) {
 		auto& mprop = *materialNode.Property;
 		for (auto& nodeProp : nodeProperties.Node) {
@@ -1013,6 +1128,13 @@ private:
 					texProp.ImagePath = nodeProp.second.data();
 					texProp.Slot = index;
 					texProp.GenMipmap = nodeProp.second.get<bool>("<xmlattr>.GenMipmap", true);
+					auto compress = nodeProp.second.get_optional<std::string>("<xmlattr>.Compress");
+					texProp.Compress = compress ? TextureCompressor::ParseFormat(*compress) : GetCompressByUsage(nodeProp.first, prog);
+					texProp.Mipmap.Filter = (nodeProp.second.get<std::string>("<xmlattr>.MipFilter", "") == "Box") ? kMipmapFilterBox : kMipmapFilterKaiser;
+					//txAlbedo is srgb when the shader decodes it so, with ALBEDO_MAP_SRGB as the program resolved it
+					bool isSRGB = boost::starts_with(nodeProp.first, "tx") && prog.PixelSCD[boost::to_upper_copy(nodeProp.first.substr(2)) + "_MAP_SRGB"] != 0;
+					texProp.Mipmap.SRGB = nodeProp.second.get<bool>("<xmlattr>.SRGB", isSRGB);
+					texProp.Mipmap.AlphaCutoff = nodeProp.second.get<float>("<xmlattr>.AlphaCutoff", 0.0f);
 				}
 				else {
 					mprop.UniformByName.insert(std::make_pair(nodeProp.first, nodeProp.second.data()));
@@ -1113,6 +1235,14 @@ bool MaterialAssetManager::PurgeOutOfDates() ThreadSafe
 {
 	return mMaterialNodeMng->PurgeOutOfDates();
 }
+void MaterialAssetManager::PurgeAll() ThreadSafe
+{
+	mMaterialNodeMng->PurgeAll();
+}
+bool MaterialAssetManager::PurgeByFiles(const std::set<std::string>& changedFiles, std::vector<MaterialLoadParam>& purgedMaterials) ThreadSafe
+{
+	return mMaterialNodeMng->PurgeByFiles(changedFiles, purgedMaterials);
+}
 
 }
 }
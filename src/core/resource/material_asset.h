@@ -1,5 +1,6 @@
 #pragma once
 #include <boost/noncopyable.hpp>
+#include "core/mir_export.h"
 #include "core/base/cppcoro.h"
 #include "core/base/declare_macros.h"
 #include "core/base/tpl/binary.h"
@@ -248,13 +249,16 @@ struct MaterialNode {
 
 class ShaderNodeManager;
 class MaterialNodeManager;
-class MaterialAssetManager : boost::noncopyable
+class MIR_CORE_API MaterialAssetManager : boost::noncopyable
 {
 public:
 	MaterialAssetManager(const std::string& shaderDir);
 	bool GetShaderNode(const MaterialLoadParam& loadParam, ShaderNode& shaderNode) ThreadSafe;
 	bool GetMaterialNode(const MaterialLoadParam& loadParam, MaterialNode& materialNode) ThreadSafe;
 	bool PurgeOutOfDates() ThreadSafe;
+	void PurgeAll() ThreadSafe;
+	/* changedFiles are normalized paths (FileWatcher::NormalizePath), drops only the nodes that transitively depend on them */
+	bool PurgeByFiles(const std::set<std::string>& changedFiles, std::vector<MaterialLoadParam>& purgedMaterials) ThreadSafe;
 private:
 	std::shared_ptr<ShaderNodeManager> mShaderNodeMng;
 	std::shared_ptr<MaterialNodeManager> mMaterialNodeMng;
@@ -63,9 +63,9 @@ CoTask<bool> MaterialFactory::DoCreateShaderByShaderNode(ShaderPtr shader, Launc
 								layout_compose.push_back(element_slot);
 								layout_compose.back().InputSlot = slot;
 							}
-							pass->mInputLayout = mResMng.CreateLayout(lchMode, pass->mProgram, layout_compose);
 							++slot;
 						}
+						pass->mInputLayout = mResMng.CreateLayout(lchMode, pass->mProgram, layout_compose);
 					}
 					CoReturn true;
 				}(curPass, passProgram));
@@ -141,7 +141,7 @@ CoTask<bool> MaterialFactory::DoCreateMaterialByMtlNode(MaterialPtr material, La
 			BOOST_ASSERT(boost::filesystem::is_regular_file(imagePath));
 			if (boost::filesystem::is_regular_file(imagePath)) {
 				BOOST_ASSERT(iter.second.Slot < material->mTextures.Count());
-				tasks.push_back(mResMng.CreateTextureByFile(material->mTextures[iter.second.Slot], lchMode, imagePath.string(), kFormatUnknown, iter.second.GenMipmap));
+				tasks.push_back(mResMng.CreateTextureByFile(material->mTextures[iter.second.Slot], lchMode, imagePath.string(), iter.second.Compress, iter.second.GenMipmap, iter.second.Mipmap));
 			}
 		}
 	}
@@ -242,6 +242,26 @@ bool MaterialFactory::PurgeOutOfDates() ThreadSafe
 	}
 	else return false;
 }
+bool MaterialFactory::PurgeByFiles(const std::set<std::string>& changedFiles) ThreadSafe
+{
+	//a .Shader may redeclare shared uniform blocks (mParametersByUniformName), reload everything then
+	for (const auto& file : changedFiles) {
+		if (boost::filesystem::path(file).extension() == ".shader") {
+			mMatAssetMng->PurgeAll();
+			PurgeAll();
+			return true;
+		}
+	}
+
+	std::vector<MaterialLoadParam> purgedMaterials;
+	if (!mMatAssetMng->PurgeByFiles(changedFiles, purgedMaterials))
+		return false;
+
+	tpl::AutoLock lck(mMaterialCache._GetLock());
+	for (const auto& loadParam : purgedMaterials)
+		mMaterialCache._GetDic().erase(loadParam);
+	return true;
+}
 void MaterialFactory::PurgeAll() ThreadSafe
 {
 	tpl::AutoLock lck(mMaterialCache._GetLock());
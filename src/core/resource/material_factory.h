@@ -30,6 +30,7 @@ public:
 	DECLARE_COTASK_FUNCTIONS(MaterialPtr, CreateMaterial, ThreadSafe ThreadMaySwitch);
 
 	bool PurgeOutOfDates() ThreadSafe;
+	bool PurgeByFiles(const std::set<std::string>& changedFiles) ThreadSafe;
 	void PurgeAll() ThreadSafe;
 
 	ShaderPtr CloneShader(Launch launch, const Shader& material) ThreadSafe ThreadMaySwitch;
@@ -1,3 +1,5 @@
+#include <map>
+#include <mutex>
 #include "core/base/data.h"
 #include "core/rendersys/render_system.h"
 #include "core/resource/resource_manager.h"
@@ -6,6 +8,14 @@
 namespace mir {
 namespace res {
 
+int GetPropertyId(const std::string& propertyName)
+{
+	static std::mutex lock;
+	static std::map<std::string, int> idByName;
+	std::lock_guard<std::mutex> lck(lock);
+	return idByName.insert(std::make_pair(propertyName, int(idByName.size()))).first->second;
+}
+
 /********** UniformParameters **********/
 bool UniformParameters::SetPropertyByString(const std::string& name, std::string strDefault)
 {
@@ -45,7 +55,9 @@ void UniformParameters::WriteToConstBuffer(RenderSystem& renderSys, IContantBuff
 {
 	BOOST_ASSERT(!mIsReadOnly);
 	BOOST_ASSERT(mDecl.BufferSize >= cbuffer->GetBufferSize());
-	renderSys.UpdateBuffer(cbuffer, Data::Make(mData.GetBytes()));
+	Data data = Data::Make(mData.GetBytes());
+	if (mUploadSize > 0) data.Size = std::min(data.Size, mUploadSize);
+	renderSys.UpdateBuffer(cbuffer, data);
 }
 
 /********** UniformParametersBuilder **********/
@@ -104,6 +116,15 @@ void GpuParameters::WriteToElementCb(RenderSystem& renderSys, const std::string&
 	}
 }
 
+void GpuParameters::SetElementUploadSize(const std::string& cbName, size_t size)
+{
+	for (const auto& element : *this) {
+		if (element.IsValid() && element.GetName() == cbName) {
+			element.Parameters->SetUploadSize(size);
+		}
+	}
+}
+
 void GpuParameters::FlushToGpu(RenderSystem& renderSys)
 {
 	for (const auto& element : *this) {
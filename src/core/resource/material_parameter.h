@@ -1,5 +1,6 @@
 #pragma once
 #include <boost/noncopyable.hpp>
+#include "core/mir_export.h"
 #include "core/predeclare.h"
 #include "core/base/data.h"
 #include "core/base/tpl/vector.h"
@@ -16,6 +17,25 @@ enum CBufferShareMode {
 	kCbShareMax
 };
 
+/* the process wide id of a property name, the same name always gets the same id */
+MIR_CORE_API int GetPropertyId(const std::string& propertyName);
+
+/* a property name and its id, immutable once constructed so one handle is shared freely (the meshes of a model,
+ * the materials drawn with one pass, several threads). each GpuParameters resolves the id to (element slot, byte offset)
+ * the first time it meets it and keeps that by the id, later writes index it directly */
+template<typename T> class PropertyHandle 
+{
+public:
+	PropertyHandle() {}
+	explicit PropertyHandle(const std::string& propertyName) :mName(propertyName), mId(GetPropertyId(propertyName)) {}
+	const std::string& GetName() const { return mName; }
+	int GetId() const { return mId; }
+	bool IsValid() const { return mId >= 0; }
+private:
+	std::string mName;
+	int mId = -1;
+};
+
 class UniformParameters
 {
 	friend class UniformParametersBuilder;
@@ -44,6 +64,10 @@ public:
 	}
 	TemplateT T& operator[](const std::string& propertyName) { return GetProperty<T>(propertyName); }
 	TemplateT const T& operator[](const std::string& propertyName) const { return GetProperty<T>(propertyName); }
+	TemplateT T& GetPropertyByOffset(size_t offset) {
+		mDataDirty = true;
+		return mData.As<T, 1>(offset);
+	}
 	void SetProperty(const std::string& propertyName, const Data& data) {
 		auto element = mDecl[propertyName];
 		BOOST_ASSERT((element && !mData.Overflow<char, 1>(element->Offset)));
@@ -54,6 +78,8 @@ public:
 	IContantBufferPtr CreateConstBuffer(Launch launchMode, ResourceManager& resMng, HWMemoryUsage usage) const;
 	void WriteToConstBuffer(RenderSystem& renderSys, IContantBufferPtr cbuffer) const;
 	void SetDataDirty(bool dirty) { mDataDirty = dirty; }
+	//WriteToConstBuffer writes the leading size bytes only, 0 writes all
+	void SetUploadSize(size_t size) { mUploadSize = size; }
 public:
 	bool IsValid() const { return !mData.IsEmpty(); }
 	const std::string& GetName() const { return mShortName; }
@@ -70,6 +96,7 @@ private:
 private:
 	tpl::Binary<float> mData;
 	mutable bool mDataDirty = false;
+	size_t mUploadSize = 0;
 };
 
 class GpuParameters
@@ -93,9 +120,11 @@ class GpuParameters
 public:
 	void AddElement(const Element& element) {
 		mElements.AddOrSet(element, element.GetSlot());
+		mBindingById.clear();
 	}
 	void AddElement(IContantBufferPtr cbuffer, UniformParametersPtr parameter) {
 		mElements.AddOrSet(Element(cbuffer, parameter));
+		mBindingById.clear();
 	}
 	void Merge(const GpuParameters& other) {
 		for (const auto& element : other) {
@@ -140,6 +169,16 @@ public:
 			}
 		}
 	}
+	/* the property of the handle, nullptr when these parameters don't have it */
+	template<typename T> T* AccessProperty(const PropertyHandle<T>& handle) {
+		BOOST_ASSERT(handle.IsValid());
+		if (size_t(handle.GetId()) >= mBindingById.size())
+			mBindingById.resize(handle.GetId() + 1);
+		PropertyBinding& binding = mBindingById[handle.GetId()];
+		if (binding.Slot == PropertyBinding::kUnresolved)
+			binding = ResolveProperty<T>(handle.GetName());
+		return binding.Slot >= 0 ? &mElements[binding.Slot].Parameters->GetPropertyByOffset<T>(binding.Offset) : nullptr;
+	}
 	bool SetPropertyByString(const std::string& propertyName, std::string strDefault) {
 		for (auto& iter : mElements) {
 			if (iter && (*iter.Parameters).SetPropertyByString(propertyName, strDefault)) {
@@ -150,13 +189,39 @@ public:
 	}
 	
 	void WriteToElementCb(RenderSystem& renderSys, const std::string& cbName, Data data);
+	void SetElementUploadSize(const std::string& cbName, size_t size);
 	void FlushToGpu(RenderSystem& renderSys);
 public:
 	std::vector<IContantBufferPtr> GetConstBuffers() const;
 	const_iterator begin() const { return mElements.begin(); }
 	const_iterator end() const { return mElements.end(); }
+private:
+	struct PropertyBinding {
+		enum { kUnresolved = -2 };
+		int Slot = kUnresolved;//-1 when no element has the property
+		size_t Offset = 0;
+	};
+	template<typename T> PropertyBinding ResolveProperty(const std::string& propertyName) const {
+		PropertyBinding binding;
+		binding.Slot = -1;
+		for (size_t slot = 0; slot < mElements.Count(); ++slot) {
+			const auto& element = mElements[slot];
+			int index = element ? element.Parameters->FindProperty(propertyName) : -1;
+			if (index >= 0) {
+				const auto& decl = element.Parameters->GetDecl()[index];
+				BOOST_ASSERT(CbDeclElement::DetectType(T()) == decl.Type1 
+					|| (decl.Type1 == CbDeclElement::Type::Bool && sizeof(T) == sizeof(BOOL)));
+				BOOST_ASSERT(sizeof(T) <= decl.Size);
+				binding.Slot = slot;
+				binding.Offset = decl.Offset;
+				break;
+			}
+		}
+		return binding;
+	}
 private:
 	tpl::Vector<Element> mElements;
+	std::vector<PropertyBinding> mBindingById;//by PropertyHandle id, cleared when the elements change
 };
 
 class UniformParametersBuilder
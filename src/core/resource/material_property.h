@@ -1,10 +1,14 @@
 #pragma once
 #include <boost/noncopyable.hpp>
 #include <boost/filesystem.hpp>
+#include "core/base/file_watcher.h"
 #include "core/rendersys/base/primitive_topology.h"
 #include "core/rendersys/base/blend_state.h"
 #include "core/rendersys/base/depth_state.h"
 #include "core/rendersys/base/rasterizer_state.h"
+#include "core/rendersys/base/res_format.h"
+#include "core/resource/material_parameter.h"
+#include "core/resource/mipmap_builder.h"
 
 namespace mir {
 namespace res {
@@ -45,7 +49,7 @@ public:
 	
 	struct ParameterRelation {
 		ParameterRelation() :TextureSizes(16), HasTextureSize(false) {}
-		std::vector<std::string> TextureSizes;
+		std::vector<PropertyHandle<Eigen::Vector4f>> TextureSizes;
 		bool HasTextureSize;
 	} Relate2Parameter;
 };
@@ -57,6 +61,8 @@ public:
 		std::string ImagePath;
 		int Slot;
 		bool GenMipmap = false;
+		ResourceFormat Compress = kFormatUnknown;//a block format compresses the image at import, see TextureCompressor
+		MipmapOptions Mipmap;//how the GenMipmap levels of an image are filtered, see MipmapBuilder
 	};
 	std::map<std::string, TextureProperty> Textures;
 
@@ -89,10 +95,19 @@ public:
 					return true;
 			return false;
 		}
+		bool DependOnAny(const std::set<std::string>& normalizedPaths) const {
+			if (!Material.FilePath.empty() && normalizedPaths.count(FileWatcher::NormalizePath(Material.FilePath)))
+				return true;
+			for (auto& it : Shaders)
+				if (normalizedPaths.count(FileWatcher::NormalizePath(it.FilePath)))
+					return true;
+			return false;
+		}
 	public:
 		std::set<SingleFileDependency> Shaders;
 		SingleFileDependency Material;
 	} DependSrc;
+	bool OutOfDate = false;
 
 	int RenderType = 0;
 #if defined _DEBUG
@@ -0,0 +1,361 @@
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <boost/assert.hpp>
+#include "core/resource/mesh_optimizer.h"
+
+namespace mir {
+namespace res {
+
+/********** MeshOptimizer **********/
+VertexCacheStats MeshOptimizer::AnalyzeVertexCache(const std::vector<uint32_t>& indices, size_t vertexCount, int cacheSize) ThreadSafe
+{
+	//a vertex is cached while fewer than cacheSize misses followed its own
+	VertexCacheStats stats;
+	stats.Triangles = indices.size() / 3;
+	std::vector<size_t> stamps(vertexCount, 0);
+	size_t time = cacheSize + 1;
+	for (uint32_t v : indices) {
+		if (stamps[v] == 0) stats.Vertices++;
+		if (time - stamps[v] > size_t(cacheSize)) {
+			stamps[v] = time++;
+			stats.Transformed++;
+		}
+	}
+	return stats;
+}
+
+void MeshOptimizer::OptimizeVertexCache(std::vector<uint32_t>& indices, size_t vertexCount, int cacheSize, std::vector<size_t>* clusters) ThreadSafe
+{
+	const size_t triCount = indices.size() / 3;
+	if (clusters) clusters->clear();
+	if (triCount == 0 || vertexCount == 0)
+		return;
+
+	//vertex to triangles, live counts the triangles of a vertex not emitted yet
+	std::vector<uint32_t> live(vertexCount, 0), offsets(vertexCount + 1, 0), adjacency(triCount * 3);
+	for (size_t i = 0; i < triCount * 3; ++i)
+		live[indices[i]]++;
+	for (size_t v = 0; v < vertexCount; ++v)
+		offsets[v + 1] = offsets[v] + live[v];
+	std::vector<uint32_t> cursor(offsets.begin(), offsets.end() - 1);
+	for (size_t i = 0; i < triCount * 3; ++i)
+		adjacency[cursor[indices[i]]++] = uint32_t(i / 3);
+
+	std::vector<size_t> stamps(vertexCount, 0);
+	std::vector<bool> emitted(triCount, false);
+	std::vector<uint32_t> deadEnds, candidates, result;
+	result.reserve(indices.size());
+	size_t time = cacheSize + 1, scan = 0;
+	auto skipDeadEnd = [&]() -> int {
+		while (!deadEnds.empty()) {
+			uint32_t v = deadEnds.back();
+			deadEnds.pop_back();
+			if (live[v] > 0) return int(v);
+		}
+		for (; scan < vertexCount; ++scan) {
+			if (live[scan] > 0) return int(scan);
+		}
+		return -1;
+	};
+
+	if (clusters) clusters->push_back(0);
+	int fan = int(indices[0]);
+	while (fan >= 0) {
+		candidates.clear();
+		for (uint32_t k = offsets[fan]; k < offsets[fan + 1]; ++k) {
+			uint32_t tri = adjacency[k];
+			if (emitted[tri]) continue;
+
+			for (size_t c = 0; c < 3; ++c) {
+				uint32_t v = indices[tri * 3 + c];
+				result.push_back(v);
+				deadEnds.push_back(v);
+				candidates.push_back(v);
+				live[v]--;
+				if (time - stamps[v] > size_t(cacheSize)) stamps[v] = time++;
+			}
+			emitted[tri] = true;
+		}
+
+		//fan next around the candidate that is still cached once its remaining triangles are emitted, the oldest such one
+		int next = -1, best = -1;
+		for (uint32_t v : candidates) {
+			if (live[v] == 0) continue;
+			int priority = 0;
+			if (time - stamps[v] + 2 * live[v] <= size_t(cacheSize)) priority = int(time - stamps[v]);
+			if (priority > best) {
+				best = priority;
+				next = int(v);
+			}
+		}
+		if (next < 0) {
+			next = skipDeadEnd();
+			if (next >= 0 && clusters) clusters->push_back(result.size() / 3);
+		}
+		fan = next;
+	}
+	BOOST_ASSERT(result.size() == triCount * 3);
+
+	result.insert(result.end(), indices.begin() + triCount * 3, indices.end());
+	indices.swap(result);
+}
+
+void MeshOptimizer::OptimizeOverdraw(std::vector<uint32_t>& indices, const std::vector<size_t>& clusters, const Eigen::Vector3f* positions, size_t positionStride,
+	int cacheSize, float threshold) ThreadSafe
+{
+	const size_t triCount = indices.size() / 3;
+	if (triCount == 0 || clusters.empty())
+		return;
+
+	auto position = [&](uint32_t v) -> const Eigen::Vector3f& {
+		return *(const Eigen::Vector3f*)((const char*)positions + v * positionStride);
+	};
+	size_t vertexCount = 0;
+	for (uint32_t v : indices)
+		vertexCount = std::max<size_t>(vertexCount, v + 1);
+
+	//a run restarts with a cold cache, moving time past every stamp flushes it
+	std::vector<size_t> stamps(vertexCount, 0);
+	size_t time = cacheSize + 1;
+	auto transform = [&](size_t tri) {
+		size_t misses = 0;
+		for (size_t c = 0; c < 3; ++c) {
+			uint32_t v = indices[tri * 3 + c];
+			if (time - stamps[v] > size_t(cacheSize)) {
+				stamps[v] = time++;
+				misses++;
+			}
+		}
+		return misses;
+	};
+
+	//soft boundaries: a run is cut as soon as its prefix is within threshold of the ACMR of the whole run
+	std::vector<size_t> starts;
+	for (size_t c = 0; c < clusters.size(); ++c) {
+		size_t first = clusters[c], last = (c + 1 < clusters.size()) ? clusters[c + 1] : triCount;
+		time += cacheSize + 1;
+		size_t misses = 0;
+		for (size_t t = first; t < last; ++t)
+			misses += transform(t);
+		float runACMR = float(misses) / (last - first);
+
+		time += cacheSize + 1;
+		starts.push_back(first);
+		size_t start = first;
+		misses = 0;
+		for (size_t t = first; t + 1 < last; ++t) {
+			misses += transform(t);
+			if (float(misses) / (t + 1 - start) <= runACMR * threshold) {
+				starts.push_back(t + 1);
+				start = t + 1;
+				misses = 0;
+				time += cacheSize + 1;
+			}
+		}
+	}
+
+	//front faces are clockwise as imported, so (p1 - p0) x (p2 - p0) points outward.
+	//clusters facing away from the mesh centroid are more likely to occlude and are drawn first
+	Eigen::Vector3f meshCentroid = Eigen::Vector3f::Zero();
+	float meshArea = 0.0f;
+	struct Cluster {
+		size_t First, Last;
+		float Key;
+	};
+	std::vector<Cluster> sorted(starts.size());
+	std::vector<Eigen::Vector3f> centroids(starts.size()), normals(starts.size());
+	for (size_t c = 0; c < starts.size(); ++c) {
+		Cluster& cluster = sorted[c];
+		cluster.First = starts[c];
+		cluster.Last = (c + 1 < starts.size()) ? starts[c + 1] : triCount;
+
+		Eigen::Vector3f centroid = Eigen::Vector3f::Zero(), normal = Eigen::Vector3f::Zero();
+		float area = 0.0f;
+		for (size_t t = cluster.First; t < cluster.Last; ++t) {
+			const Eigen::Vector3f& p0 = position(indices[t * 3 + 0]);
+			const Eigen::Vector3f& p1 = position(indices[t * 3 + 1]);
+			const Eigen::Vector3f& p2 = position(indices[t * 3 + 2]);
+			Eigen::Vector3f n = (p1 - p0).cross(p2 - p0);
+			float triArea = n.norm();
+			centroid += (p0 + p1 + p2) * (triArea / 3.0f);
+			normal += n;
+			area += triArea;
+		}
+		meshCentroid += centroid;
+		meshArea += area;
+		centroids[c] = (area > 0.0f) ? Eigen::Vector3f(centroid / area) : Eigen::Vector3f(position(indices[cluster.First * 3]));
+		normals[c] = normal;
+	}
+	if (meshArea > 0.0f) meshCentroid /= meshArea;
+
+	for (size_t c = 0; c < sorted.size(); ++c) {
+		float length = normals[c].norm();
+		sorted[c].Key = (length > 0.0f) ? (centroids[c] - meshCentroid).dot(normals[c]) / length : 0.0f;
+	}
+	std::stable_sort(sorted.begin(), sorted.end(), [](const Cluster& l, const Cluster& r) { return l.Key > r.Key; });
+
+	std::vector<uint32_t> result;
+	result.reserve(indices.size());
+	for (const auto& cluster : sorted)
+		result.insert(result.end(), indices.begin() + cluster.First * 3, indices.begin() + cluster.Last * 3);
+	result.insert(result.end(), indices.begin() + triCount * 3, indices.end());
+	indices.swap(result);
+}
+
+std::vector<MeshCluster> MeshOptimizer::BuildClusters(std::vector<uint32_t>& indices, size_t vertexCount, const Eigen::Vector3f* positions, size_t positionStride,
+	size_t maxVertices, size_t maxTriangles) ThreadSafe
+{
+	std::vector<MeshCluster> clusters;
+	const size_t triCount = indices.size() / 3;
+	if (triCount == 0 || vertexCount == 0)
+		return clusters;
+	BOOST_ASSERT(maxVertices >= 3 && maxTriangles > 0);
+
+	auto position = [&](uint32_t v) -> const Eigen::Vector3f& {
+		return *(const Eigen::Vector3f*)((const char*)positions + v * positionStride);
+	};
+	std::vector<uint32_t> offsets(vertexCount + 1, 0), adjacency(triCount * 3);
+	for (size_t i = 0; i < triCount * 3; ++i)
+		offsets[indices[i] + 1]++;
+	for (size_t v = 0; v < vertexCount; ++v)
+		offsets[v + 1] += offsets[v];
+	std::vector<uint32_t> cursor(offsets.begin(), offsets.end() - 1);
+	for (size_t i = 0; i < triCount * 3; ++i)
+		adjacency[cursor[indices[i]]++] = uint32_t(i / 3);
+
+	std::vector<Eigen::Vector3f> triCenters(triCount);
+	for (size_t t = 0; t < triCount; ++t)
+		triCenters[t] = (position(indices[t * 3]) + position(indices[t * 3 + 1]) + position(indices[t * 3 + 2])) / 3.0f;
+
+	//a stamp marks the vertices and the candidate triangles of the cluster being grown
+	std::vector<size_t> vertexStamps(vertexCount, 0), triStamps(triCount, 0);
+	std::vector<bool> emitted(triCount, false);
+	std::vector<uint32_t> members, candidates, result;
+	result.reserve(indices.size());
+	size_t scan = 0, stamp = 0;
+	for (;;) {
+		while (scan < triCount && emitted[scan]) ++scan;
+		if (scan == triCount) break;
+
+		++stamp;
+		members.clear();
+		candidates.clear();
+		size_t clusterVertices = 0;
+		Eigen::Vector3f centerSum = Eigen::Vector3f::Zero();
+		uint32_t tri = uint32_t(scan);
+		for (;;) {
+			emitted[tri] = true;
+			members.push_back(tri);
+			centerSum += triCenters[tri];
+			for (size_t c = 0; c < 3; ++c) {
+				uint32_t v = indices[tri * 3 + c];
+				if (vertexStamps[v] == stamp) continue;
+				vertexStamps[v] = stamp;
+				clusterVertices++;
+				for (uint32_t k = offsets[v]; k < offsets[v + 1]; ++k) {
+					uint32_t t = adjacency[k];
+					if (emitted[t] || triStamps[t] == stamp) continue;
+					triStamps[t] = stamp;
+					candidates.push_back(t);
+				}
+			}
+			if (members.size() == maxTriangles)
+				break;
+
+			Eigen::Vector3f center = centerSum / float(members.size());
+			int next = -1;
+			size_t bestNew = 4, live = 0;
+			float bestDistance = FLT_MAX;
+			for (size_t i = 0; i < candidates.size(); ++i) {
+				uint32_t t = candidates[i];
+				if (emitted[t]) continue;
+				candidates[live++] = t;
+
+				size_t newVertices = 0;
+				for (size_t c = 0; c < 3; ++c)
+					newVertices += (vertexStamps[indices[t * 3 + c]] != stamp);
+				if (clusterVertices + newVertices > maxVertices)
+					continue;
+				float distance = (triCenters[t] - center).squaredNorm();
+				if (newVertices < bestNew || (newVertices == bestNew && distance < bestDistance)) {
+					next = int(t);
+					bestNew = newVertices;
+					bestDistance = distance;
+				}
+			}
+			candidates.resize(live);
+			if (next < 0)
+				break;
+			tri = uint32_t(next);
+		}
+
+		std::sort(members.begin(), members.end());
+		MeshCluster cluster;
+		cluster.IndexPos = uint32_t(result.size());
+		cluster.IndexCount = uint32_t(members.size() * 3);
+		Eigen::AlignedBox3f bounds;
+		Eigen::Vector3f normalSum = Eigen::Vector3f::Zero();
+		for (uint32_t t : members) {
+			const Eigen::Vector3f& p0 = position(indices[t * 3 + 0]);
+			const Eigen::Vector3f& p1 = position(indices[t * 3 + 1]);
+			const Eigen::Vector3f& p2 = position(indices[t * 3 + 2]);
+			bounds.extend(p0);
+			bounds.extend(p1);
+			bounds.extend(p2);
+			//front faces are clockwise as imported, the cross product points outward
+			Eigen::Vector3f n = (p1 - p0).cross(p2 - p0);
+			float length = n.norm();
+			if (length > 0.0f) normalSum += n / length;
+			result.insert(result.end(), indices.begin() + t * 3, indices.begin() + t * 3 + 3);
+		}
+
+		cluster.Center = bounds.center();
+		cluster.Radius = 0.0f;
+		for (uint32_t t : members) {
+			for (size_t c = 0; c < 3; ++c)
+				cluster.Radius = std::max(cluster.Radius, (position(indices[t * 3 + c]) - cluster.Center).norm());
+		}
+
+		//the cone is only worth testing while every normal is within ~84 degrees of the axis
+		cluster.ConeAxis = Eigen::Vector3f::Zero();
+		cluster.ConeCutoff = 1.0f;
+		float axisLength = normalSum.norm();
+		if (axisLength > 0.0f) {
+			Eigen::Vector3f axis = normalSum / axisLength;
+			float minDot = 1.0f;
+			for (uint32_t t : members) {
+				const Eigen::Vector3f& p0 = position(indices[t * 3 + 0]);
+				Eigen::Vector3f n = (position(indices[t * 3 + 1]) - p0).cross(position(indices[t * 3 + 2]) - p0);
+				float length = n.norm();
+				if (length > 0.0f) minDot = std::min(minDot, axis.dot(n) / length);
+			}
+			cluster.ConeAxis = axis;
+			if (minDot > 0.1f) cluster.ConeCutoff = std::sqrt(1.0f - minDot * minDot);
+		}
+		clusters.push_back(cluster);
+	}
+	BOOST_ASSERT(result.size() == triCount * 3);
+
+	result.insert(result.end(), indices.begin() + triCount * 3, indices.end());
+	indices.swap(result);
+	return clusters;
+}
+
+std::vector<uint32_t> MeshOptimizer::OptimizeVertexFetch(std::vector<uint32_t>& indices, size_t vertexCount) ThreadSafe
+{
+	const uint32_t kUnused = 0xFFFFFFFF;
+	std::vector<uint32_t> remap(vertexCount, kUnused);
+	uint32_t next = 0;
+	for (uint32_t& v : indices) {
+		if (remap[v] == kUnused) remap[v] = next++;
+		v = remap[v];
+	}
+	for (uint32_t& dst : remap) {
+		if (dst == kUnused) dst = next++;
+	}
+	return remap;
+}
+
+}
+}
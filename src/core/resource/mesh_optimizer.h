@@ -0,0 +1,72 @@
+#pragma once
+#include "core/base/stl.h"
+#include "core/base/math.h"
+#include "core/base/declare_macros.h"
+
+namespace mir {
+namespace res {
+
+/* post-transform cache figures of an index list, measured on a FIFO cache of CacheSize entries.
+ * ACMR is the transformed vertices per triangle (0.5 at best, 3 at worst), ATVR per referenced vertex (1 at best) */
+struct VertexCacheStats
+{
+	size_t Transformed = 0, Triangles = 0, Vertices = 0;
+public:
+	float ACMR() const { return Triangles ? float(Transformed) / Triangles : 0.0f; }
+	float ATVR() const { return Vertices ? float(Transformed) / Vertices : 0.0f; }
+};
+
+/* a run of triangles small enough to be culled on its own. the bounding sphere and the normal cone are in mesh space,
+ * every triangle faces away from an eye e when dot(Center - e, ConeAxis) >= ConeCutoff * (|Center - e| + Radius) + Radius.
+ * ConeCutoff is the sine of the cone half angle, 1 when the normals spread too far for a cone */
+struct MeshCluster
+{
+	uint32_t IndexPos, IndexCount;
+	Eigen::Vector3f Center;
+	float Radius;
+	Eigen::Vector3f ConeAxis;
+	float ConeCutoff;
+};
+
+/* import time reordering of triangle lists, after Sander et al. "Fast triangle reordering for vertex locality and
+ * reduced overdraw" (Tipsify): triangles are emitted by fanning around cached vertices, the emitted runs are cut
+ * into clusters that are sorted front to back around the mesh centroid, then the vertices are renumbered in first use order.
+ * every step is ThreadSafe, it only touches its arguments. */
+class MeshOptimizer
+{
+public:
+	enum Flags {
+		kOptimizeVertexCache = 0x1,
+		kOptimizeOverdraw = 0x2,//needs kOptimizeVertexCache, it sorts the Tipsify clusters
+		kOptimizeVertexFetch = 0x4,
+		kOptimizeCluster = 0x8,//static meshes of kClusterMinTriangles or more, see BuildClusters
+		kOptimizeDefault = kOptimizeVertexCache | kOptimizeVertexFetch | kOptimizeCluster
+	};
+	enum { kDefaultCacheSize = 16 };
+	enum { kClusterMaxVertices = 64, kClusterMaxTriangles = 124, kClusterMinTriangles = 1024 };
+	static constexpr float kDefaultOverdrawThreshold = 1.05f;
+
+	static VertexCacheStats AnalyzeVertexCache(const std::vector<uint32_t>& indices, size_t vertexCount, int cacheSize = kDefaultCacheSize) ThreadSafe;
+	/* reorders the triangles of indices, clusters gets the first triangle of each run Tipsify had to restart */
+	static void OptimizeVertexCache(std::vector<uint32_t>& indices, size_t vertexCount, int cacheSize = kDefaultCacheSize, std::vector<size_t>* clusters = nullptr) ThreadSafe;
+	/* splits the clusters where their ACMR stays within threshold of the run they belong to, then sorts them
+	 * outward facing first. positions is strided by positionStride bytes */
+	static void OptimizeOverdraw(std::vector<uint32_t>& indices, const std::vector<size_t>& clusters, const Eigen::Vector3f* positions, size_t positionStride,
+		int cacheSize = kDefaultCacheSize, float threshold = kDefaultOverdrawThreshold) ThreadSafe;
+	/* grows clusters of at most maxVertices and maxTriangles over shared vertices, each from the first triangle left, 
+	 * preferring the triangles that add the fewest vertices then the nearest ones. indices are regrouped so every cluster
+	 * is contiguous, its triangles keep their relative order */
+	static std::vector<MeshCluster> BuildClusters(std::vector<uint32_t>& indices, size_t vertexCount, const Eigen::Vector3f* positions, size_t positionStride,
+		size_t maxVertices = kClusterMaxVertices, size_t maxTriangles = kClusterMaxTriangles) ThreadSafe;
+	/* renumbers the vertices in first use order, the unreferenced ones go last. returns old index to new index */
+	static std::vector<uint32_t> OptimizeVertexFetch(std::vector<uint32_t>& indices, size_t vertexCount) ThreadSafe;
+	template<class Vector> static void RemapVertices(Vector& vertices, const std::vector<uint32_t>& remap) {
+		Vector result(vertices.size());
+		for (size_t i = 0; i < vertices.size(); ++i)
+			result[remap[i]] = vertices[i];
+		vertices.swap(result);
+	}
+};
+
+}
+}
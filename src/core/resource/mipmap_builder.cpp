@@ -0,0 +1,214 @@
+#include <cmath>
+#include <boost/assert.hpp>
+#include <boost/math/constants/constants.hpp>
+#include "core/base/math.h"
+#include "core/resource/mipmap_builder.h"
+
+namespace mir {
+namespace res {
+
+namespace {
+
+constexpr float CKaiserRadius = 3.0f, CKaiserAlpha = 4.0f;
+
+/* the zeroth order modified bessel function of the first kind, by its series */
+float BesselI0(float x)
+{
+	float sum = 1.0f, term = 1.0f, q = x * x / 4;
+	for (int k = 1; k < 32 && term > sum * 1e-8f; ++k) {
+		term *= q / (k * k);
+		sum += term;
+	}
+	return sum;
+}
+
+/* x in texels of the new level */
+float FilterWeight(MipmapFilter filter, float x)
+{
+	x = fabs(x);
+	if (filter == kMipmapFilterBox)
+		return x < 0.5f ? 1.0f : 0.0f;
+
+	if (x >= CKaiserRadius)
+		return 0.0f;
+	const float pix = boost::math::constants::pi<float>() * x;
+	const float sinc = x < 1e-5f ? 1.0f : sinf(pix) / pix;
+	const float t = x / CKaiserRadius;
+	return sinc * BesselI0(CKaiserAlpha * sqrtf(1 - t * t)) / BesselI0(CKaiserAlpha);
+}
+
+/* Count normalized weights per texel of the new level, of the old texels from First on */
+struct FilterTaps {
+	std::vector<int> First;
+	std::vector<float> Weights;
+	int Count;
+};
+FilterTaps MakeTaps(MipmapFilter filter, int srcSize, int dstSize)
+{
+	FilterTaps taps;
+	const float scale = float(srcSize) / dstSize;
+	const float support = (filter == kMipmapFilterBox ? 0.5f : CKaiserRadius) * scale;
+	taps.Count = int(ceilf(support * 2)) + 1;
+	taps.First.resize(dstSize);
+	taps.Weights.resize(dstSize * taps.Count);
+	for (int d = 0; d < dstSize; ++d) {
+		const float center = (d + 0.5f) * scale;
+		taps.First[d] = int(floorf(center - support));
+
+		float* weights = &taps.Weights[d * taps.Count];
+		float sum = 0.0f;
+		for (int t = 0; t < taps.Count; ++t) {
+			weights[t] = FilterWeight(filter, (taps.First[d] + t + 0.5f - center) / scale);
+			sum += weights[t];
+		}
+		for (int t = 0; t < taps.Count; ++t)
+			weights[t] /= sum;
+	}
+	return taps;
+}
+
+struct ColorTables {
+	float SRGBToLinear[256];
+	float UNormToFloat[256];
+	float SRGBThresholds[255];//the linear values halfway between neighbouring srgb codes
+	ColorTables() {
+		for (int i = 0; i < 256; ++i) {
+			float v = i / 255.0f;
+			UNormToFloat[i] = v;
+			SRGBToLinear[i] = v <= 0.04045f ? v / 12.92f : powf((v + 0.055f) / 1.055f, 2.4f);
+		}
+		for (int i = 0; i < 255; ++i)
+			SRGBThresholds[i] = (SRGBToLinear[i] + SRGBToLinear[i + 1]) / 2;
+	}
+	/* the srgb code nearest in linear space */
+	uint8_t LinearToSRGB(float v) const {
+		return uint8_t(std::upper_bound(std::begin(SRGBThresholds), std::end(SRGBThresholds), v) - std::begin(SRGBThresholds));
+	}
+};
+const ColorTables& GetColorTables()
+{
+	static ColorTables tables;
+	return tables;
+}
+
+template<int Channels> void DownsampleRowsT(const MipmapOptions& options, const uint8_t* src, int width, int height, size_t pitch, int firstRow, int lastRow, uint8_t* dst)
+{
+	typedef Eigen::Array<float, Channels, 1> Texel;
+	typedef Eigen::Map<Eigen::ArrayXf> Line;
+	typedef Eigen::Map<const Eigen::ArrayXf> ConstLine;
+	const ColorTables& tables = GetColorTables();
+	const float* channelTables[4] = {};
+	for (int c = 0; c < Channels; ++c)
+		channelTables[c] = (c == 3 || !options.SRGB) ? tables.UNormToFloat : tables.SRGBToLinear;
+
+	const int dstWidth = std::max(width / 2, 1), dstHeight = std::max(height / 2, 1);
+	const size_t dstPitch = MipmapBuilder::GetPitch(dstWidth, Channels);
+	const int lineSize = dstWidth * Channels;
+	const FilterTaps xTaps = MakeTaps(options.Filter, width, dstWidth);
+	const FilterTaps yTaps = MakeTaps(options.Filter, height, dstHeight);
+
+	//the source rows the band reads, filtered horizontally to the new width
+	const int firstSrc = std::max(yTaps.First[firstRow], 0);
+	const int lastSrc = std::min(yTaps.First[lastRow - 1] + yTaps.Count - 1, height - 1);
+	std::vector<float> rows((lastSrc - firstSrc + 1) * lineSize), texels(width * Channels);
+	for (int sy = firstSrc; sy <= lastSrc; ++sy) {
+		const uint8_t* in = src + sy * pitch;
+		for (int x = 0; x < width; ++x)
+			for (int c = 0; c < Channels; ++c)
+				texels[x * Channels + c] = channelTables[c][in[x * Channels + c]];
+
+		float* out = &rows[(sy - firstSrc) * lineSize];
+		for (int dx = 0; dx < dstWidth; ++dx) {
+			const float* weights = &xTaps.Weights[dx * xTaps.Count];
+			Texel sum = Texel::Zero();
+			for (int t = 0; t < xTaps.Count; ++t) {
+				int sx = std::min(std::max(xTaps.First[dx] + t, 0), width - 1);
+				sum += weights[t] * Eigen::Map<const Texel>(&texels[sx * Channels]);
+			}
+			Eigen::Map<Texel>(out + dx * Channels) = sum;
+		}
+	}
+
+	//then vertically, a whole row at a time
+	std::vector<float> line(lineSize);
+	for (int dy = firstRow; dy < lastRow; ++dy) {
+		const float* weights = &yTaps.Weights[dy * yTaps.Count];
+		Line sum(&line[0], lineSize);
+		sum.setZero();
+		for (int t = 0; t < yTaps.Count; ++t) {
+			int sy = std::min(std::max(yTaps.First[dy] + t, firstSrc), lastSrc);
+			sum += weights[t] * ConstLine(&rows[(sy - firstSrc) * lineSize], lineSize);
+		}
+		sum = sum.max(0.0f).min(1.0f);
+
+		uint8_t* out = dst + (dy - firstRow) * dstPitch;
+		for (int i = 0; i < lineSize; ++i) {
+			int c = i % Channels;
+			out[i] = (c == 3 || !options.SRGB) ? uint8_t(line[i] * 255 + 0.5f) : tables.LinearToSRGB(line[i]);
+		}
+	}
+}
+
+}
+
+int MipmapBuilder::GetLevelCount(int width, int height)
+{
+	int count = 1;
+	while ((std::max(width, height) >> count) > 0)
+		++count;
+	return count;
+}
+
+void MipmapBuilder::DownsampleRows(const MipmapOptions& options, int channels, const uint8_t* src, int width, int height, size_t pitch, int firstRow, int lastRow, uint8_t* dst) ThreadSafe
+{
+	BOOST_ASSERT(firstRow < lastRow && lastRow <= std::max(height / 2, 1));
+	switch (channels) {
+	case 1: DownsampleRowsT<1>(options, src, width, height, pitch, firstRow, lastRow, dst); break;
+	case 4: DownsampleRowsT<4>(options, src, width, height, pitch, firstRow, lastRow, dst); break;
+	default: BOOST_ASSERT(false); break;
+	}
+}
+
+float MipmapBuilder::GetAlphaCoverage(const uint8_t* rgba, int width, int height, size_t pitch, float cutoff) ThreadSafe
+{
+	size_t covered = 0;
+	for (int y = 0; y < height; ++y) {
+		const uint8_t* row = rgba + y * pitch;
+		for (int x = 0; x < width; ++x)
+			covered += row[x * 4 + 3] > cutoff * 255;
+	}
+	return float(covered) / (width * height);
+}
+
+void MipmapBuilder::ScaleAlphaToCoverage(uint8_t* rgba, int width, int height, size_t pitch, float cutoff, float coverage) ThreadSafe
+{
+	size_t histogram[256] = {};
+	for (int y = 0; y < height; ++y) {
+		const uint8_t* row = rgba + y * pitch;
+		for (int x = 0; x < width; ++x)
+			++histogram[row[x * 4 + 3]];
+	}
+
+	//the lowest alpha the covered texels have, scaled it rounds to the lowest one passing cutoff, the one below it fails.
+	//the texels sharing an alpha pass together, the nearer of the coverages around the target wins
+	const size_t target = size_t(coverage * width * height + 0.5f);
+	size_t covered = 0;
+	int lowest = 256;
+	while (lowest > 1 && covered < target)
+		covered += histogram[--lowest];
+	if (covered > target && covered - histogram[lowest] > 0 && target - (covered - histogram[lowest]) < covered - target)
+		covered -= histogram[lowest++];
+	if (covered == 0)
+		return;
+
+	const int passing = int(floorf(cutoff * 255)) + 1;
+	const float scale = (passing - 0.5f) / (lowest - 0.5f);
+	for (int y = 0; y < height; ++y) {
+		uint8_t* row = rgba + y * pitch;
+		for (int x = 0; x < width; ++x)
+			row[x * 4 + 3] = uint8_t(std::min(row[x * 4 + 3] * scale + 0.5f, 255.0f));
+	}
+}
+
+}
+}
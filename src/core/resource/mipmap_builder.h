@@ -0,0 +1,38 @@
+#pragma once
+#include "core/base/stl.h"
+#include "core/base/declare_macros.h"
+
+namespace mir {
+namespace res {
+
+enum MipmapFilter {
+	kMipmapFilterBox,
+	kMipmapFilterKaiser
+};
+struct MipmapOptions {
+	MipmapFilter Filter = kMipmapFilterKaiser;
+	bool SRGB = false;//the colors are filtered in linear space, alpha always is
+	float AlphaCutoff = 0.0f;//above 0 every level keeps the alpha tested coverage of the top one at this cutoff
+};
+
+/* cpu mip chains of 8 bit images with 1 or 4 channels, the 4th one is alpha. every level is filtered from the one
+ * above it, separably: a box, or a kaiser windowed sinc (3 texels of the new level each side, alpha 4) that keeps
+ * the detail the box blurs away. the rows of a level are independent of each other, the callers split them up over
+ * the thread pool. the rows of a level are 4 byte aligned, as RenderSystem::LoadTexture takes them on both backends */
+class MipmapBuilder
+{
+public:
+	static int GetLevelCount(int width, int height);
+	static size_t GetPitch(int width, int channels) { return (width * channels + 3) & ~3; }
+
+	/* the rows [firstRow, lastRow) of the level below a width x height image of pitch bytes per row, dst points
+	 * at the first of them and has GetPitch bytes per row */
+	static void DownsampleRows(const MipmapOptions& options, int channels, const uint8_t* src, int width, int height, size_t pitch, int firstRow, int lastRow, uint8_t* dst) ThreadSafe;
+	/* the share of the rgba texels whose alpha passes cutoff */
+	static float GetAlphaCoverage(const uint8_t* rgba, int width, int height, size_t pitch, float cutoff) ThreadSafe;
+	/* scales alpha so that a coverage share of the texels passes cutoff */
+	static void ScaleAlphaToCoverage(uint8_t* rgba, int width, int height, size_t pitch, float cutoff, float coverage) ThreadSafe;
+};
+
+}
+}
@@ -21,12 +21,14 @@ class MaterialInstance;
 DECLARE_CLASS(MaterialFactory);
 DECLARE_CLASS(ProgramFactory);
 DECLARE_CLASS(TextureFactory);
+DECLARE_CLASS(TextureStreamer);
 DECLARE_CLASS(DeviceResFactory);
 
 DECLARE_CLASS(AssimpMesh);
 DECLARE_CLASS(AiNode);
 DECLARE_CLASS(AiScene);
 DECLARE_CLASS(AiResourceFactory);
+DECLARE_CLASS(AnimationClip);
 }
 
 }
\ No newline at end of file
@@ -1,18 +1,21 @@
 #include <boost/format.hpp>
 #include <boost/lexical_cast.hpp>
 #include <boost/filesystem.hpp>
-#include <boost/date_time/gregorian/gregorian.hpp>
+#include <boost/algorithm/string.hpp>
+#include <fstream>
 #include <regex>
 #include "core/base/debug.h"
 #include "core/base/macros.h"
 #include "core/base/data.h"
 #include "core/base/input.h"
 #include "core/base/md5.h"
+#include "core/base/file_watcher.h"
 #include "core/rendersys/blob.h"
 #include "core/resource/program_factory.h"
 #include "core/resource/resource_manager.h"
 
 #define MIR_SHADER_CACHE
+#define MIR_SHADER_CACHE_CAPACITY (64 * 1024 * 1024)
 
 namespace mir {
 namespace res {
@@ -24,6 +27,13 @@ ProgramFactory::ProgramFactory(ResourceManager& resMng, const std::string& shade
 	mPlatformName = mRenderSys.GetPlatform().Name();
 	mShaderDir = shaderDir + mPlatformName + "/";
 	mShaderExt = mRenderSys.GetPlatform().ShaderExtension();
+	mAsmArchive = std::make_unique<ShaderCacheArchive>(mShaderDir + "asm_" + mPlatformName + ".ntpak", MIR_SHADER_CACHE_CAPACITY);
+
+	mVariantListPath = MakeVariantListPath(shaderDir, mPlatformName);
+	std::ifstream variantList(mVariantListPath);
+	for (std::string line; std::getline(variantList, line);) {
+		if (!line.empty()) mRecordedVariants.insert(line);
+	}
 }
 ProgramFactory::~ProgramFactory()
 {
@@ -56,92 +66,151 @@ public:
 		const std::string& ss = GetSerializeString();
 		md5((const uint8_t*)ss.c_str(), ss.length(), digest);
 	}
-	std::string GetMd5String() {
-		uint32_t digest[4];
-		GetMd5((uint8_t*)digest);
-		return (boost::format("%x%x%x%x") %digest[0] %digest[1] %digest[2] %digest[3]).str();
-	}
 public:
 	std::string mSerializeString;
 	const ShaderCompileDesc& mSCD;
 	const std::string& mSource;
 };
-boost::filesystem::path ProgramFactory::MakeShaderAsmPath(const std::string& name, const ShaderCompileDesc& desc, const std::string& platform, time_t& time, std::string& serializeStr) const
+
+ShaderCacheDigest ProgramFactory::GetFileContentHash(const std::string& filepath, std::vector<std::string>& includes) ThreadSafe
 {
-	std::string asmDir = mShaderDir + "asm_" + platform + "/";
-	if (!boost::filesystem::is_directory(asmDir)) {
-		boost::filesystem::create_directories(asmDir);
+	boost::system::error_code ec;
+	time_t time = boost::filesystem::last_write_time(filepath, ec);
+	if (ec) time = 0;
+	{
+		std::lock_guard<std::mutex> lck(mSourceHashLock);
+		auto iter = mSourceHashByPath.find(filepath);
+		if (iter != mSourceHashByPath.end() && iter->second.Time == time) {
+			includes = iter->second.Includes;
+			return iter->second.Digest;
+		}
 	}
 
-	ShaderCompileDescHelper scdHelper(desc, name);
-	std::string md5Str = scdHelper.GetMd5String();
-	std::string asmFilePath = asmDir + md5Str + ".ntasm";
+	SourceFileHash hash;
+	hash.Time = time;
+	if (time) {
+		std::vector<char> bin = input::ReadFile(filepath.c_str(), "rb");
+		if (!bin.empty()) md5((const uint8_t*)&bin[0], bin.size(), hash.Digest.Bytes);
 
-	serializeStr = scdHelper.GetSerializeString();
+		std::regex pattern("#include\\s*\"([^\"]+)\"");
+		std::string content(bin.begin(), bin.end());
+		for (std::sregex_iterator iter(content.begin(), content.end(), pattern), end; iter != end; ++iter)
+			hash.Includes.push_back((*iter)[1]);
+	}
+	includes = hash.Includes;
 
-	time = 0;
-#if defined MIR_RESOURCE_DEBUG || defined MIR_SHADER_CACHE
-	auto sourcePath = MakeShaderSourcePath(name);
-	if (boost::filesystem::exists(sourcePath))
+	std::lock_guard<std::mutex> lck(mSourceHashLock);
+	return (mSourceHashByPath[filepath] = std::move(hash)).Digest;
+}
+
+ShaderCacheDigest ProgramFactory::MakeSourceContentHash(const std::string& name) ThreadSafe
+{
+	//hash of the source and every file it includes, in include order
+	std::string digests;
+	std::set<std::string> visited;
+	std::vector<std::string> stack = { mShaderDir + name + mShaderExt };
+	while (!stack.empty()) {
+		std::string filepath = std::move(stack.back());
+		stack.pop_back();
+		if (!visited.insert(filepath).second)
+			continue;
+
+		std::vector<std::string> includes;
+		ShaderCacheDigest digest = GetFileContentHash(filepath, includes);
+		digests.append((const char*)digest.Bytes, sizeof(digest.Bytes));
+		for (auto iter = includes.rbegin(); iter != includes.rend(); ++iter)
+			stack.push_back(mShaderDir + *iter);
+	}
+
+	std::set<std::string> sourceFiles;
+	for (const auto& filepath : visited)
+		sourceFiles.insert(FileWatcher::NormalizePath(filepath));
 	{
-		time = boost::filesystem::last_write_time(sourcePath);
-
-		time_t cgincs_time = 0;
-		{
-			boost::filesystem::directory_iterator diter(mShaderDir), dend;
-			for (; diter != dend; ++diter) {
-				if (boost::filesystem::is_regular_file(*diter) && (*diter).path().extension() == mShaderExt) {
-					time_t htime = boost::filesystem::last_write_time((*diter).path());
-					cgincs_time = std::max(cgincs_time, htime);
-				}
-			}
-		}
-		time = std::max(time, cgincs_time);
+		std::lock_guard<std::mutex> lck(mSourceHashLock);
+		mSourceFilesByName[name] = std::move(sourceFiles);
 	}
-#endif
 
-	return boost::filesystem::system_complete(asmFilePath);
+	ShaderCacheDigest result;
+	md5((const uint8_t*)digests.c_str(), digests.length(), result.Bytes);
+	return result;
 }
 
-#define NTASM_NAME_LEN (512-16)
-#define NTASM_TIME_SIZE (16)
-void ProgramFactory::WriteShaderAsm(const boost::filesystem::path& asmPath, const char* pByte, size_t size, time_t time, const std::string& serializeStr) const ThreadSafe
+std::string ProgramFactory::MakeVariantListPath(const std::string& shaderDir, const std::string& platformName)
 {
-	std::vector<char> bin(pByte, pByte + size);
-	
-	size_t position = bin.size();
-	bin.resize(position + NTASM_NAME_LEN);
-	BOOST_ASSERT(serializeStr.length() < NTASM_NAME_LEN);
-	strcpy(&bin[position], serializeStr.c_str());
-
-	position = bin.size();
-	bin.resize(position + NTASM_TIME_SIZE);
-	std::string timeStr = boost::lexical_cast<std::string>(time);
-	BOOST_ASSERT(timeStr.length() < NTASM_TIME_SIZE);
-	strcpy(&bin[position], timeStr.c_str());
-
-	input::WriteFile(asmPath.string().c_str(), "wb", &bin[0], bin.size());
+	return shaderDir + platformName + "/variants.txt";
 }
-bool ProgramFactory::ReadShaderAsm(const boost::filesystem::path& asmPath, std::vector<char>& bin, time_t time, const std::string& serializeStr) const
+
+/* name, then entry, shader model, source and macros of the vertex and of the pixel shader, tab separated.
+ * the macros are space separated Name=Definition pairs */
+std::string ProgramFactory::SerializeVariant(const std::string& name, const ShaderCompileDesc& vertexSCD, const ShaderCompileDesc& pixelSCD)
 {
-	bin.clear();
-	if (boost::filesystem::exists(asmPath)) {
-		bin = input::ReadFile(asmPath.string().c_str(), "rb");
-		if (bin.size() >= NTASM_NAME_LEN + NTASM_TIME_SIZE) {
-			size_t position = bin.size() - NTASM_NAME_LEN - NTASM_TIME_SIZE;
-			std::string fileSeriStr(bin.begin() + position, bin.begin() + position + NTASM_NAME_LEN);
-			if (strcmp(fileSeriStr.c_str(), serializeStr.c_str()) == 0) {
-				position += NTASM_NAME_LEN;
-				std::string fileTimeStr(bin.begin() + position, bin.begin() + position + NTASM_TIME_SIZE);
-				time_t fileTime = std::stoi(fileTimeStr);
-				if (fileTime >= time) {
-					bin.resize(bin.size() - NTASM_NAME_LEN - NTASM_TIME_SIZE);
-					return true;
-				}
-			}
+	std::string line = name;
+	for (const ShaderCompileDesc* scd : { &vertexSCD, &pixelSCD }) {
+		std::vector<std::string> macros;
+		for (const auto& m : scd->Macros)
+			macros.push_back(m.Name + "=" + m.Definition);
+		line += "\t" + scd->EntryPoint + "\t" + scd->ShaderModel + "\t" + scd->SourcePath + "\t" + boost::join(macros, " ");
+	}
+	return line;
+}
+
+bool ProgramFactory::ParseVariant(const std::string& line, std::string& name, ShaderCompileDesc& vertexSCD, ShaderCompileDesc& pixelSCD)
+{
+	std::vector<std::string> fields;
+	boost::split(fields, line, boost::is_any_of("\t"));
+	if (fields.size() != 9)
+		return false;
+
+	name = fields[0];
+	ShaderCompileDesc* scds[] = { &vertexSCD, &pixelSCD };
+	for (int i = 0; i < 2; ++i) {
+		ShaderCompileDesc& scd = *scds[i];
+		scd.EntryPoint = fields[1 + i * 4];
+		scd.ShaderModel = fields[2 + i * 4];
+		scd.SourcePath = fields[3 + i * 4];
+		scd.Macros.clear();
+
+		std::vector<std::string> macros;
+		boost::split(macros, fields[4 + i * 4], boost::is_any_of(" "), boost::token_compress_on);
+		for (const auto& macro : macros) {
+			size_t pos = macro.find('=');
+			if (pos != std::string::npos)
+				scd.Macros.push_back(ShaderCompileMacro{ macro.substr(0, pos), macro.substr(pos + 1) });
 		}
 	}
-	return false;
+	return true;
+}
+
+void ProgramFactory::RecordVariant(const std::string& name, const ShaderCompileDesc& vertexSCD, const ShaderCompileDesc& pixelSCD) ThreadSafe
+{
+	std::string line = SerializeVariant(name, vertexSCD, pixelSCD);
+	std::lock_guard<std::mutex> lck(mVariantLock);
+	if (mRecordedVariants.insert(line).second)
+		std::ofstream(mVariantListPath, std::ios::app) << line << std::endl;
+}
+
+IBlobDataPtr ProgramFactory::LoadShaderBlob(const std::string& name, ShaderCompileDesc& desc, const ShaderCacheDigest& contentHash) ThreadSafe
+{
+	ShaderCacheDigest key;
+	ShaderCompileDescHelper(desc, name).GetMd5(key.Bytes);
+
+	std::vector<char> bin;
+#if defined MIR_RESOURCE_DEBUG || defined MIR_SHADER_CACHE
+	if (mAsmArchive->Read(key, contentHash, bin))
+		return CreateInstance<BlobDataBytes>(std::move(bin));
+#endif
+
+	IBlobDataPtr blob;
+	desc.SourcePath = MakeShaderSourcePath(name).string();
+	bin = input::ReadFile(desc.SourcePath.c_str(), "rb");
+	BOOST_ASSERT(!bin.empty());
+	if (!bin.empty()) {
+		blob = this->mRenderSys.CompileShader(desc, Data::Make(bin));
+	#if defined MIR_RESOURCE_DEBUG || defined MIR_SHADER_CACHE
+		if (blob && blob->GetBytes()) mAsmArchive->Append(key, contentHash, blob->GetBytes(), blob->GetSize());
+	#endif
+	}
+	return blob;
 }
 
 CoTask<bool> ProgramFactory::_LoadProgram(IProgramPtr program, Launch lchMode, std::string name, ShaderCompileDesc vertexSCD, ShaderCompileDesc pixelSCD) ThreadSafe ThreadMaySwitch
@@ -161,47 +230,11 @@ CoTask<bool> ProgramFactory::_LoadProgram(IProgramPtr program, Launch lchMode, s
 	pixelSCD.Macros.push_back(ShaderCompileMacro{"PLATFORM", boost::lexical_cast<std::string>(mRenderSys.GetPlatform().Type) });
 
 	IBlobDataPtr blobVS, blobPS;
-	if (!vertexSCD.EntryPoint.empty()) {
-		time_t time;
-		std::string serializeStr;
-		std::vector<char> bin;
-		boost::filesystem::path vsAsmPath = MakeShaderAsmPath(name, vertexSCD, mPlatformName, time, serializeStr);
-		if (ReadShaderAsm(vsAsmPath, bin, time, serializeStr)) {
-			blobVS = CreateInstance<BlobDataBytes>(std::move(bin));
-		}
-		else {
-			vertexSCD.SourcePath = MakeShaderSourcePath(name).string();
-			bin = input::ReadFile(vertexSCD.SourcePath.c_str(), "rb");
-			BOOST_ASSERT(!bin.empty());
-			if (!bin.empty()) {
-				blobVS = this->mRenderSys.CompileShader(vertexSCD, Data::Make(bin));
-			#if defined MIR_RESOURCE_DEBUG || defined MIR_SHADER_CACHE
-				if (blobVS->GetBytes()) WriteShaderAsm(vsAsmPath, blobVS->GetBytes(), blobVS->GetSize(), time, serializeStr);
-			#endif
-			}
-		}
-	}
-
-	if (!pixelSCD.EntryPoint.empty()) {
-		time_t time;
-		std::string serializeStr;
-		std::vector<char> bin;
-		boost::filesystem::path psAsmPath = MakeShaderAsmPath(name, pixelSCD, mPlatformName, time, serializeStr);
-		if (ReadShaderAsm(psAsmPath, bin, time, serializeStr)) {
-			blobPS = CreateInstance<BlobDataBytes>(std::move(bin));
-		}
-		else {
-			pixelSCD.SourcePath = MakeShaderSourcePath(name).string();
-			bin = input::ReadFile(pixelSCD.SourcePath.c_str(), "rb");
-			BOOST_ASSERT(!bin.empty());
-			if (!bin.empty()) {
-				blobPS = this->mRenderSys.CompileShader(pixelSCD, Data::Make(bin));
-			#if defined MIR_RESOURCE_DEBUG || defined MIR_SHADER_CACHE
-				if (blobPS->GetBytes()) WriteShaderAsm(psAsmPath, blobPS->GetBytes(), blobPS->GetSize(), time, serializeStr);
-			#endif
-			}
-		}
-	}
+	ShaderCacheDigest contentHash = MakeSourceContentHash(name);
+	if (!vertexSCD.EntryPoint.empty())
+		blobVS = LoadShaderBlob(name, vertexSCD, contentHash);
+	if (!pixelSCD.EntryPoint.empty())
+		blobPS = LoadShaderBlob(name, pixelSCD, contentHash);
 
 	//CoAwait mResMng.SwitchToLaunchService(LaunchSync);
 	auto loadProgram = [blobVS, blobPS, this](IProgramPtr program)->IProgramPtr {
@@ -236,6 +269,9 @@ CoTask<bool> ProgramFactory::CreateProgram(IProgramPtr& program, Launch lchMode,
 		return program;
 	});
 	if (resNeedLoad) {
+	#if defined MIR_RESOURCE_DEBUG || defined MIR_SHADER_CACHE
+		RecordVariant(key.name, key.vertexSCD, key.pixelSCD);
+	#endif
 		CoAwait this->_LoadProgram(program, lchMode, std::move(key.name), std::move(key.vertexSCD), std::move(key.pixelSCD));
 	}
 	else {
@@ -249,5 +285,30 @@ void ProgramFactory::PurgeAll() ThreadSafe
 	mProgramByKey.Clear();
 }
 
+void ProgramFactory::PurgeByFiles(const std::set<std::string>& changedFiles) ThreadSafe
+{
+	std::set<std::string> dirtyNames;
+	{
+		std::lock_guard<std::mutex> lck(mSourceHashLock);
+		for (const auto& it : mSourceFilesByName) {
+			for (const auto& file : it.second) {
+				if (changedFiles.count(file)) {
+					dirtyNames.insert(it.first);
+					break;
+				}
+			}
+		}
+	}
+	if (dirtyNames.empty())
+		return;
+
+	tpl::AutoLock lck(mProgramByKey._GetLock());
+	auto& programByKey = mProgramByKey._GetDic();
+	for (auto iter = programByKey.begin(); iter != programByKey.end();) {
+		if (dirtyNames.count(iter->first.name)) iter = programByKey.erase(iter);
+		else ++iter;
+	}
+}
+
 }
 }
\ No newline at end of file
@@ -1,4 +1,5 @@
 #pragma once
+#include <mutex>
 #include <boost/noncopyable.hpp>
 #include <boost/filesystem.hpp>
 #include "core/base/stl.h"
@@ -10,6 +11,7 @@
 #include "core/rendersys/predeclare.h"
 #include "core/resource/predeclare.h"
 #include "core/rendersys/program.h"
+#include "core/resource/shader_cache_archive.h"
 
 namespace mir {
 namespace res {
@@ -25,12 +27,20 @@ public:
 	DECLARE_COTASK_FUNCTIONS(IProgramPtr, CreateProgram, ThreadSafe ThreadMaySwitch);
 
 	void PurgeAll() ThreadSafe;
+	void PurgeByFiles(const std::set<std::string>& changedFiles) ThreadSafe;
+
+	/* every program the runtime asks for is appended once to <shader dir><platform>/variants.txt, a line per
+	 * program, so shader_precompile replays the variants the loaders really produce */
+	static std::string MakeVariantListPath(const std::string& shaderDir, const std::string& platformName);
+	static std::string SerializeVariant(const std::string& name, const ShaderCompileDesc& vertexSCD, const ShaderCompileDesc& pixelSCD);
+	static bool ParseVariant(const std::string& line, std::string& name, ShaderCompileDesc& vertexSCD, ShaderCompileDesc& pixelSCD);
 private:
+	void RecordVariant(const std::string& name, const ShaderCompileDesc& vertexSCD, const ShaderCompileDesc& pixelSCD) ThreadSafe;
 	CoTask<bool> _LoadProgram(IProgramPtr program, Launch lchMode, std::string name, ShaderCompileDesc vertexSCD, ShaderCompileDesc pixelSCD) ThreadSafe ThreadMaySwitch;
+	IBlobDataPtr LoadShaderBlob(const std::string& name, ShaderCompileDesc& desc, const ShaderCacheDigest& contentHash) ThreadSafe;
 	boost::filesystem::path MakeShaderSourcePath(const std::string& name) const ThreadSafe;
-	boost::filesystem::path MakeShaderAsmPath(const std::string& name, const ShaderCompileDesc& desc, const std::string& platform, time_t& time, std::string& serializeStr) const ThreadSafe;
-	bool ReadShaderAsm(const boost::filesystem::path& asmPath, std::vector<char>& bin, time_t time, const std::string& serializeStr) const ThreadSafe;
-	void WriteShaderAsm(const boost::filesystem::path& asmPath, const char* pByte, size_t size, time_t time, const std::string& serializeStr) const ThreadSafe;
+	ShaderCacheDigest MakeSourceContentHash(const std::string& name) ThreadSafe;
+	ShaderCacheDigest GetFileContentHash(const std::string& filepath, std::vector<std::string>& includes) ThreadSafe;
 private:
 	ResourceManager& mResMng;
 	RenderSystem& mRenderSys;
@@ -45,6 +55,18 @@ private:
 		}
 	};
 	tpl::AtomicMap<ProgramKey, IProgramPtr> mProgramByKey;
+	struct SourceFileHash {
+		time_t Time = 0;
+		ShaderCacheDigest Digest = {};
+		std::vector<std::string> Includes;
+	};
+	std::map<std::string, SourceFileHash> mSourceHashByPath;
+	std::map<std::string, std::set<std::string>> mSourceFilesByName;
+	std::mutex mSourceHashLock;
+	std::unique_ptr<ShaderCacheArchive> mAsmArchive;
+	std::string mVariantListPath;
+	std::set<std::string> mRecordedVariants;
+	std::mutex mVariantLock;
 };
 
 }
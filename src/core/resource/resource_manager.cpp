@@ -7,6 +7,7 @@
 #include "core/resource/resource_manager.h"
 #include "core/resource/device_res_factory.h"
 #include "core/resource/texture_factory.h"
+#include "core/resource/texture_streamer.h"
 #include "core/resource/program_factory.h"
 #include "core/resource/material_factory.h"
 #include "core/resource/assimp_factory.h"
@@ -19,6 +20,7 @@ ResourceManager::ResourceManager(RenderSystem& renderSys, std::shared_ptr<cppcor
 	mMaterialFac = CreateInstance<res::MaterialFactory>(*this, shaderDir);
 	mProgramFac = CreateInstance<res::ProgramFactory>(*this, shaderDir);
 	mTextureFac = CreateInstance<res::TextureFactory>(*this);
+	mTexStreamer = CreateInstance<res::TextureStreamer>(*this);
 	mAiResFac = CreateInstance<res::AiResourceFactory>(*this);
 	mDeviceResFac = CreateInstance<res::DeviceResFactory>(mRenderSys);
 
@@ -28,6 +30,9 @@ ResourceManager::ResourceManager(RenderSystem& renderSys, std::shared_ptr<cppcor
 	constexpr int CThreadPoolNumber = 8;
 	mThreadPool = CreateInstance<cppcoro::static_thread_pool>(CThreadPoolNumber);
 	mIoService = ioService;
+#if MIR_MATERIAL_HOTLOAD
+	mShaderWatcher = CreateInstance<FileWatcher>(shaderDir);
+#endif
 }
 ResourceManager::~ResourceManager()
 {
@@ -38,6 +43,11 @@ void ResourceManager::Dispose() ThreadSafe
 {
 	if (mThreadPool) {
 		DEBUG_LOG_MEMLEAK("resMng.Dispose");
+	#if MIR_MATERIAL_HOTLOAD
+		mShaderWatcher = nullptr;
+	#endif
+		mTexStreamer->Dispose(*mIoService);
+		mTexStreamer = nullptr;
 		mDeviceResFac = nullptr;
 		mTextureFac = nullptr;
 		mProgramFac = nullptr;
@@ -72,6 +82,14 @@ CoTask<void> ResourceManager::SwitchToLaunchService(Launch launchMode)
 #endif
 	CoReturnVoid;
 }
+CoTask<void> ResourceManager::ScheduleOnThreadPool()
+{
+#if !defined MIR_CPPCORO_DISABLED
+	CoAwait mThreadPool->schedule();
+	BOOST_ASSERT(IsCurrentInAsyncService());
+#endif
+	CoReturnVoid;
+}
 CoTask<void> ResourceManager::WaitResComplete(IResourcePtr res, std::chrono::microseconds interval)
 {
 #if !defined MIR_CPPCORO_DISABLED
@@ -95,10 +113,27 @@ CoTask<void> ResourceManager::UpdateFrame(float dt) ThreadSafe
 #if MIR_MATERIAL_HOTLOAD
 	DEBUG_LOG_CALLSTK("resMng.UpdateFrame");
 	FrameCount++;
-	if ((FrameCount % 30 == 0) && mMaterialFac->PurgeOutOfDates()) {
+	std::set<std::string> changedFiles;
+	bool overflow = false;
+	if (mShaderWatcher->IsWatching()) {
+		if (mShaderWatcher->PopChanges(changedFiles, overflow)) {
+			if (overflow) {
+				mMaterialFac->PurgeOutOfDates();
+				mProgramFac->PurgeAll();
+			}
+			else {
+				mMaterialFac->PurgeByFiles(changedFiles);
+				mProgramFac->PurgeByFiles(changedFiles);
+			}
+			mDeviceResFac->PurgeUnusedStates();
+		}
+	}
+	else if ((FrameCount % 30 == 0) && mMaterialFac->PurgeOutOfDates()) {
 		mProgramFac->PurgeAll();
+		mDeviceResFac->PurgeUnusedStates();
 	}
 #endif
+	mTexStreamer->UpdateFrame();
 	CoReturn;
 }
 
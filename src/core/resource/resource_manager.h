@@ -5,6 +5,7 @@
 #include "core/base/cppcoro.h"
 #include "core/base/launch.h"
 #include "core/base/declare_macros.h"
+#include "core/base/file_watcher.h"
 #include "core/rendersys/predeclare.h"
 #include "core/resource/predeclare.h"
 #include "core/rendersys/render_system.h"
@@ -53,20 +54,26 @@ public:
 	res::MaterialFactory& GetMtlFac() { return *mMaterialFac; }
 	res::ProgramFactory& GetProgramFac() { return *mProgramFac; }
 	res::TextureFactory& GetTexFac() { return *mTextureFac; }
+	res::TextureStreamer& GetTexStreamer() { return *mTexStreamer; }
 	res::AiResourceFactory& GetAiResFac() { return *mAiResFac; }
 	res::DeviceResFactory& GetDeviceResFac() { return *mDeviceResFac; }
 
 	bool IsCurrentInAsyncService() const;
 	CoTask<void> SwitchToLaunchService(Launch launchMode) ThreadMaySwitch;
+	/* queues the caller on the thread pool even from one of its threads, the tasks of a WhenAll run in parallel so */
+	CoTask<void> ScheduleOnThreadPool() ThreadMaySwitch;
 	CoTask<void> WaitResComplete(IResourcePtr res, std::chrono::microseconds interval = std::chrono::microseconds(1));
 #if MIR_MATERIAL_HOTLOAD
 public:
 	int FrameCount = 0;
+private:
+	std::shared_ptr<FileWatcher> mShaderWatcher;
 #endif
 private:
 	RenderSystem& mRenderSys;
 	res::DeviceResFactoryPtr mDeviceResFac;
 	res::TextureFactoryPtr mTextureFac;
+	res::TextureStreamerPtr mTexStreamer;
 	res::ProgramFactoryPtr mProgramFac;
 	res::MaterialFactoryPtr mMaterialFac;
 	res::AiResourceFactoryPtr mAiResFac;
@@ -0,0 +1,270 @@
+#include <windows.h>
+#include <boost/filesystem.hpp>
+#include "core/base/debug.h"
+#include "core/resource/shader_cache_archive.h"
+
+namespace mir {
+namespace res {
+
+#define NTPAK_MAGIC 0x4B50544E //"NTPK"
+#define NTPAK_RECORD_MAGIC 0x4345524E //"NREC"
+#define NTPAK_VERSION 1
+#define NTPAK_ALIGN(SIZE) (((SIZE) + 15) & ~size_t(15))
+
+struct ArchiveHeader {
+	uint32_t Magic, Version, Reserved[2];
+};
+struct RecordHeader {
+	uint32_t Magic, Size, Checksum, Reserved;
+	ShaderCacheDigest Key, ContentHash;
+};
+static_assert(sizeof(ArchiveHeader) == 16 && sizeof(RecordHeader) == 48, "ntpak layout");
+
+static uint32_t Fnv1a(const char* bytes, size_t size)
+{
+	uint32_t h = 2166136261u;
+	for (size_t i = 0; i < size; ++i)
+		h = (h ^ uint8_t(bytes[i])) * 16777619u;
+	return h;
+}
+
+static bool WriteAt(HANDLE file, uint64_t offset, const void* bytes, size_t size)
+{
+	OVERLAPPED ov = {};
+	ov.Offset = DWORD(offset & 0xFFFFFFFF);
+	ov.OffsetHigh = DWORD(offset >> 32);
+	DWORD written = 0;
+	return ::WriteFile(file, bytes, DWORD(size), &written, &ov) && written == size;
+}
+
+/********** ShaderCacheArchive **********/
+ShaderCacheArchive::ShaderCacheArchive(const std::string& archivePath, size_t capacity)
+	: mPath(archivePath)
+	, mCapacity(capacity)
+{
+	std::unique_lock<std::shared_mutex> lck(mMutex);
+	auto dir = boost::filesystem::path(mPath).parent_path();
+	if (!dir.empty() && !boost::filesystem::is_directory(dir))
+		boost::filesystem::create_directories(dir);
+
+	if (Open() && mFileSize > mCapacity)
+		_Compact(mCapacity * 3 / 4);
+}
+ShaderCacheArchive::~ShaderCacheArchive()
+{
+	std::unique_lock<std::shared_mutex> lck(mMutex);
+	Close();
+}
+
+bool ShaderCacheArchive::Open()
+{
+	mFile = ::CreateFileA(mPath.c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+		NULL, OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (mFile == INVALID_HANDLE_VALUE) {
+		mFile = nullptr;
+		DEBUG_LOG_ERROR("shaderCacheArchive.Open failed " + mPath);
+		return false;
+	}
+
+	LARGE_INTEGER size;
+	::GetFileSizeEx(mFile, &size);
+	if (size.QuadPart < sizeof(ArchiveHeader)) {
+		ArchiveHeader header = { NTPAK_MAGIC, NTPAK_VERSION };
+		::SetFilePointer(mFile, 0, NULL, FILE_BEGIN);
+		::SetEndOfFile(mFile);
+		WriteAt(mFile, 0, &header, sizeof(header));
+	}
+
+	if (!Remap()) return false;
+	BuildIndex();
+	return true;
+}
+
+void ShaderCacheArchive::Close()
+{
+	if (mView) ::UnmapViewOfFile(mView);
+	if (mMapping) ::CloseHandle(mMapping);
+	if (mFile) ::CloseHandle(mFile);
+	mView = nullptr;
+	mMapping = mFile = nullptr;
+	mViewSize = mFileSize = mLiveSize = 0;
+	mIndex.clear();
+}
+
+bool ShaderCacheArchive::Remap()
+{
+	if (mView) ::UnmapViewOfFile(mView);
+	if (mMapping) ::CloseHandle(mMapping);
+	mView = nullptr;
+	mMapping = nullptr;
+
+	LARGE_INTEGER size;
+	::GetFileSizeEx(mFile, &size);
+	mViewSize = size_t(size.QuadPart);
+	mMapping = ::CreateFileMappingA(mFile, NULL, PAGE_READONLY, 0, 0, NULL);
+	if (mMapping) mView = (const char*)::MapViewOfFile(mMapping, FILE_MAP_READ, 0, 0, 0);
+	if (mView == nullptr) {
+		DEBUG_LOG_ERROR("shaderCacheArchive.Remap failed " + mPath);
+		mViewSize = 0;
+		return false;
+	}
+	return true;
+}
+
+void ShaderCacheArchive::BuildIndex()
+{
+	mIndex.clear();
+	mLiveSize = 0;
+
+	const ArchiveHeader* header = (const ArchiveHeader*)mView;
+	bool valid = mViewSize >= sizeof(ArchiveHeader) && header->Magic == NTPAK_MAGIC && header->Version == NTPAK_VERSION;
+	size_t position = sizeof(ArchiveHeader);
+	while (valid && position + sizeof(RecordHeader) <= mViewSize) {
+		const RecordHeader* rec = (const RecordHeader*)(mView + position);
+		size_t blobPos = position + sizeof(RecordHeader);
+		if (rec->Magic != NTPAK_RECORD_MAGIC
+			|| blobPos + rec->Size > mViewSize
+			|| Fnv1a(mView + blobPos, rec->Size) != rec->Checksum) {
+			valid = false;
+			break;
+		}
+
+		auto iter = mIndex.try_emplace(rec->Key).first;
+		Entry& entry = iter->second;
+		if (entry.Size) mLiveSize -= sizeof(RecordHeader) + NTPAK_ALIGN(entry.Size);
+		entry.ContentHash = rec->ContentHash;
+		entry.Offset = blobPos;
+		entry.Size = rec->Size;
+		entry.LastAccess = 0;
+		mLiveSize += sizeof(RecordHeader) + NTPAK_ALIGN(rec->Size);
+
+		position = blobPos + NTPAK_ALIGN(rec->Size);
+	}
+	mFileSize = std::min(position, mViewSize);
+
+	//torn tail (crashed while appending) or foreign version, rewrite what is readable
+	if ((!valid || position < mViewSize) && !mCompacting) {
+		DEBUG_LOG_WARN("shaderCacheArchive.BuildIndex drop broken tail " + mPath);
+		_Compact(mCapacity);
+	}
+}
+
+bool ShaderCacheArchive::Read(const ShaderCacheDigest& key, const ShaderCacheDigest& contentHash, std::vector<char>& bin) ThreadSafe
+{
+	std::shared_lock<std::shared_mutex> lck(mMutex);
+	auto iter = mIndex.find(key);
+	if (iter == mIndex.end() || iter->second.ContentHash != contentHash)
+		return false;
+
+	const Entry& entry = iter->second;
+	BOOST_ASSERT(entry.Offset + entry.Size <= mViewSize);
+	bin.assign(mView + entry.Offset, mView + entry.Offset + entry.Size);
+	entry.LastAccess.store(++mAccessTick, std::memory_order_relaxed);
+	return true;
+}
+
+bool ShaderCacheArchive::Append(const ShaderCacheDigest& key, const ShaderCacheDigest& contentHash, const char* bytes, size_t size) ThreadSafe
+{
+	if (size == 0 || size > UINT32_MAX)
+		return false;
+
+	std::unique_lock<std::shared_mutex> lck(mMutex);
+	if (mFile == nullptr)
+		return false;
+
+	std::vector<char> record(sizeof(RecordHeader) + NTPAK_ALIGN(size), 0);
+	RecordHeader& rec = *(RecordHeader*)&record[0];
+	rec.Magic = NTPAK_RECORD_MAGIC;
+	rec.Size = uint32_t(size);
+	rec.Checksum = Fnv1a(bytes, size);
+	rec.Key = key;
+	rec.ContentHash = contentHash;
+	memcpy(&record[sizeof(RecordHeader)], bytes, size);
+
+	//other processes (e.g. the precompile tool) may append too, the header range is the file lock
+	OVERLAPPED ov = {};
+	if (!::LockFileEx(mFile, LOCKFILE_EXCLUSIVE_LOCK, 0, sizeof(ArchiveHeader), 0, &ov))
+		return false;
+	LARGE_INTEGER end;
+	::GetFileSizeEx(mFile, &end);
+	bool written = WriteAt(mFile, uint64_t(end.QuadPart), &record[0], record.size());
+	::UnlockFileEx(mFile, 0, sizeof(ArchiveHeader), 0, &ov);
+	if (!written || !Remap())
+		return false;
+
+	auto iter = mIndex.try_emplace(key).first;
+	Entry& entry = iter->second;
+	if (entry.Size) mLiveSize -= sizeof(RecordHeader) + NTPAK_ALIGN(entry.Size);
+	entry.ContentHash = contentHash;
+	entry.Offset = uint64_t(end.QuadPart) + sizeof(RecordHeader);
+	entry.Size = uint32_t(size);
+	entry.LastAccess = ++mAccessTick;
+	mLiveSize += record.size();
+	mFileSize = mViewSize;
+
+	if (mFileSize > mCapacity)
+		_Compact(mCapacity * 3 / 4);
+	return true;
+}
+
+void ShaderCacheArchive::Compact() ThreadSafe
+{
+	std::unique_lock<std::shared_mutex> lck(mMutex);
+	_Compact(mCapacity);
+}
+
+bool ShaderCacheArchive::_Compact(size_t targetSize)
+{
+	TIME_PROFILE("shaderCacheArchive.Compact " + mPath);
+	//most recently used first, records never touched in this session keep their file order
+	std::vector<std::pair<const ShaderCacheDigest*, const Entry*>> entries;
+	entries.reserve(mIndex.size());
+	for (auto& iter : mIndex)
+		entries.push_back(std::make_pair(&iter.first, &iter.second));
+	std::sort(entries.begin(), entries.end(), [](const auto& l, const auto& r) {
+		uint32_t la = l.second->LastAccess, ra = r.second->LastAccess;
+		if (la != ra) return la > ra;
+		return l.second->Offset < r.second->Offset;
+	});
+
+	std::vector<char> content(sizeof(ArchiveHeader), 0);
+	ArchiveHeader& header = *(ArchiveHeader*)&content[0];
+	header.Magic = NTPAK_MAGIC;
+	header.Version = NTPAK_VERSION;
+	for (auto& it : entries) {
+		const Entry& entry = *it.second;
+		size_t recordSize = sizeof(RecordHeader) + NTPAK_ALIGN(entry.Size);
+		if (content.size() + recordSize > targetSize)
+			break;
+
+		size_t position = content.size();
+		content.resize(position + recordSize, 0);
+		RecordHeader& rec = *(RecordHeader*)&content[position];
+		rec.Magic = NTPAK_RECORD_MAGIC;
+		rec.Size = entry.Size;
+		rec.Checksum = Fnv1a(mView + entry.Offset, entry.Size);
+		rec.Key = *it.first;
+		rec.ContentHash = entry.ContentHash;
+		memcpy(&content[position + sizeof(RecordHeader)], mView + entry.Offset, entry.Size);
+	}
+
+	//write aside and swap, a reader process still mapping the old file makes the swap fail and we keep it
+	std::string tmpPath = mPath + ".tmp";
+	HANDLE tmp = ::CreateFileA(tmpPath.c_str(), GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (tmp == INVALID_HANDLE_VALUE)
+		return false;
+	bool written = WriteAt(tmp, 0, &content[0], content.size());
+	::FlushFileBuffers(tmp);
+	::CloseHandle(tmp);
+
+	mCompacting = true;
+	Close();
+	bool swapped = written && ::MoveFileExA(tmpPath.c_str(), mPath.c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH);
+	if (!swapped) ::DeleteFileA(tmpPath.c_str());
+	Open();
+	mCompacting = false;
+	return swapped;
+}
+
+}
+}
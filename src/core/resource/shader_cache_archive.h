@@ -0,0 +1,70 @@
+#pragma once
+#include <shared_mutex>
+#include <boost/noncopyable.hpp>
+#include "core/mir_export.h"
+#include "core/base/stl.h"
+#include "core/base/declare_macros.h"
+
+namespace mir {
+namespace res {
+
+struct ShaderCacheDigest
+{
+	uint8_t Bytes[16];
+public:
+	bool operator==(const ShaderCacheDigest& other) const { return memcmp(Bytes, other.Bytes, sizeof(Bytes)) == 0; }
+	bool operator!=(const ShaderCacheDigest& other) const { return !(*this == other); }
+	struct Hash {
+		size_t operator()(const ShaderCacheDigest& d) const {
+			size_t h;
+			memcpy(&h, d.Bytes, sizeof(h));
+			return h;
+		}
+	};
+};
+
+/* one packed file <asm_platform>.ntpak, mapped once on open.
+ * record = RecordHeader(key, content_hash, size, checksum) + blob(16 bytes aligned).
+ * the index maps key to the newest record, the older records of the same key are garbage
+ * that Compact drops, least recently used records are dropped too when over the capacity. */
+class MIR_CORE_API ShaderCacheArchive : boost::noncopyable
+{
+public:
+	ShaderCacheArchive(const std::string& archivePath, size_t capacity);
+	~ShaderCacheArchive();
+
+	bool Read(const ShaderCacheDigest& key, const ShaderCacheDigest& contentHash, std::vector<char>& bin) ThreadSafe;
+	bool Append(const ShaderCacheDigest& key, const ShaderCacheDigest& contentHash, const char* bytes, size_t size) ThreadSafe;
+	void Compact() ThreadSafe;
+
+	size_t GetFileSize() const { return mFileSize; }
+	size_t GetLiveSize() const { return mLiveSize; }
+	size_t GetEntryCount() const { return mIndex.size(); }
+private:
+	bool Open();
+	void Close();
+	bool Remap();
+	void BuildIndex();
+	bool _Compact(size_t targetSize);
+private:
+	struct Entry {
+		ShaderCacheDigest ContentHash;
+		uint64_t Offset = 0;
+		uint32_t Size = 0;
+		mutable std::atomic<uint32_t> LastAccess{ 0 };
+	};
+	const std::string mPath;
+	const size_t mCapacity;
+	void* mFile = nullptr;
+	void* mMapping = nullptr;
+	const char* mView = nullptr;
+	size_t mViewSize = 0;
+	size_t mFileSize = 0, mLiveSize = 0;
+	std::atomic<uint32_t> mAccessTick{ 0 };
+	bool mCompacting = false;
+	std::unordered_map<ShaderCacheDigest, Entry, ShaderCacheDigest::Hash> mIndex;
+	mutable std::shared_mutex mMutex;
+};
+
+}
+}
@@ -0,0 +1,454 @@
+#include <cfloat>
+#include <climits>
+#include <cstring>
+#include <boost/assert.hpp>
+#include <boost/filesystem.hpp>
+#include <boost/algorithm/string.hpp>
+#include "core/base/macros.h"
+#include "core/resource/texture_compressor.h"
+
+namespace mir {
+namespace res {
+
+namespace {
+
+typedef uint8_t BlockPixels[16][4];
+
+void FetchBlock(const uint8_t* rgba, int width, int height, size_t pitch, int bx, int by, BlockPixels px)
+{
+	for (int y = 0; y < 4; ++y) {
+		const uint8_t* row = rgba + std::min(by * 4 + y, height - 1) * pitch;
+		for (int x = 0; x < 4; ++x)
+			memcpy(px[y * 4 + x], row + std::min(bx * 4 + x, width - 1) * 4, 4);
+	}
+}
+
+/* mean and principal axis of the first channels of the pixels, the axis by power iteration on the covariance.
+ * the iteration starts at the row of the largest variance, the column sums it could start at cancel out when the
+ * channels trade off against each other (a red to green edge). the axis is zero when the pixels are all the same */
+template<int Channels> void FitAxis(const BlockPixels px, float mean[Channels], float axis[Channels])
+{
+	for (int c = 0; c < Channels; ++c) {
+		mean[c] = 0.0f;
+		for (int i = 0; i < 16; ++i) mean[c] += px[i][c];
+		mean[c] /= 16.0f;
+	}
+
+	float cov[Channels][Channels] = {};
+	for (int i = 0; i < 16; ++i) {
+		float d[Channels];
+		for (int c = 0; c < Channels; ++c) d[c] = px[i][c] - mean[c];
+		for (int r = 0; r < Channels; ++r)
+			for (int c = 0; c < Channels; ++c)
+				cov[r][c] += d[r] * d[c];
+	}
+
+	int seed = 0;
+	for (int c = 1; c < Channels; ++c)
+		if (cov[c][c] > cov[seed][seed]) seed = c;
+	for (int c = 0; c < Channels; ++c)
+		axis[c] = cov[seed][c];
+	for (int iter = 0; iter < 8; ++iter) {
+		float next[Channels], scale = 0.0f;
+		for (int r = 0; r < Channels; ++r) {
+			next[r] = 0.0f;
+			for (int c = 0; c < Channels; ++c) next[r] += cov[r][c] * axis[c];
+			scale = std::max(scale, std::abs(next[r]));
+		}
+		if (scale < 1e-6f) break;
+		for (int c = 0; c < Channels; ++c) axis[c] = next[c] / scale;
+	}
+
+	float length = 0.0f;
+	for (int c = 0; c < Channels; ++c) length += axis[c] * axis[c];
+	length = std::sqrt(length);
+	for (int c = 0; c < Channels; ++c) axis[c] = length > 1e-6f ? axis[c] / length : 0.0f;
+}
+
+/* the extremes of the pixels projected on the axis, e0 the low one */
+template<int Channels> void FitEndpoints(const BlockPixels px, const float mean[Channels], const float axis[Channels], float e0[Channels], float e1[Channels])
+{
+	float lo = 0.0f, hi = 0.0f;
+	for (int i = 0; i < 16; ++i) {
+		float t = 0.0f;
+		for (int c = 0; c < Channels; ++c) t += (px[i][c] - mean[c]) * axis[c];
+		lo = std::min(lo, t);
+		hi = std::max(hi, t);
+	}
+	for (int c = 0; c < Channels; ++c) {
+		e0[c] = std::min(std::max(mean[c] + lo * axis[c], 0.0f), 255.0f);
+		e1[c] = std::min(std::max(mean[c] + hi * axis[c], 0.0f), 255.0f);
+	}
+}
+
+/* endpoints minimizing the squared error for the given weights of e1 per pixel, false when they don't tell */
+template<int Channels> bool SolveEndpoints(const BlockPixels px, const float weights[16], float e0[Channels], float e1[Channels])
+{
+	float aa = 0.0f, ab = 0.0f, bb = 0.0f;
+	float ap[Channels] = {}, bp[Channels] = {};
+	for (int i = 0; i < 16; ++i) {
+		float b = weights[i], a = 1.0f - b;
+		aa += a * a; ab += a * b; bb += b * b;
+		for (int c = 0; c < Channels; ++c) {
+			ap[c] += a * px[i][c];
+			bp[c] += b * px[i][c];
+		}
+	}
+	float det = aa * bb - ab * ab;
+	if (std::abs(det) < 1e-6f)
+		return false;
+
+	for (int c = 0; c < Channels; ++c) {
+		e0[c] = std::min(std::max((ap[c] * bb - bp[c] * ab) / det, 0.0f), 255.0f);
+		e1[c] = std::min(std::max((bp[c] * aa - ap[c] * ab) / det, 0.0f), 255.0f);
+	}
+	return true;
+}
+
+/********** BC1 color **********/
+uint16_t To565(const float c[3])
+{
+	int r = std::min(std::max(int(c[0] * 31.0f / 255.0f + 0.5f), 0), 31);
+	int g = std::min(std::max(int(c[1] * 63.0f / 255.0f + 0.5f), 0), 63);
+	int b = std::min(std::max(int(c[2] * 31.0f / 255.0f + 0.5f), 0), 31);
+	return uint16_t((r << 11) | (g << 5) | b);
+}
+void From565(uint16_t v, int c[3])
+{
+	int r = (v >> 11) & 31, g = (v >> 5) & 63, b = v & 31;
+	c[0] = (r << 3) | (r >> 2);
+	c[1] = (g << 2) | (g >> 4);
+	c[2] = (b << 3) | (b >> 2);
+}
+
+/* the four color palette of endpoints c0, c1: c0, c1, 2/3 c0 + 1/3 c1, 1/3 c0 + 2/3 c1. returns the squared error */
+int PickColorIndices(const BlockPixels px, uint16_t c0, uint16_t c1, uint32_t& indices)
+{
+	int palette[4][3];
+	From565(c0, palette[0]);
+	From565(c1, palette[1]);
+	for (int c = 0; c < 3; ++c) {
+		palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+		palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+	}
+
+	int error = 0;
+	indices = 0;
+	for (int i = 0; i < 16; ++i) {
+		int best = 0, bestDist = INT_MAX;
+		for (int j = 0; j < 4; ++j) {
+			int dr = px[i][0] - palette[j][0], dg = px[i][1] - palette[j][1], db = px[i][2] - palette[j][2];
+			int dist = dr * dr + dg * dg + db * db;
+			if (dist < bestDist) { best = j; bestDist = dist; }
+		}
+		indices |= uint32_t(best) << (2 * i);
+		error += bestDist;
+	}
+	return error;
+}
+
+void EncodeColorBlock(const BlockPixels px, uint8_t* dst)
+{
+	float mean[3], axis[3], e0[3], e1[3];
+	FitAxis<3>(px, mean, axis);
+	FitEndpoints<3>(px, mean, axis, e0, e1);
+	//pulled in by 1/16 of the range, the extremes are rarely worth an endpoint
+	for (int c = 0; c < 3; ++c) {
+		float inset = (e1[c] - e0[c]) / 16.0f;
+		e0[c] += inset;
+		e1[c] -= inset;
+	}
+
+	uint16_t c0 = To565(e1), c1 = To565(e0);
+	uint32_t indices;
+	int error = PickColorIndices(px, c0, c1, indices);
+	for (int iter = 0; iter < 2 && error > 0; ++iter) {
+		static const float kWeightByIndex[4] = { 0.0f, 1.0f, 1.0f / 3.0f, 2.0f / 3.0f };
+		float weights[16];
+		for (int i = 0; i < 16; ++i)
+			weights[i] = kWeightByIndex[(indices >> (2 * i)) & 3];
+		if (!SolveEndpoints<3>(px, weights, e1, e0))
+			break;
+
+		uint16_t n0 = To565(e1), n1 = To565(e0);
+		uint32_t nIndices;
+		int nError = PickColorIndices(px, n0, n1, nIndices);
+		if (nError >= error)
+			break;
+		c0 = n0; c1 = n1; indices = nIndices; error = nError;
+	}
+
+	//c0 > c1 selects the four color palette, swapping the endpoints swaps the indices 0 and 1, 2 and 3
+	if (c0 < c1) {
+		std::swap(c0, c1);
+		indices ^= 0x55555555;
+	}
+	else if (c0 == c1) {
+		indices = 0;
+	}
+	dst[0] = c0 & 0xff; dst[1] = c0 >> 8;
+	dst[2] = c1 & 0xff; dst[3] = c1 >> 8;
+	for (int i = 0; i < 4; ++i)
+		dst[4 + i] = (indices >> (8 * i)) & 0xff;
+}
+
+/********** BC4 channel **********/
+void EncodeChannelBlock(const BlockPixels px, int channel, uint8_t* dst)
+{
+	int lo = 255, hi = 0;
+	for (int i = 0; i < 16; ++i) {
+		lo = std::min<int>(lo, px[i][channel]);
+		hi = std::max<int>(hi, px[i][channel]);
+	}
+
+	//hi > lo selects the eight value palette: hi, lo, then 6 steps from hi to lo
+	uint64_t bits = 0;
+	if (hi > lo) {
+		int palette[8] = { hi, lo };
+		for (int j = 2; j < 8; ++j)
+			palette[j] = ((8 - j) * hi + (j - 1) * lo + 3) / 7;
+		for (int i = 0; i < 16; ++i) {
+			int best = 0, bestDist = INT_MAX;
+			for (int j = 0; j < 8; ++j) {
+				int dist = std::abs(px[i][channel] - palette[j]);
+				if (dist < bestDist) { best = j; bestDist = dist; }
+			}
+			bits |= uint64_t(best) << (3 * i);
+		}
+	}
+	dst[0] = uint8_t(hi);
+	dst[1] = uint8_t(lo);
+	for (int i = 0; i < 6; ++i)
+		dst[2 + i] = (bits >> (8 * i)) & 0xff;
+}
+
+/********** BC7 mode 6 **********/
+const int kBC7Weights[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+struct BC7Endpoint {
+	int Color[4];//7 bits
+	int PBit;
+	int Value(int c) const { return (Color[c] << 1) | PBit; }
+};
+
+/* the p-bit is shared by the channels, an opaque block keeps 1 so alpha stays 255 */
+BC7Endpoint QuantizeBC7(const float e[4], bool opaque)
+{
+	BC7Endpoint best = {};
+	float bestError = FLT_MAX;
+	for (int pbit = opaque ? 1 : 0; pbit < 2; ++pbit) {
+		BC7Endpoint q;
+		q.PBit = pbit;
+		float error = 0.0f;
+		for (int c = 0; c < 4; ++c) {
+			q.Color[c] = std::min(std::max(int((e[c] - pbit) / 2.0f + 0.5f), 0), 127);
+			float d = q.Value(c) - e[c];
+			error += d * d;
+		}
+		if (error < bestError) { best = q; bestError = error; }
+	}
+	return best;
+}
+
+int PickBC7Indices(const BlockPixels px, const BC7Endpoint& q0, const BC7Endpoint& q1, int indices[16])
+{
+	int palette[16][4];
+	for (int j = 0; j < 16; ++j)
+		for (int c = 0; c < 4; ++c)
+			palette[j][c] = ((64 - kBC7Weights[j]) * q0.Value(c) + kBC7Weights[j] * q1.Value(c) + 32) >> 6;
+
+	int error = 0;
+	for (int i = 0; i < 16; ++i) {
+		int best = 0, bestDist = INT_MAX;
+		for (int j = 0; j < 16; ++j) {
+			int dist = 0;
+			for (int c = 0; c < 4; ++c) {
+				int d = px[i][c] - palette[j][c];
+				dist += d * d;
+			}
+			if (dist < bestDist) { best = j; bestDist = dist; }
+		}
+		indices[i] = best;
+		error += bestDist;
+	}
+	return error;
+}
+
+struct BitWriter {
+	uint8_t* Dst;
+	int Pos = 0;
+	void Write(uint32_t value, int bits) {
+		for (int i = 0; i < bits; ++i, ++Pos)
+			if ((value >> i) & 1) Dst[Pos >> 3] |= uint8_t(1 << (Pos & 7));
+	}
+};
+
+void EncodeBC7Block(const BlockPixels px, uint8_t* dst)
+{
+	bool opaque = true;
+	for (int i = 0; i < 16 && opaque; ++i)
+		opaque = px[i][3] == 255;
+
+	float mean[4], axis[4], e0[4], e1[4];
+	FitAxis<4>(px, mean, axis);
+	FitEndpoints<4>(px, mean, axis, e0, e1);
+
+	BC7Endpoint q0 = QuantizeBC7(e0, opaque), q1 = QuantizeBC7(e1, opaque);
+	int indices[16];
+	int error = PickBC7Indices(px, q0, q1, indices);
+	for (int iter = 0; iter < 2 && error > 0; ++iter) {
+		float weights[16];
+		for (int i = 0; i < 16; ++i)
+			weights[i] = kBC7Weights[indices[i]] / 64.0f;
+		if (!SolveEndpoints<4>(px, weights, e0, e1))
+			break;
+
+		BC7Endpoint n0 = QuantizeBC7(e0, opaque), n1 = QuantizeBC7(e1, opaque);
+		int nIndices[16];
+		int nError = PickBC7Indices(px, n0, n1, nIndices);
+		if (nError >= error)
+			break;
+		q0 = n0; q1 = n1; error = nError;
+		memcpy(indices, nIndices, sizeof(indices));
+	}
+
+	//the first index is stored without its top bit, swapping the endpoints clears it
+	if (indices[0] & 8) {
+		std::swap(q0, q1);
+		for (int i = 0; i < 16; ++i)
+			indices[i] = 15 - indices[i];
+	}
+
+	memset(dst, 0, 16);
+	BitWriter writer{ dst };
+	writer.Write(1 << 6, 7);
+	for (int c = 0; c < 4; ++c) {
+		writer.Write(q0.Color[c], 7);
+		writer.Write(q1.Color[c], 7);
+	}
+	writer.Write(q0.PBit, 1);
+	writer.Write(q1.PBit, 1);
+	writer.Write(indices[0], 3);
+	for (int i = 1; i < 16; ++i)
+		writer.Write(indices[i], 4);
+}
+
+}
+
+bool TextureCompressor::IsSupported(ResourceFormat format)
+{
+	switch (format) {
+	case kFormatBC1UNorm:
+	case kFormatBC1UNormSRgb:
+	case kFormatBC3UNorm:
+	case kFormatBC3UNormSRgb:
+	case kFormatBC4UNorm:
+	case kFormatBC5UNorm:
+	case kFormatBC7UNorm:
+	case kFormatBC7UNormSRgb:
+		return true;
+	default:
+		return false;
+	}
+}
+
+ResourceFormat TextureCompressor::ParseFormat(const std::string& name)
+{
+	static const std::pair<const char*, ResourceFormat> kFormatByName[] = {
+		{ "BC1", kFormatBC1UNorm }, { "BC3", kFormatBC3UNorm }, { "BC4", kFormatBC4UNorm }, { "BC5", kFormatBC5UNorm }, { "BC7", kFormatBC7UNorm },
+		{ "Color", kFormatBC7UNorm }, { "Normal", kFormatBC5UNorm }, { "Data", kFormatBC1UNorm }, { "Mask", kFormatBC4UNorm },
+	};
+	for (const auto& it : kFormatByName)
+		if (boost::iequals(name, it.first))
+			return it.second;
+	return kFormatUnknown;
+}
+
+size_t TextureCompressor::GetBlockBytes(ResourceFormat format)
+{
+	switch (format) {
+	case kFormatBC1UNorm:
+	case kFormatBC1UNormSRgb:
+	case kFormatBC4UNorm:
+		return 8;
+	default:
+		return 16;
+	}
+}
+
+std::string TextureCompressor::MakeCachePath(const std::string& imagePath, ResourceFormat format, bool mipmap, const MipmapOptions& mipOptions)
+{
+	const char* name = "";
+	switch (format) {
+	case kFormatBC1UNorm: name = "bc1"; break;
+	case kFormatBC1UNormSRgb: name = "bc1s"; break;
+	case kFormatBC3UNorm: name = "bc3"; break;
+	case kFormatBC3UNormSRgb: name = "bc3s"; break;
+	case kFormatBC4UNorm: name = "bc4"; break;
+	case kFormatBC5UNorm: name = "bc5"; break;
+	case kFormatBC7UNorm: name = "bc7"; break;
+	case kFormatBC7UNormSRgb: name = "bc7s"; break;
+	default: BOOST_ASSERT(false); break;
+	}
+	if (!mipmap)
+		return imagePath + "." + name + ".dds";
+
+	std::string mip = mipOptions.Filter == kMipmapFilterBox ? "box" : "kaiser";
+	if (mipOptions.SRGB)
+		mip += "-s";
+	if (mipOptions.AlphaCutoff > 0.0f)
+		mip += "-a" + std::to_string(int(mipOptions.AlphaCutoff * 255 + 0.5f));
+	return imagePath + "." + name + ".mip-" + mip + ".dds";
+}
+
+bool TextureCompressor::IsCacheValid(const std::string& cachePath, const std::string& imagePath)
+{
+	boost::system::error_code ec;
+	if (!boost::filesystem::is_regular_file(cachePath, ec))
+		return false;
+
+	time_t cacheTime = boost::filesystem::last_write_time(cachePath, ec);
+	if (ec) return false;
+	time_t imageTime = boost::filesystem::last_write_time(imagePath, ec);
+	return !ec && cacheTime >= imageTime;
+}
+
+void TextureCompressor::EncodeBlockRows(ResourceFormat format, const uint8_t* rgba, int width, int height, size_t pitch, int firstRow, int lastRow, uint8_t* dst) ThreadSafe
+{
+	const int blocksPerRow = FLOOR_DIV(width, 4);
+	const size_t blockBytes = GetBlockBytes(format);
+	BlockPixels px;
+	for (int by = firstRow; by < lastRow; ++by) {
+		for (int bx = 0; bx < blocksPerRow; ++bx, dst += blockBytes) {
+			FetchBlock(rgba, width, height, pitch, bx, by, px);
+			switch (format) {
+			case kFormatBC1UNorm:
+			case kFormatBC1UNormSRgb:
+				EncodeColorBlock(px, dst);
+				break;
+			case kFormatBC3UNorm:
+			case kFormatBC3UNormSRgb:
+				EncodeChannelBlock(px, 3, dst);
+				EncodeColorBlock(px, dst + 8);
+				break;
+			case kFormatBC4UNorm:
+				EncodeChannelBlock(px, 0, dst);
+				break;
+			case kFormatBC5UNorm:
+				EncodeChannelBlock(px, 0, dst);
+				EncodeChannelBlock(px, 1, dst + 8);
+				break;
+			case kFormatBC7UNorm:
+			case kFormatBC7UNormSRgb:
+				EncodeBC7Block(px, dst);
+				break;
+			default:
+				BOOST_ASSERT(false);
+				break;
+			}
+		}
+	}
+}
+
+}
+}
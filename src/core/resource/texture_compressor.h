@@ -0,0 +1,39 @@
+#pragma once
+#include "core/mir_export.h"
+#include "core/base/stl.h"
+#include "core/base/declare_macros.h"
+#include "core/rendersys/base/res_format.h"
+#include "core/resource/mipmap_builder.h"
+
+namespace mir {
+namespace res {
+
+/* import time block compression of the images FreeImage reads, from 8 bit rgba pixels. BC1 fits the colors along
+ * their principal axis and refines the endpoints by least squares, BC4 takes the range of its channel, BC3 and BC5
+ * are built of those, BC7 only uses mode 6 (one subset, rgba endpoints with p-bits, 4 bit indices) fitted the BC1 way.
+ * the result is cached as a .dds next to its image, gli loads that one from then on.
+ * build/tools/texture_check round-trips the blocks a principal axis fit can lose. */
+class MIR_CORE_API TextureCompressor
+{
+public:
+	/* BC1, BC3, BC4, BC5 and BC7 */
+	static bool IsSupported(ResourceFormat format);
+	/* "BC1", "BC3", "BC4", "BC5", "BC7" or a usage: "Color" is BC7, "Normal" BC5 (the material unpacks it with
+	 * NORMAL_TEXTURE_PACKED), "Data" BC1 (packed occlusion, roughness, metallic), "Mask" BC4. kFormatUnknown otherwise, "None" too:
+	 * materials pick a format by the sampler's usage and take the name as an override */
+	static ResourceFormat ParseFormat(const std::string& name);
+	static size_t GetBlockBytes(ResourceFormat format);
+
+	/* <image>.<bcn>.dds, <image>.<bcn>.mip-<options>.dds when it has a mip chain: the filter (box or kaiser), s when
+	 * it is filtered in linear space and a<cutoff> when it keeps alpha coverage, so the caches built otherwise miss */
+	static std::string MakeCachePath(const std::string& imagePath, ResourceFormat format, bool mipmap, const MipmapOptions& mipOptions);
+	/* the cache exists and is not older than its image */
+	static bool IsCacheValid(const std::string& cachePath, const std::string& imagePath);
+
+	/* encodes the block rows [firstRow, lastRow) of a width x height image of pitch bytes per row, dst gets the blocks
+	 * of firstRow onwards. the blocks crossing the image edge repeat its last column and row */
+	static void EncodeBlockRows(ResourceFormat format, const uint8_t* rgba, int width, int height, size_t pitch, int firstRow, int lastRow, uint8_t* dst) ThreadSafe;
+};
+
+}
+}
@@ -7,6 +7,8 @@
 #include "core/base/macros.h"
 #include "core/base/debug.h"
 #include "core/resource/texture_factory.h"
+#include "core/resource/texture_streamer.h"
+#include "core/resource/texture_compressor.h"
 #include "core/resource/resource_manager.h"
 
 namespace mir {
@@ -57,10 +59,10 @@ static BOOL SwapRedBlue32(FIBITMAP* dib)
 
 	return TRUE;
 }
-CoTask<bool> TextureFactory::_LoadTextureByFile(ITexturePtr texture, Launch lchMode, std::string imgFullPath, ResourceFormat format, bool autoGenMipmap) ThreadSafe ThreadMaySwitch
+CoTask<bool> TextureFactory::_LoadTextureByFile(ITexturePtr texture, Launch lchMode, std::string imgFullPath, ResourceFormat format, bool autoGenMipmap, MipmapOptions mipOptions) ThreadSafe ThreadMaySwitch
 {
 	texture->SetLoading(); CoAwait mResMng.SwitchToLaunchService(lchMode);
-	COROUTINE_VARIABLES_5(texture, lchMode, imgFullPath, format, autoGenMipmap);
+	COROUTINE_VARIABLES_6(texture, lchMode, imgFullPath, format, autoGenMipmap, mipOptions);
 	DEBUG_LOG_CALLSTK("texFac._LoadTextureByFile");
 	TIME_PROFILE((boost::format("\t\tresMng._LoadTextureByFile (%1% %2% %3%)") %imgFullPath %format %autoGenMipmap).str());
 
@@ -72,7 +74,29 @@ CoTask<bool> TextureFactory::_LoadTextureByFile(ITexturePtr texture, Launch lchM
 
 	boost::filesystem::path path = imgFullPath;
 	static std::string gliPatterns[] = { ".dds", ".ktx", ".ktx2" };
-	if (std::find(std::begin(gliPatterns), std::end(gliPatterns), path.extension()) != std::end(gliPatterns)) 
+	auto isGliPath = [](const boost::filesystem::path& path) {
+		return std::find(std::begin(gliPatterns), std::end(gliPatterns), path.extension()) != std::end(gliPatterns);
+	};
+
+	//a block format asks FreeImage images to be compressed, once: the result is cached next to the image
+	ResourceFormat compressFormat = kFormatUnknown;
+	std::string cachePath;
+	if (TextureCompressor::IsSupported(format)) {
+		if (!isGliPath(path)) {
+			cachePath = TextureCompressor::MakeCachePath(imgFullPath, format, autoGenMipmap, mipOptions);
+			if (TextureCompressor::IsCacheValid(cachePath, imgFullPath)) {
+				path = cachePath;
+				imgFullPath = cachePath;
+				autoGenMipmap = false;
+			}
+			else {
+				compressFormat = format;
+			}
+		}
+		format = kFormatUnknown;
+	}
+
+	if (isGliPath(path)) 
 	{
 		gli::texture tex = gli::load(imgFullPath);
 		if (!tex.empty())
@@ -87,18 +111,9 @@ CoTask<bool> TextureFactory::_LoadTextureByFile(ITexturePtr texture, Launch lchM
 			width = extent.x;
 			height = extent.y;
 
-			constexpr int layer0 = 0;
-			auto block_ext = gli::block_extent(tex.format());
-			auto block_size = gli::block_size(tex.format());
-			BOOST_ASSERT(block_size % block_ext.y == 0);
-			for (int face = 0; face < faceCount; ++face) {
-				for (int level = 0; level < mipCount; ++level) {
-					auto extent = tex.extent(level);
-					BOOST_ASSERT(tex.size(level) == block_size * FLOOR_DIV(extent.x, block_ext.x) * FLOOR_DIV(extent.y, block_ext.y));
-					int pitch = block_size * FLOOR_DIV(extent.x, block_ext.x);
-					vecData.push_back(Data2::Make(tex.data(layer0, face, level), pitch * FLOOR_DIV(extent.y, block_ext.y), pitch));
-				}
-			}
+			//a streaming texture starts with its mip tail, the top mips stream in once it's drawn
+			const int firstLevel = mResMng.GetTexStreamer().GetTailLevel(width, height, faceCount, mipCount);
+			TextureStreamer::CollectLevels(tex, firstLevel, vecData);
 
 			if (format == kFormatUnknown) {
 				ResourceBaseFormat baseFormat = kRBF_Unkown;
@@ -120,6 +135,10 @@ CoTask<bool> TextureFactory::_LoadTextureByFile(ITexturePtr texture, Launch lchM
 					case gli::gl::INTERNAL_SRGB_ALPHA_DXT1: format = kFormatBC1UNormSRgb; break;
 					case gli::gl::INTERNAL_SRGB_ALPHA_DXT3: format = kFormatBC2UNormSRgb; break;
 					case gli::gl::INTERNAL_SRGB_ALPHA_DXT5: format = kFormatBC3UNormSRgb; break;
+					case gli::gl::INTERNAL_R_ATI1N_UNORM: format = kFormatBC4UNorm; break;
+					case gli::gl::INTERNAL_RG_ATI2N_UNORM: format = kFormatBC5UNorm; break;
+					case gli::gl::INTERNAL_RGB_BP_UNORM: format = kFormatBC7UNorm; break;
+					case gli::gl::INTERNAL_SRGB_BP_UNORM: format = kFormatBC7UNormSRgb; break;
 					default:
 						BOOST_ASSERT(FALSE);
 						break;
@@ -197,7 +216,10 @@ CoTask<bool> TextureFactory::_LoadTextureByFile(ITexturePtr texture, Launch lchM
 				mipCount = -1;
 
 			CoAwait mResMng.SwitchToLaunchService(__LaunchSync__);
-			texture->SetLoaded(mRenderSys.LoadTexture(texture, format, Eigen::Vector4i(width, height, 0, faceCount), mipCount, &vecData[0]) != nullptr);
+			auto firstExtent = tex.extent(firstLevel);
+			texture->SetLoaded(mRenderSys.LoadTexture(texture, format, Eigen::Vector4i(firstExtent.x, firstExtent.y, 0, faceCount), mipCount - firstLevel, &vecData[0]) != nullptr);
+			if (firstLevel > 0 && texture->IsLoaded())
+				mResMng.GetTexStreamer().Register(texture, imgFullPath, format, tex, firstLevel);
 		}
 		BOOST_ASSERT(!tex.empty());
 	}
@@ -207,7 +229,16 @@ CoTask<bool> TextureFactory::_LoadTextureByFile(ITexturePtr texture, Launch lchM
 		const bool isPngJpgOrBmp = std::find(std::begin(flipExts), std::end(flipExts), path.extension()) != std::end(flipExts);
 
 		fipImage fi;
-		if (fi.load(imgFullPath.c_str()))
+		if (compressFormat != kFormatUnknown && fi.load(imgFullPath.c_str()) && fi.getImageType() == FIT_BITMAP && fi.convertTo32Bits())
+		{
+		#if !defined FREEIMAGE_BIGENDIAN
+			SwapRedBlue32(fi);
+		#endif
+			if (isPngJpgOrBmp)
+				fi.flipVertical();
+			CoAwait _CompressImage(texture, cachePath, compressFormat, fi.accessPixels(), fi.getWidth(), fi.getHeight(), fi.getScanWidth(), autoGenMipmap, mipOptions);
+		}
+		else if (fi.isValid() || fi.load(imgFullPath.c_str()))
 		{
 			if (format == kFormatUnknown)
 			{
@@ -272,6 +303,18 @@ CoTask<bool> TextureFactory::_LoadTextureByFile(ITexturePtr texture, Launch lchM
 			faceCount = 1;
 			mipCount = 1;
 
+			//8 bit images get their mip chain here and load it in one go, the float ones have the gpu generate it
+			std::vector<std::vector<uint8_t>> levelImages;
+			const int channels = fi.getBitsPerPixel() / 8;
+			if (autoGenMipmap && fi.getImageType() == FIT_BITMAP && (channels == 1 || channels == 4)) {
+				CoAwait _BuildMipmaps(fi.accessPixels(), width, height, stride, channels, mipOptions, &levelImages);
+				for (size_t level = 1; level < levelImages.size(); ++level) {
+					size_t levelPitch = MipmapBuilder::GetPitch(std::max(width >> level, 1), channels);
+					vecData.push_back(Data2::Make(&levelImages[level][0], levelImages[level].size(), levelPitch));
+				}
+				mipCount = levelImages.size();
+			}
+
 			if (mipCount == 1 && autoGenMipmap)
 				mipCount = -1;
 
@@ -285,10 +328,118 @@ CoTask<bool> TextureFactory::_LoadTextureByFile(ITexturePtr texture, Launch lchM
 	CoReturn texture->IsLoaded();
 }
 
-CoTask<bool> TextureFactory::CreateTextureByFile(ITexturePtr& texture, Launch lchMode, std::string filepath, ResourceFormat format, bool autoGenMipmap) ThreadSafe ThreadMaySwitch
+static gli::format ToGliBlockFormat(ResourceFormat format)
+{
+	switch (format) {
+	case kFormatBC1UNorm: return gli::FORMAT_RGBA_DXT1_UNORM_BLOCK8;
+	case kFormatBC1UNormSRgb: return gli::FORMAT_RGBA_DXT1_SRGB_BLOCK8;
+	case kFormatBC3UNorm: return gli::FORMAT_RGBA_DXT5_UNORM_BLOCK16;
+	case kFormatBC3UNormSRgb: return gli::FORMAT_RGBA_DXT5_SRGB_BLOCK16;
+	case kFormatBC4UNorm: return gli::FORMAT_R_ATI1N_UNORM_BLOCK8;
+	case kFormatBC5UNorm: return gli::FORMAT_RG_ATI2N_UNORM_BLOCK16;
+	case kFormatBC7UNorm: return gli::FORMAT_RGBA_BP_UNORM_BLOCK16;
+	case kFormatBC7UNormSRgb: return gli::FORMAT_RGBA_BP_SRGB_BLOCK16;
+	default: BOOST_ASSERT(false); return gli::FORMAT_UNDEFINED;
+	}
+}
+CoTask<bool> TextureFactory::_BuildMipmaps(const uint8_t* image, int width, int height, size_t pitch, int channels, MipmapOptions mipOptions, std::vector<std::vector<uint8_t>>* levels) ThreadSafe ThreadMaySwitch
+{
+	DEBUG_LOG_CALLSTK("texFac._BuildMipmaps");
+	TIME_PROFILE((boost::format("\t\ttexFac._BuildMipmaps (%1%x%2% %3% filter:%4% srgb:%5%)") %width %height %channels %mipOptions.Filter %mipOptions.SRGB).str());
+
+	constexpr int CTaskPixelCount = 64 * 1024;
+	levels->assign(MipmapBuilder::GetLevelCount(width, height), std::vector<uint8_t>());
+	const uint8_t* src = image;
+	int srcWidth = width, srcHeight = height;
+	size_t srcPitch = pitch;
+	for (size_t level = 1; level < levels->size(); ++level) {
+		int dstWidth = std::max(srcWidth / 2, 1), dstHeight = std::max(srcHeight / 2, 1);
+		size_t dstPitch = MipmapBuilder::GetPitch(dstWidth, channels);
+		auto& dst = (*levels)[level];
+		dst.resize(dstPitch * dstHeight);
+
+		std::vector<CoTask<bool>> tasks;
+		int rowsPerTask = std::max(CTaskPixelCount / dstWidth, 1);
+		for (int row = 0; row < dstHeight; row += rowsPerTask) {
+			tasks.push_back([](ResourceManager& resMng, MipmapOptions options, int channels, const uint8_t* src, int width, int height, size_t pitch, int firstRow, int lastRow, uint8_t* dst)->CoTask<bool> {
+				CoAwait resMng.ScheduleOnThreadPool();
+				MipmapBuilder::DownsampleRows(options, channels, src, width, height, pitch, firstRow, lastRow, dst);
+				CoReturn true;
+			}(mResMng, mipOptions, channels, src, srcWidth, srcHeight, srcPitch, row, std::min(row + rowsPerTask, dstHeight), &dst[row * dstPitch]));
+		}
+		CoAwait WhenAll(std::move(tasks));
+
+		src = &dst[0];
+		srcWidth = dstWidth;
+		srcHeight = dstHeight;
+		srcPitch = dstPitch;
+	}
+
+	//cutout textures keep the coverage of the top level, every level scaled on its own as the chain was filtered unscaled
+	if (mipOptions.AlphaCutoff > 0 && channels == 4 && levels->size() > 1) {
+		const float coverage = MipmapBuilder::GetAlphaCoverage(image, width, height, pitch, mipOptions.AlphaCutoff);
+		std::vector<CoTask<bool>> tasks;
+		for (size_t level = 1; level < levels->size(); ++level) {
+			int levelWidth = std::max(width >> level, 1), levelHeight = std::max(height >> level, 1);
+			tasks.push_back([](ResourceManager& resMng, uint8_t* rgba, int width, int height, float cutoff, float coverage)->CoTask<bool> {
+				CoAwait resMng.ScheduleOnThreadPool();
+				MipmapBuilder::ScaleAlphaToCoverage(rgba, width, height, MipmapBuilder::GetPitch(width, 4), cutoff, coverage);
+				CoReturn true;
+			}(mResMng, &(*levels)[level][0], levelWidth, levelHeight, mipOptions.AlphaCutoff, coverage));
+		}
+		CoAwait WhenAll(std::move(tasks));
+	}
+	CoReturn true;
+}
+
+CoTask<bool> TextureFactory::_CompressImage(ITexturePtr texture, std::string cachePath, ResourceFormat format, const uint8_t* rgba, int width, int height, size_t pitch, bool mipmap, MipmapOptions mipOptions) ThreadSafe ThreadMaySwitch
+{
+	COROUTINE_VARIABLES_5(texture, cachePath, format, mipmap, mipOptions);
+	DEBUG_LOG_CALLSTK("texFac._CompressImage");
+	TIME_PROFILE((boost::format("\t\ttexFac._CompressImage (%1% %2% %3%x%4%)") %cachePath %format %width %height).str());
+
+	gli::texture2d tex(ToGliBlockFormat(format), gli::extent2d(width, height), mipmap ? gli::levels(gli::extent2d(width, height)) : 1);
+	std::vector<std::vector<uint8_t>> levelImages;
+	if (mipmap) {
+		CoAwait _BuildMipmaps(rgba, width, height, pitch, 4, mipOptions, &levelImages);
+		BOOST_ASSERT(levelImages.size() == tex.levels());
+	}
+
+	//the block rows of every level are split over the thread pool
+	constexpr int CTaskBlockCount = 4096;
+	const size_t blockBytes = TextureCompressor::GetBlockBytes(format);
+	std::vector<CoTask<bool>> tasks;
+	for (size_t level = 0; level < tex.levels(); ++level) {
+		auto extent = tex.extent(level);
+		const uint8_t* levelRgba = level ? &levelImages[level][0] : rgba;
+		size_t levelPitch = level ? extent.x * 4 : pitch;
+		int blocksPerRow = FLOOR_DIV(extent.x, 4), blockRows = FLOOR_DIV(extent.y, 4);
+		int rowsPerTask = std::max(CTaskBlockCount / blocksPerRow, 1);
+		for (int row = 0; row < blockRows; row += rowsPerTask) {
+			uint8_t* dst = static_cast<uint8_t*>(tex.data(0, 0, level)) + row * blocksPerRow * blockBytes;
+			tasks.push_back([](ResourceManager& resMng, ResourceFormat format, const uint8_t* rgba, int width, int height, size_t pitch, int firstRow, int lastRow, uint8_t* dst)->CoTask<bool> {
+				CoAwait resMng.ScheduleOnThreadPool();
+				TextureCompressor::EncodeBlockRows(format, rgba, width, height, pitch, firstRow, lastRow, dst);
+				CoReturn true;
+			}(mResMng, format, levelRgba, extent.x, extent.y, levelPitch, row, std::min(row + rowsPerTask, blockRows), dst));
+		}
+	}
+	CoAwait WhenAll(std::move(tasks));
+
+	if (!gli::save_dds(tex, cachePath))
+		DEBUG_LOG_ERROR((boost::format("texFac._CompressImage save %1% failed") %cachePath).str());
+
+	std::vector<Data2> vecData;
+	TextureStreamer::CollectLevels(tex, 0, vecData);
+	CoAwait mResMng.SwitchToLaunchService(__LaunchSync__);
+	texture->SetLoaded(mRenderSys.LoadTexture(texture, format, Eigen::Vector4i(width, height, 0, 1), tex.levels(), &vecData[0]) != nullptr);
+	CoReturn texture->IsLoaded();
+}
+
+CoTask<bool> TextureFactory::CreateTextureByFile(ITexturePtr& texture, Launch lchMode, std::string filepath, ResourceFormat format, bool autoGenMipmap, MipmapOptions mipOptions) ThreadSafe ThreadMaySwitch
 {
 	DEBUG_LOG_CALLSTK("texFac.CreateTextureByFile");
-	COROUTINE_VARIABLES_4(lchMode, filepath, format, autoGenMipmap);
+	COROUTINE_VARIABLES_5(lchMode, filepath, format, autoGenMipmap, mipOptions);
 
 	boost::filesystem::path fullpath = boost::filesystem::system_complete(filepath);
 	std::string key = fullpath.string();
@@ -302,7 +453,7 @@ CoTask<bool> TextureFactory::CreateTextureByFile(ITexturePtr& texture, Launch lc
 		return texture;
 		});
 	if (resNeedLoad) {
-		CoAwait this->_LoadTextureByFile(texture, lchMode, std::move(key), format, autoGenMipmap);
+		CoAwait this->_LoadTextureByFile(texture, lchMode, std::move(key), format, autoGenMipmap, mipOptions);
 	}
 	else {
 		CoAwait mResMng.WaitResComplete(texture);
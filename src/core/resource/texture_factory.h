@@ -9,6 +9,7 @@
 #include "core/base/declare_macros.h"
 #include "core/rendersys/predeclare.h"
 #include "core/resource/predeclare.h"
+#include "core/resource/mipmap_builder.h"
 #include "core/rendersys/texture.h"
 
 namespace mir {
@@ -22,11 +23,16 @@ public:
 	~TextureFactory();
 
 	CoTask<bool> CreateTextureByData(ITexturePtr& texture, Launch lchMode, ResourceFormat format, Eigen::Vector4i w_h_mip_face, const Data2 datas[]) ThreadSafe ThreadMaySwitch;
-	CoTask<bool> CreateTextureByFile(ITexturePtr& texture, Launch lchMode, std::string filepath, ResourceFormat format = kFormatUnknown, bool autoGenMipmap = false) ThreadSafe ThreadMaySwitch;
+	CoTask<bool> CreateTextureByFile(ITexturePtr& texture, Launch lchMode, std::string filepath, ResourceFormat format = kFormatUnknown, bool autoGenMipmap = false, MipmapOptions mipOptions = MipmapOptions()) ThreadSafe ThreadMaySwitch;
 	DECLARE_COTASK_FUNCTIONS(ITexturePtr, CreateTextureByData, ThreadSafe ThreadMaySwitch);
 	DECLARE_COTASK_FUNCTIONS(ITexturePtr, CreateTextureByFile, ThreadSafe ThreadMaySwitch);
 private:
-	CoTask<bool> _LoadTextureByFile(ITexturePtr texture, Launch lchMode, std::string filepath, ResourceFormat format, bool autoGenMipmap) ThreadSafe ThreadMaySwitch;
+	CoTask<bool> _LoadTextureByFile(ITexturePtr texture, Launch lchMode, std::string filepath, ResourceFormat format, bool autoGenMipmap, MipmapOptions mipOptions) ThreadSafe ThreadMaySwitch;
+	/* BCn compression of an rgba8 image with its mips, saved to cachePath then loaded into texture */
+	CoTask<bool> _CompressImage(ITexturePtr texture, std::string cachePath, ResourceFormat format, const uint8_t* rgba, int width, int height, size_t pitch, bool mipmap, MipmapOptions mipOptions) ThreadSafe ThreadMaySwitch;
+	/* the levels below an 8 bit image of 1 or 4 channels into levels, levels[0] stays empty. the rows of a level are
+	 * filtered in parallel on the thread pool, the levels one after another */
+	CoTask<bool> _BuildMipmaps(const uint8_t* image, int width, int height, size_t pitch, int channels, MipmapOptions mipOptions, std::vector<std::vector<uint8_t>>* levels) ThreadSafe ThreadMaySwitch;
 private:
 	ResourceManager& mResMng;
 	RenderSystem& mRenderSys;
@@ -0,0 +1,244 @@
+#include <boost/assert.hpp>
+#include <boost/format.hpp>
+#include <gli/gli.hpp>
+#include "core/base/macros.h"
+#include "core/base/debug.h"
+#include "core/rendersys/render_system.h"
+#include "core/rendersys/texture.h"
+#include "core/resource/texture_streamer.h"
+#include "core/resource/resource_manager.h"
+
+namespace mir {
+namespace res {
+
+TextureStreamer::TextureStreamer(ResourceManager& resMng)
+: mResMng(resMng)
+, mRenderSys(resMng.RenderSys())
+{
+}
+TextureStreamer::~TextureStreamer()
+{
+	DEBUG_LOG_MEMLEAK("texStreamer.destrcutor");
+	BOOST_ASSERT(mDisposed);
+}
+void TextureStreamer::Dispose(cppcoro::io_service& ioService)
+{
+	if (!mDisposed) {
+		DEBUG_LOG_MEMLEAK("texStreamer.Dispose");
+		mDisposed = true;
+	#if !defined MIR_CPPCORO_DISABLED
+		coroutine::ExecuteTaskSync(ioService, [](cppcoro::async_scope& scope)->CoTask<void> {
+			CoAwait scope.join();
+		}(mScope));
+	#endif
+		mEntries.clear();
+		mResidentBytes = 0;
+	}
+}
+
+void TextureStreamer::CollectLevels(const gli::texture& tex, int firstLevel, std::vector<Data2>& datas)
+{
+	constexpr int layer0 = 0;
+	auto block_ext = gli::block_extent(tex.format());
+	auto block_size = gli::block_size(tex.format());
+	BOOST_ASSERT(block_size % block_ext.y == 0);
+	const int faceCount = tex.faces(), mipCount = tex.levels();
+	for (int face = 0; face < faceCount; ++face) {
+		for (int level = firstLevel; level < mipCount; ++level) {
+			auto extent = tex.extent(level);
+			BOOST_ASSERT(tex.size(level) == block_size * FLOOR_DIV(extent.x, block_ext.x) * FLOOR_DIV(extent.y, block_ext.y));
+			int pitch = block_size * FLOOR_DIV(extent.x, block_ext.x);
+			datas.push_back(Data2::Make(tex.data(layer0, face, level), pitch * FLOOR_DIV(extent.y, block_ext.y), pitch));
+		}
+	}
+}
+
+int TextureStreamer::GetTailLevel(int width, int height, int faceCount, int mipCount) const
+{
+#if defined MIR_CPPCORO_DISABLED
+	//without coroutines nothing streams the top mips in later, every texture loads whole
+	return 0;
+#else
+	//cube maps are sampled at explicit lods by the ibl passes, they stay whole
+	if (!mEnabled || mDisposed || faceCount != 1)
+		return 0;
+
+	int level = 0;
+	while (std::max(width >> level, height >> level) > kTailSize)
+		++level;
+	return level < mipCount ? level : 0;
+#endif
+}
+
+void TextureStreamer::Register(const ITexturePtr& texture, const std::string& path, ResourceFormat format, const gli::texture& tex, int residentLevel)
+{
+	BOOST_ASSERT(texture && residentLevel > 0 && residentLevel < tex.levels());
+	auto iter = mEntries.find(texture.get());
+	if (iter != mEntries.end())
+		mResidentBytes -= iter->second->BytesFrom[iter->second->ResidentLevel];
+
+	EntryPtr entry = CreateInstance<Entry>();
+	entry->Texture = texture;
+	entry->Path = path;
+	entry->Format = format;
+	entry->MipCount = tex.levels();
+	entry->TailLevel = entry->ResidentLevel = residentLevel;
+	entry->BytesFrom.assign(entry->MipCount + 1, 0);
+	for (int level = entry->MipCount - 1; level >= 0; --level)
+		entry->BytesFrom[level] = entry->BytesFrom[level + 1] + tex.size(level) * tex.faces();
+	mResidentBytes += entry->BytesFrom[residentLevel];
+	mEntries[texture.get()] = entry;
+}
+
+void TextureStreamer::Touch(const ITexturePtr textures[], size_t count)
+{
+	if (mEntries.empty())
+		return;
+
+	for (size_t i = 0; i < count; ++i) {
+		if (textures[i] == nullptr) continue;
+		auto iter = mEntries.find(textures[i].get());
+		if (iter != mEntries.end())
+			iter->second->LastUsedFrame = mFrame;
+	}
+}
+
+void TextureStreamer::Exclude(const ITexturePtr& texture)
+{
+	auto iter = mEntries.find(texture.get());
+	if (iter != mEntries.end())
+		iter->second->Excluded = true;
+}
+
+void TextureStreamer::SetPriority(const ITexturePtr& texture, float priority)
+{
+	auto iter = mEntries.find(texture.get());
+	if (iter != mEntries.end())
+		iter->second->Priority = priority;
+}
+
+void TextureStreamer::UpdateFrame()
+{
+	++mFrame;
+
+	size_t demand = 0;
+	std::vector<EntryPtr> wanted, idle;
+	for (auto iter = mEntries.begin(); iter != mEntries.end(); ) {
+		const EntryPtr& entry = iter->second;
+		if (entry->Texture.expired()) {
+			mResidentBytes -= entry->BytesFrom[entry->ResidentLevel];
+			iter = mEntries.erase(iter);
+			continue;
+		}
+
+		if (entry->Excluded)
+			entry->LastUsedFrame = mFrame;
+		if (!entry->Streaming && !entry->Failed) {
+			if (entry->LastUsedFrame != 0 && entry->LastUsedFrame + kIdleFrames > mFrame) {
+				if (entry->ResidentLevel > 0) {
+					wanted.push_back(entry);
+					demand += entry->BytesFrom[0] - entry->BytesFrom[entry->ResidentLevel];
+				}
+			}
+			else if (entry->ResidentLevel < entry->TailLevel) {
+				idle.push_back(entry);
+			}
+		}
+		++iter;
+	}
+	if (mDisposed)
+		return;
+
+	//room for what is wanted comes from the top mips of the least recently used, a few levels at a time
+	std::sort(idle.begin(), idle.end(), [](const EntryPtr& l, const EntryPtr& r) {
+		return l->LastUsedFrame < r->LastUsedFrame;
+	});
+	for (const auto& entry : idle) {
+		if (mResidentBytes + demand <= mBudget)
+			break;
+
+		size_t over = mResidentBytes + demand - mBudget;
+		int level = entry->ResidentLevel + 1;
+		while (level < entry->TailLevel && entry->BytesFrom[entry->ResidentLevel] - entry->BytesFrom[level] < over)
+			++level;
+		DropLevels(entry, level);
+	}
+
+	std::sort(wanted.begin(), wanted.end(), [](const EntryPtr& l, const EntryPtr& r) {
+		if (l->Priority != r->Priority) return l->Priority > r->Priority;
+		return l->LastUsedFrame > r->LastUsedFrame;
+	});
+	for (const auto& entry : wanted) {
+		if (mStreamCount >= kMaxStreams)
+			break;
+
+		//the finest level the budget has room for
+		int level = 0;
+		while (level < entry->ResidentLevel && mResidentBytes + entry->BytesFrom[level] - entry->BytesFrom[entry->ResidentLevel] > mBudget)
+			++level;
+		if (level < entry->ResidentLevel)
+			Stream(entry, level);
+	}
+}
+
+void TextureStreamer::Stream(const EntryPtr& entry, int level)
+{
+#if !defined MIR_CPPCORO_DISABLED
+	//the budget counts the new levels from now on, a failed stream gives them back
+	int oldLevel = entry->ResidentLevel;
+	mResidentBytes = mResidentBytes - entry->BytesFrom[oldLevel] + entry->BytesFrom[level];
+	entry->ResidentLevel = level;
+	entry->Streaming = true;
+	++mStreamCount;
+	mScope.spawn(StreamLevels(entry, oldLevel));
+#else
+	BOOST_ASSERT(false);//GetTailLevel registers no entry to stream
+#endif
+}
+
+void TextureStreamer::DropLevels(const EntryPtr& entry, int level)
+{
+	//the levels kept are already on the gpu, no file read
+	ITexturePtr texture = entry->Texture.lock();
+	if (texture && mRenderSys.DropTextureMips(texture, level - entry->ResidentLevel)) {
+		mResidentBytes = mResidentBytes - entry->BytesFrom[entry->ResidentLevel] + entry->BytesFrom[level];
+		entry->ResidentLevel = level;
+	}
+	else {
+		entry->Failed = true;
+	}
+}
+
+CoTask<void> TextureStreamer::StreamLevels(EntryPtr entry, int oldLevel)
+{
+	const int level = entry->ResidentLevel;
+	CoAwait mResMng.SwitchToLaunchService(LaunchAsync);
+	DEBUG_LOG_CALLSTK("texStreamer.StreamLevels");
+	TIME_PROFILE((boost::format("\t\ttexStreamer.StreamLevels (%1% %2%->%3%)") %entry->Path %oldLevel %level).str());
+
+	std::vector<Data2> vecData;
+	gli::texture tex = gli::load(entry->Path);
+	bool loaded = !tex.empty() && tex.faces() == 1 && tex.levels() == entry->MipCount;
+	if (loaded)
+		CollectLevels(tex, level, vecData);
+
+	CoAwait mResMng.SwitchToLaunchService(__LaunchSync__);
+	ITexturePtr texture = entry->Texture.lock();
+	auto iter = mEntries.find(texture.get());
+	if (texture && !mDisposed && iter != mEntries.end() && iter->second == entry) {
+		if (loaded) {
+			auto extent = tex.extent(level);
+			loaded = mRenderSys.LoadTexture(texture, entry->Format, Eigen::Vector4i(extent.x, extent.y, 0, 1), entry->MipCount - level, &vecData[0]) != nullptr;
+		}
+		if (!loaded) {
+			mResidentBytes = mResidentBytes - entry->BytesFrom[level] + entry->BytesFrom[oldLevel];
+			entry->ResidentLevel = oldLevel;
+			entry->Failed = true;
+		}
+	}
+	entry->Streaming = false;
+	--mStreamCount;
+}
+
+}
+}
@@ -0,0 +1,91 @@
+#pragma once
+#include <boost/noncopyable.hpp>
+#include "core/mir_export.h"
+#include "core/base/stl.h"
+#include "core/base/math.h"
+#include "core/base/cppcoro.h"
+#include "core/base/data.h"
+#include "core/base/declare_macros.h"
+#include "core/rendersys/predeclare.h"
+#include "core/resource/predeclare.h"
+#include "core/rendersys/base/res_format.h"
+
+#if !defined MIR_CPPCORO_DISABLED
+#include <cppcoro/async_scope.hpp>
+#endif
+
+namespace gli { class texture; }
+
+namespace mir {
+namespace res {
+
+/* mip streaming of the 2d textures read from dds/ktx files with a full mip chain. such a texture is created with
+ * its mip tail only (the levels up to kTailSize texels), so the materials using it are ready at once.
+ * the draws binding a texture as a material texture Touch it; UpdateFrame streams the whole chain of the recently
+ * touched ones in on the thread pool, by priority then recency, and while the resident total is over the budget it
+ * drops the top mips of the least recently used ones, copying the levels kept on the gpu. a texture bound any other
+ * way is never touched, its holder Excludes it. a level change re-creates the device texture in place, holders keep
+ * their pointer. all of it runs on the main thread but the file reads */
+class MIR_CORE_API TextureStreamer : boost::noncopyable
+{
+public:
+	enum {
+		kTailSize = 64,
+		kMaxStreams = 4,//streams in flight
+		kIdleFrames = 120,//untouched for this long a texture may lose its top mips
+	};
+	TextureStreamer(ResourceManager& resMng);
+	~TextureStreamer();
+	/* waits the streams in flight, pumping the io service they return to the main thread through */
+	void Dispose(cppcoro::io_service& ioService);
+
+	/* the data of the levels [firstLevel, levels) of every face, face major as RenderSystem::LoadTexture takes them */
+	static void CollectLevels(const gli::texture& tex, int firstLevel, std::vector<Data2>& datas);
+	/* the first level a texture loads with when it streams, 0 when it doesn't */
+	int GetTailLevel(int width, int height, int faceCount, int mipCount) const;
+	/* texture was just loaded with the levels [residentLevel, levels) of tex */
+	void Register(const ITexturePtr& texture, const std::string& path, ResourceFormat format, const gli::texture& tex, int residentLevel);
+
+	void Touch(const ITexturePtr textures[], size_t count);
+	/* the texture streams its whole chain in and keeps it, as if touched every frame */
+	void Exclude(const ITexturePtr& texture);
+	/* higher streams in first, 0 by default */
+	void SetPriority(const ITexturePtr& texture, float priority);
+	void UpdateFrame();
+
+	void SetEnabled(bool enable) { mEnabled = enable; }
+	bool IsEnabled() const { return mEnabled; }
+	void SetBudget(size_t bytes) { mBudget = bytes; }
+	size_t GetBudget() const { return mBudget; }
+	/* the bytes of the streamed textures, counting the levels of the streams in flight */
+	size_t GetResidentBytes() const { return mResidentBytes; }
+	size_t StreamingCount() const { return mStreamCount; }
+private:
+	struct Entry {
+		std::weak_ptr<ITexture> Texture;
+		std::string Path;
+		ResourceFormat Format;
+		int MipCount, TailLevel, ResidentLevel;
+		std::vector<size_t> BytesFrom;//bytes of the levels [i, levels), one more for the empty chain
+		float Priority = 0.0f;
+		size_t LastUsedFrame = 0;
+		bool Streaming = false, Failed = false, Excluded = false;
+	};
+	typedef std::shared_ptr<Entry> EntryPtr;
+	void Stream(const EntryPtr& entry, int level);
+	void DropLevels(const EntryPtr& entry, int level);
+	CoTask<void> StreamLevels(EntryPtr entry, int oldLevel);
+private:
+	ResourceManager& mResMng;
+	RenderSystem& mRenderSys;
+	std::unordered_map<const ITexture*, EntryPtr> mEntries;
+#if !defined MIR_CPPCORO_DISABLED
+	cppcoro::async_scope mScope;
+#endif
+	size_t mFrame = 1, mStreamCount = 0;//LastUsedFrame 0 is never used
+	size_t mResidentBytes = 0, mBudget = 256 * 1024 * 1024;
+	bool mEnabled = true, mDisposed = false;
+};
+
+}
+}
@@ -8,6 +8,9 @@
 #include "core/renderable/skybox.h"
 #include "core/renderable/post_process.h"
 #include "core/renderable/renderable_factory.h"
+#include "core/renderable/assimp_model.h"
+#include "core/renderable/animation_system.h"
+#include "core/renderable/cluster_culler.h"
 #include "core/rendersys/render_pipeline.h"
 
 using namespace mir::scene;
@@ -24,9 +27,12 @@ SceneManager::SceneManager(ResourceManager& resMng, RenderableFactoryPtr rendFac
 	mCameraFac->SetReverseZ(cfg.IsReverseZ());
 	mCameraFac->SetAspect(1.0f * mResMng.WinWidth() / mResMng.WinHeight());
 	mNodeFac = CreateInstance<SceneNodeFactory>();
+	mAnimSystem = CreateInstance<rend::AnimationSystem>(resMng);
+	mClusterCuller = CreateInstance<rend::ClusterCuller>();
 
 	mNodesSignal.Connect(mCamerasSlot);
 	mNodesSignal.Connect(mLightsSlot);
+	mNodesSignal.Connect(mModelsSlot);
 }
 
 SceneManager::~SceneManager()
@@ -43,6 +49,11 @@ void SceneManager::Dispose()
 		mNodeFac = nullptr;
 		mRendFac = nullptr;
 		mGuiMng = nullptr;
+		for (auto& model : mModels)
+			mAnimSystem->Unregister(model);
+		mModels.clear();
+		mAnimSystem = nullptr;
+		mClusterCuller = nullptr;
 
 		mNodes.clear();
 		mLights.clear();
@@ -89,9 +100,13 @@ CoTask<void> SceneManager::UpdateFrame(float dt)
 	DEBUG_LOG_CALLSTK("sceneMng.UpdateFrame");
 	CoAwait mGuiMng->UpdateFrame(dt);
 
+	SyncModels();
+	for (auto& model : mModels)
+		mClusterCuller->AddModel(model.get());
+
 	Eigen::AlignedBox3f aabb = this->GetWorldAABB();
 	for (auto& node : mNodes) {
-		if (RenderablePtr rend = node->GetRenderable()) 
+		if (RenderablePtr rend = node->GetRenderable())
 			CoAwait rend->UpdateFrame(dt);
 
 		if (CameraPtr camera = node->GetCamera())
@@ -100,6 +115,9 @@ CoTask<void> SceneManager::UpdateFrame(float dt)
 		if (scene::LightPtr light = node->GetLight())
 			light->UpdateLightCamera(aabb);
 	}
+	CoAwait mAnimSystem->UpdateFrame(GetCameras(), GetLights());
+	//after the poses, a cluster follows its node
+	mClusterCuller->UpdateFrame(GetCameras(), GetLights());
 
 #if MIR_GRAPHICS_DEBUG
 	if (mDebugPaint == nullptr)
@@ -133,6 +151,25 @@ Eigen::AlignedBox3f SceneManager::GetWorldAABB() const
 	return aabb;
 }
 
+void SceneManager::SyncModels()
+{
+	if (mModelsSlot.AcquireSignal()) {
+		std::vector<rend::AssimpModelPtr> models;
+		for (auto& node : mNodes) {
+			if (auto model = std::dynamic_pointer_cast<rend::AssimpModel>(node->GetRenderable()))
+				models.push_back(model);
+		}
+
+		for (auto& model : mModels) {
+			if (std::find(models.begin(), models.end(), model) == models.end())
+				mAnimSystem->Unregister(model);
+		}
+		for (auto& model : models)
+			mAnimSystem->Register(model);
+		mModels.swap(models);
+	}
+}
+
 const std::vector<mir::scene::CameraPtr>& SceneManager::GetCameras() const
 {
 	if (mCamerasSlot.AcquireSignal()) {
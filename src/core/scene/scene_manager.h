@@ -55,9 +55,14 @@ public:
 	const scene::LightFactoryPtr& GetLightFac() const { return mLightFac; }
 	const SceneNodeFactoryPtr& GetNodeFac() const { return mNodeFac; }
 	const GuiManagerPtr& GetGuiMng() const { return mGuiMng; }
+	const rend::AnimationSystemPtr& GetAnimationSystem() const { return mAnimSystem; }
+	const rend::ClusterCullerPtr& GetClusterCuller() const { return mClusterCuller; }
 public:
 	CoTask<void> UpdateFrame(float dt);
 	void GetRenderables(RenderableCollection& rends);
+private:
+	/* registers the models of new nodes with the animation system */
+	void SyncModels();
 private:
 	ResourceManager& mResMng;
 
@@ -66,6 +71,8 @@ private:
 	SceneNodeFactoryPtr mNodeFac;
 	RenderableFactoryPtr mRendFac;
 	GuiManagerPtr mGuiMng;
+	rend::AnimationSystemPtr mAnimSystem;
+	rend::ClusterCullerPtr mClusterCuller;
 
 	std::vector<SceneNodePtr> mNodes;
 	DefferedSignal mNodesSignal;
@@ -73,6 +80,8 @@ private:
 	mutable std::vector<scene::LightPtr> mLights;
 	mutable std::vector<scene::CameraPtr> mCameras;
 	mutable DefferedSlot mLightsSlot, mCamerasSlot;
+	std::vector<rend::AssimpModelPtr> mModels;
+	DefferedSlot mModelsSlot;
 #if MIR_GRAPHICS_DEBUG
 	rend::Paint3DPtr mDebugPaint;
 #endif
@@ -0,0 +1,71 @@
+#include "test/framework/test_case.h"
+#include "core/renderable/assimp_crowd.h"
+
+using namespace mir;
+using namespace mir::rend;
+
+/* case 0: an AssimpModel skinned per model on the left, one AssimpCrowd instance of the same clip on the right,
+ * both should move alike. case 1: a crowd grid spanning several instanced draws, the reference model in front */
+class TestCrowd : public App
+{
+protected:
+	CoTask<bool> OnInitScene() override;
+	void OnInitLight() override {}
+	void OnInitCamera() override {}
+};
+
+CoTask<bool> TestCrowd::OnInitScene()
+{
+	CameraPtr camera = mScneMng->CreateCameraNode(kCameraPerspective);
+	camera->SetFov(60);
+	camera->SetRenderingPath((RenderingPath)mCaseSecondIndex);
+
+	auto dir_light = mScneMng->CreateLightNode<DirectLight>();
+	dir_light->SetLookAt(Eigen::Vector3f(0, 3, 0), Eigen::Vector3f::Zero());
+
+	MaterialLoadParamBuilder skyMat = MAT_SKYBOX;
+	camera->SetSkyBox(CoAwait mRendFac->CreateSkyboxT(test1::res::Sky(), skyMat));
+
+	#define MODEL_SCALE 0.01
+	const Eigen::Vector3f scale(MODEL_SCALE, MODEL_SCALE, MODEL_SCALE);
+	test1::res::model model;
+
+	MaterialLoadParamBuilder modelMat = MAT_MODEL;
+	auto refModel = mScneMng->AddRendAsNode(CoAwait mRendFac->CreateAssimpModelT(modelMat));
+	mTransform = CoAwait model.Init("Spaceship", refModel);
+	mTransform->SetScale(scale);
+	refModel->PlayAnim(0);
+
+	auto crowd = mScneMng->AddRendAsNode(CoAwait mRendFac->CreateAssimpCrowdT(modelMat));
+	if (!CoAwait crowd->LoadModel(model.Path(), model.Rd()))
+		CoReturn false;
+
+	auto instanceWorld = [&scale](const Eigen::Vector3f& pos) -> Eigen::Matrix4f {
+		return (Eigen::Translation3f(pos) * Eigen::Scaling(scale)).matrix();
+	};
+	switch (mCaseIndex) {
+	case 0: {
+		camera->SetLookAt(Eigen::Vector3f(0, 0, -15), Eigen::Vector3f::Zero());
+		mTransform->SetPosition(Eigen::Vector3f(-4, 0, 0));
+		crowd->AddInstance(instanceWorld(Eigen::Vector3f(4, 0, 0)), 0);
+	}break;
+	case 1: {
+		camera->SetLookAt(Eigen::Vector3f(0, 40, -60), Eigen::Vector3f(0, 0, 20));
+		mTransform->SetPosition(Eigen::Vector3f(0, 0, -8));
+
+		const int side = 12;
+		const size_t clipCount = std::max<size_t>(crowd->GetAnimationTexture().GetClips().size(), 1);
+		for (int z = 0; z < side; ++z) {
+			for (int x = 0; x < side; ++x) {
+				int index = z * side + x;
+				crowd->AddInstance(instanceWorld(Eigen::Vector3f((x - side / 2) * 6, 0, z * 6)), index % clipCount, index * 0.13f);
+			}
+		}
+	}break;
+	default:
+		break;
+	}
+	CoReturn true;
+}
+
+auto reg = AppRegister<TestCrowd>("test_crowd");